@@ -0,0 +1,110 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdalign.h>
+#include "arena.h"
+
+#define ARENA_ALIGNMENT alignof(max_align_t)
+#define BLOCK_HEADER_SIZE ((sizeof(ArenaBlock) + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1))
+
+static char *block_data(ArenaBlock *block) {
+    return (char *)block + BLOCK_HEADER_SIZE;
+}
+
+static size_t align_up(size_t size) {
+    return (size + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1);
+}
+
+void arena_init(Arena *arena, size_t block_size) {
+    arena->blocks = NULL;
+    arena->block_size = block_size ? block_size : ARENA_DEFAULT_BLOCK_SIZE;
+    arena->last_offset = 0;
+}
+
+void arena_reset(Arena *arena) {
+    ArenaBlock *largest = NULL;
+    ArenaBlock *block = arena->blocks;
+
+    while (block) {
+        ArenaBlock *next = block->next;
+        if (!largest || block->size > largest->size) {
+            free(largest);
+            largest = block;
+        } else {
+            free(block);
+        }
+        block = next;
+    }
+    if (largest) {
+        largest->next = NULL;
+        largest->used = 0;
+    }
+    arena->blocks = largest;
+    arena->last_offset = 0;
+}
+
+void arena_free(Arena *arena) {
+    ArenaBlock *block = arena->blocks;
+    while (block) {
+        ArenaBlock *next = block->next;
+        free(block);
+        block = next;
+    }
+    arena->blocks = NULL;
+    arena->last_offset = 0;
+}
+
+void *arena_alloc(Arena *arena, size_t size) {
+    ArenaBlock *block = arena->blocks;
+    size = align_up(size ? size : 1);
+
+    if (!block || block->size - block->used < size) {
+        // Oversized requests get a block of their own size
+        size_t data_size = size > arena->block_size ? size : arena->block_size;
+        block = malloc(BLOCK_HEADER_SIZE + data_size);
+        if (!block) {
+            return NULL;
+        }
+        block->size = data_size;
+        block->used = 0;
+        block->next = arena->blocks;
+        arena->blocks = block;
+    }
+
+    arena->last_offset = block->used;
+    block->used += size;
+    return block_data(block) + arena->last_offset;
+}
+
+void *arena_grow(Arena *arena, void *old, size_t old_size, size_t new_size) {
+    ArenaBlock *block = arena->blocks;
+
+    if (old && block && (char *)old == block_data(block) + arena->last_offset) {
+        size_t aligned = align_up(new_size);
+        if (aligned <= block->size - arena->last_offset) {
+            block->used = arena->last_offset + aligned;
+            return old;
+        }
+    }
+
+    void *grown = arena_alloc(arena, new_size);
+    if (grown && old) {
+        memcpy(grown, old, old_size < new_size ? old_size : new_size);
+    }
+    return grown;
+}
+
+char *arena_strndup(Arena *arena, const char *text, size_t length) {
+    if (!text) {
+        return NULL;
+    }
+    char *copy = arena_alloc(arena, length + 1);
+    if (copy) {
+        memcpy(copy, text, length);
+        copy[length] = '\0';
+    }
+    return copy;
+}
+
+char *arena_strdup(Arena *arena, const char *text) {
+    return text ? arena_strndup(arena, text, strlen(text)) : NULL;
+}
@@ -0,0 +1,48 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+// Bump allocator for per-request lifetimes
+// Records and strings built for one request are carved out of large blocks
+// and released together by arena_reset, so a request costs no malloc/free
+// pairs once the arena has warmed up. Nothing is freed individually.
+// An arena is not thread-safe; give each worker or session its own.
+
+typedef struct ArenaBlock {
+    struct ArenaBlock *next;
+    size_t size;  // usable bytes in data
+    size_t used;
+    // data follows, aligned to max_align_t
+} ArenaBlock;
+
+typedef struct {
+    ArenaBlock *blocks;  // current block first
+    size_t block_size;
+    size_t last_offset;  // offset of the latest allocation in the current block
+} Arena;
+
+#define ARENA_DEFAULT_BLOCK_SIZE (64 * 1024)
+
+// Initialize an empty arena; a block_size of 0 uses ARENA_DEFAULT_BLOCK_SIZE
+void arena_init(Arena *arena, size_t block_size);
+
+// Release everything allocated since the last reset. The largest block is
+// kept so a steady workload stops allocating after the first few requests.
+void arena_reset(Arena *arena);
+
+// Release all memory held by the arena
+void arena_free(Arena *arena);
+
+// Allocate size bytes aligned for any type; returns NULL when out of memory
+void *arena_alloc(Arena *arena, size_t size);
+
+// Resize the latest allocation in place when possible, otherwise copy it to
+// a new allocation (the old bytes stay allocated until the reset)
+void *arena_grow(Arena *arena, void *old, size_t old_size, size_t new_size);
+
+// Copy a string (or length bytes of it) into the arena; NULL stays NULL
+char *arena_strdup(Arena *arena, const char *text);
+char *arena_strndup(Arena *arena, const char *text, size_t length);
+
+#endif // ARENA_H
@@ -0,0 +1,129 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "backup.h"
+#include "metrics.h"
+
+#define BACKUP_DEFAULT_PAGES_PER_STEP 256
+#define BACKUP_DEFAULT_PAUSE_MS 10
+#define BACKUP_DEFAULT_RESTART_LIMIT 8
+
+void backup_default_options(BackupOptions *options) {
+    options->pages_per_step = BACKUP_DEFAULT_PAGES_PER_STEP;
+    options->pause_ms = BACKUP_DEFAULT_PAUSE_MS;
+    options->restart_limit = BACKUP_DEFAULT_RESTART_LIMIT;
+    options->progress = NULL;
+    options->progress_context = NULL;
+}
+
+// Newest transaction in the finished copy; 0 if it has none
+static sqlite3_int64 read_last_transaction_id(sqlite3 *connection) {
+    sqlite3_stmt *stmt;
+    sqlite3_int64 last_id = 0;
+
+    if (sqlite3_prepare_v2(connection, "SELECT coalesce(max(transaction_id), 0) FROM Transactions;", -1,
+                           &stmt, NULL) != SQLITE_OK) {
+        return 0;
+    }
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        last_id = sqlite3_column_int64(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+    return last_id;
+}
+
+// Run the backup steps; returns SQLITE_DONE on success
+static int copy_pages(sqlite3_backup *backup, const BackupOptions *options, BackupStats *stats) {
+    int pages_per_step = options->pages_per_step > 0 ? options->pages_per_step : -1;
+    int last_remaining = -1;
+    int rc;
+
+    do {
+        rc = sqlite3_backup_step(backup, pages_per_step);
+        stats->steps++;
+
+        int remaining = sqlite3_backup_remaining(backup);
+        stats->page_count = sqlite3_backup_pagecount(backup);
+        if (rc == SQLITE_OK && last_remaining >= 0 && remaining > last_remaining &&
+            ++stats->restarts >= options->restart_limit) {
+            // Writers keep changing the source; take the rest in one go
+            pages_per_step = -1;
+        }
+        if (rc == SQLITE_OK || rc == SQLITE_DONE) {
+            last_remaining = remaining;
+            if (options->progress) {
+                options->progress(stats->page_count - remaining, stats->page_count, options->progress_context);
+            }
+        }
+
+        // Busy and locked are transient: wait like any other pause and retry
+        if (rc == SQLITE_OK || rc == SQLITE_BUSY || rc == SQLITE_LOCKED) {
+            sqlite3_sleep(options->pause_ms);
+        }
+    } while (rc == SQLITE_OK || rc == SQLITE_BUSY || rc == SQLITE_LOCKED);
+
+    return rc;
+}
+
+int backup_database(Database *db, const char *path, const BackupOptions *options, BackupStats *stats) {
+    BackupOptions defaults;
+    BackupStats local_stats;
+    if (!options) {
+        backup_default_options(&defaults);
+        options = &defaults;
+    }
+    if (!stats) {
+        stats = &local_stats;
+    }
+    memset(stats, 0, sizeof(*stats));
+    double started = metrics_now_seconds();
+
+    size_t length = strlen(path);
+    char *temp_path = malloc(length + sizeof(".tmp"));
+    if (!temp_path) {
+        fprintf(stderr, "Out of memory starting backup\n");
+        return -1;
+    }
+    memcpy(temp_path, path, length);
+    memcpy(temp_path + length, ".tmp", sizeof(".tmp"));
+    unlink(temp_path);
+
+    sqlite3 *copy;
+    int status = -1;
+    if (sqlite3_open_v2(temp_path, &copy, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, NULL) != SQLITE_OK) {
+        fprintf(stderr, "Cannot open backup file %s: %s\n", temp_path, sqlite3_errmsg(copy));
+        sqlite3_close(copy);
+        free(temp_path);
+        return -1;
+    }
+
+    sqlite3_backup *backup = sqlite3_backup_init(copy, "main", db->connection, "main");
+    if (!backup) {
+        fprintf(stderr, "Failed to start backup: %s\n", sqlite3_errmsg(copy));
+    } else {
+        int rc = copy_pages(backup, options, stats);
+        if (sqlite3_backup_finish(backup) == SQLITE_OK && rc == SQLITE_DONE) {
+            stats->last_transaction_id = read_last_transaction_id(copy);
+            status = 0;
+        } else {
+            fprintf(stderr, "Backup failed: %s\n", sqlite3_errmsg(copy));
+        }
+    }
+
+    // Closing the last connection checkpoints the copy's WAL into the file before the rename
+    if (sqlite3_close(copy) != SQLITE_OK) {
+        status = -1;
+    }
+    if (status == 0 && rename(temp_path, path) != 0) {
+        perror(path);
+        status = -1;
+    }
+    if (status != 0) {
+        unlink(temp_path);
+    }
+    free(temp_path);
+
+    stats->elapsed_seconds = metrics_now_seconds() - started;
+    return status;
+}
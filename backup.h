@@ -0,0 +1,44 @@
+#ifndef BACKUP_H
+#define BACKUP_H
+
+#include "database.h"
+
+// Online backup
+// Copies the live database page by page with SQLite's backup API while
+// other connections keep reading and writing. Each step copies at most
+// pages_per_step pages under a short read lock, then the copy pauses for
+// pause_ms so writers get the file. A write from another connection makes
+// SQLite restart the copy at its next step; after restart_limit restarts the
+// rest is copied in one step, which in WAL mode still only holds a read
+// snapshot and does not block writers. Writes made through db itself are
+// carried into the copy without a restart.
+//
+// The copy is written to "<path>.tmp" and renamed over path once complete,
+// so path always holds either the previous backup or a whole new one.
+
+// Called after every step with the pages copied so far and the current total
+typedef void (*BackupProgress)(int pages_done, int page_count, void *context);
+
+typedef struct {
+    int pages_per_step;  // < 1 copies everything in one step
+    int pause_ms;        // sleep between steps
+    int restart_limit;   // source changes tolerated before finishing in one step
+    BackupProgress progress;
+    void *progress_context;
+} BackupOptions;
+
+typedef struct {
+    int page_count;
+    int steps;
+    int restarts;
+    sqlite3_int64 last_transaction_id;  // newest transaction in the copy
+    double elapsed_seconds;
+} BackupStats;
+
+// Fill options with defaults (256 pages per step, 10 ms pauses, 8 restarts, no progress callback)
+void backup_default_options(BackupOptions *options);
+
+// Back up db to path; options may be NULL for the defaults and stats may be NULL. Returns 0 or -1.
+int backup_database(Database *db, const char *path, const BackupOptions *options, BackupStats *stats);
+
+#endif // BACKUP_H
@@ -0,0 +1,627 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "database.h"
+#include "commit_queue.h"
+#include "report.h"
+#include "csv_import.h"
+#include "metrics.h"
+
+// Benchmark harness for the database.h API
+// Builds a synthetic inventory (N products, M suppliers, K transactions with
+// Zipf-skewed product popularity), times every public operation, and prints
+// throughput with p50/p99 latencies. Failed calls are counted separately and
+// kept out of the timings. --json writes one JSON object per operation so
+// results can be compared between versions.
+
+#define BENCH_DAYS 365
+#define ZIPF_EXPONENT 1.1
+#define BENCH_CLERKS 8
+
+typedef struct {
+    const char *name;
+    double *samples;  // per-call latency in seconds
+    int count;
+    int capacity;
+    long rows;        // rows produced or consumed, for row-oriented operations
+    int failures;     // calls that returned an error, not in samples
+} OpStats;
+
+typedef struct {
+    int products;
+    int suppliers;
+    int transactions;
+    int lookups;
+    unsigned int seed;
+    const char *db_name;
+    const char *json_path;
+    ConnectionProfile profile;
+} BenchOptions;
+
+static const char *categories[] = {
+    "Beverages", "Snacks", "Dairy", "Bakery", "Frozen", "Produce",
+    "Household", "Personal Care", "Canned Goods", "Condiments"
+};
+#define CATEGORY_COUNT ((int)(sizeof(categories) / sizeof(categories[0])))
+
+static void record(OpStats *op, double seconds, long rows) {
+    if (op->count == op->capacity) {
+        op->capacity = op->capacity ? op->capacity * 2 : 1024;
+        op->samples = realloc(op->samples, sizeof(double) * op->capacity);
+        if (!op->samples) {
+            fprintf(stderr, "Out of memory recording samples\n");
+            exit(1);
+        }
+    }
+    op->samples[op->count++] = seconds;
+    op->rows += rows;
+}
+
+// Record a call returning 0 on success
+static void record_status(OpStats *op, double seconds, int status) {
+    if (status != 0) {
+        op->failures++;
+        return;
+    }
+    record(op, seconds, 1);
+}
+
+// Record a call returning its row count, or -1 on error
+static void record_rows(OpStats *op, double seconds, int rows) {
+    if (rows < 0) {
+        op->failures++;
+        return;
+    }
+    record(op, seconds, rows);
+}
+
+static int compare_doubles(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static double percentile(const OpStats *op, double fraction) {
+    int index = (int)ceil(fraction * op->count) - 1;
+    if (index < 0) {
+        index = 0;
+    }
+    return op->samples[index];
+}
+
+// Uniform double in [0, 1)
+static double random_unit(unsigned int *state) {
+    return rand_r(state) / ((double)RAND_MAX + 1.0);
+}
+
+// Cumulative Zipf distribution over ranks 1..n
+static double *build_zipf_cdf(int n) {
+    double *cdf = malloc(sizeof(double) * n);
+    double total = 0.0;
+    for (int i = 0; i < n; i++) {
+        total += 1.0 / pow(i + 1, ZIPF_EXPONENT);
+        cdf[i] = total;
+    }
+    for (int i = 0; i < n; i++) {
+        cdf[i] /= total;
+    }
+    return cdf;
+}
+
+// Draw a 0-based rank from the Zipf distribution
+static int sample_zipf(const double *cdf, int n, unsigned int *state) {
+    double u = random_unit(state);
+    int lo = 0, hi = n - 1;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (cdf[mid] < u) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+// Format day offset from 2024-01-01 as YYYY-MM-DD
+static void format_day(int day, char *buffer, size_t size) {
+    struct tm date = {0};
+    date.tm_year = 2024 - 1900;
+    date.tm_mday = 1 + day;
+    date.tm_hour = 12;
+    timegm(&date);
+    strftime(buffer, size, "%Y-%m-%d", &date);
+}
+
+static void print_results(OpStats *ops, int op_count, const BenchOptions *options) {
+    FILE *json = NULL;
+    if (options->json_path) {
+        json = fopen(options->json_path, "w");
+        if (!json) {
+            perror(options->json_path);
+        }
+    }
+
+    printf("%-24s %10s %12s %12s %12s %14s %8s\n",
+           "Operation", "Calls", "Ops/sec", "p50 (us)", "p99 (us)", "Rows/sec", "Failed");
+    for (int i = 0; i < op_count; i++) {
+        OpStats *op = &ops[i];
+        if (op->count == 0) {
+            if (op->failures > 0) {
+                printf("%-24s %10d %12s %12s %12s %14s %8d\n", op->name, 0, "-", "-", "-", "-", op->failures);
+            }
+            continue;
+        }
+
+        double total = 0.0;
+        for (int j = 0; j < op->count; j++) {
+            total += op->samples[j];
+        }
+        qsort(op->samples, op->count, sizeof(double), compare_doubles);
+        double p50 = percentile(op, 0.50) * 1e6;
+        double p99 = percentile(op, 0.99) * 1e6;
+        double ops_per_sec = total > 0 ? op->count / total : 0.0;
+        double rows_per_sec = total > 0 ? op->rows / total : 0.0;
+
+        printf("%-24s %10d %12.0f %12.1f %12.1f %14.0f %8d\n",
+               op->name, op->count, ops_per_sec, p50, p99, rows_per_sec, op->failures);
+        if (json) {
+            fprintf(json,
+                    "{\"operation\":\"%s\",\"calls\":%d,\"total_seconds\":%.6f,\"ops_per_sec\":%.1f,"
+                    "\"p50_us\":%.2f,\"p99_us\":%.2f,\"rows\":%ld,\"rows_per_sec\":%.1f,\"failures\":%d,"
+                    "\"products\":%d,\"suppliers\":%d,\"transactions\":%d,\"sqlite_version\":\"%s\"}\n",
+                    op->name, op->count, total, ops_per_sec, p50, p99, op->rows, rows_per_sec, op->failures,
+                    options->products, options->suppliers, options->transactions, sqlite3_libversion());
+        }
+    }
+
+    if (json) {
+        fclose(json);
+    }
+}
+
+static void print_usage(const char *program) {
+    fprintf(stderr, "Usage: %s [--products N] [--suppliers M] [--transactions K] [--lookups L]\n"
+                    "       [--seed S] [--db FILE] [--profile NAME] [--json FILE]\n", program);
+}
+
+static int parse_options(int argc, char *argv[], BenchOptions *options) {
+    options->products = 10000;
+    options->suppliers = 200;
+    options->transactions = 100000;
+    options->lookups = 100000;
+    options->seed = 42;
+    options->db_name = "bench.db";
+    options->json_path = NULL;
+    options->profile = PROFILE_BALANCED;
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc) {
+            return -1;
+        }
+        const char *value = argv[++i];
+        if (strcmp(argv[i - 1], "--products") == 0) {
+            options->products = atoi(value);
+        } else if (strcmp(argv[i - 1], "--suppliers") == 0) {
+            options->suppliers = atoi(value);
+        } else if (strcmp(argv[i - 1], "--transactions") == 0) {
+            options->transactions = atoi(value);
+        } else if (strcmp(argv[i - 1], "--lookups") == 0) {
+            options->lookups = atoi(value);
+        } else if (strcmp(argv[i - 1], "--seed") == 0) {
+            options->seed = (unsigned int)strtoul(value, NULL, 10);
+        } else if (strcmp(argv[i - 1], "--db") == 0) {
+            options->db_name = value;
+        } else if (strcmp(argv[i - 1], "--json") == 0) {
+            options->json_path = value;
+        } else if (strcmp(argv[i - 1], "--profile") == 0) {
+            if (parse_connection_profile(value, &options->profile) != 0) {
+                return -1;
+            }
+        } else {
+            return -1;
+        }
+    }
+    if (options->products < 1 || options->suppliers < 1 || options->transactions < 0 || options->lookups < 0) {
+        return -1;
+    }
+    return 0;
+}
+
+// One simulated clerk recording sales through the group-commit queue
+typedef struct {
+    CommitQueue *queue;
+    const double *popularity;
+    const BenchOptions *options;
+    unsigned int seed;
+    int count;
+    OpStats stats;
+} Clerk;
+
+static void *run_clerk(void *arg) {
+    Clerk *clerk = arg;
+    char date[16];
+
+    for (int i = 0; i < clerk->count; i++) {
+        int product_id = 1 + sample_zipf(clerk->popularity, clerk->options->products, &clerk->seed);
+        format_day(rand_r(&clerk->seed) % BENCH_DAYS, date, sizeof(date));
+        CommitTicket ticket;
+        commit_ticket_init(&ticket);
+        double started = metrics_now_seconds();
+        int status = commit_queue_add_transaction(clerk->queue, product_id, "OUT", 1 + rand_r(&clerk->seed) % 20,
+                                                  date, 1 + rand_r(&clerk->seed) % clerk->options->suppliers,
+                                                  commit_ticket_complete, &ticket);
+        if (status == 0) {
+            status = commit_ticket_wait(&ticket);
+        }
+        record_status(&clerk->stats, metrics_now_seconds() - started, status);
+        commit_ticket_destroy(&ticket);
+    }
+    return NULL;
+}
+
+// Operations measured, in report order
+enum {
+    OP_ADD_SUPPLIER,
+    OP_ADD_PRODUCT,
+    OP_ADD_TRANSACTION,
+    OP_QUEUED_TRANSACTION,
+    OP_QUEUED_THROUGHPUT,
+    OP_INGEST,
+    OP_GET_PRODUCT,
+    OP_GET_SUPPLIER,
+    OP_UPDATE_STOCK,
+    OP_LIST_PRODUCTS,
+    OP_LIST_SUPPLIERS,
+    OP_LIST_TRANSACTIONS,
+    OP_PRODUCTS_PAGE,
+    OP_TRANSACTIONS_PAGE,
+    OP_SALES_REPORT_MONTH,
+    OP_SALES_REPORT_YEAR,
+    OP_LOW_STOCK,
+    OP_SEARCH_PRODUCTS,
+    OP_STOCK_AS_OF,
+    OP_PARALLEL_REPORT,
+    OP_IMPORT_PRODUCTS,
+    OP_DELETE_PRODUCT,
+    OP_COUNT
+};
+
+int main(int argc, char *argv[]) {
+    BenchOptions options;
+    if (parse_options(argc, argv, &options) != 0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    OpStats ops[OP_COUNT] = {
+        [OP_ADD_SUPPLIER] = {.name = "add_supplier"},
+        [OP_ADD_PRODUCT] = {.name = "add_product"},
+        [OP_ADD_TRANSACTION] = {.name = "add_transaction"},
+        [OP_QUEUED_TRANSACTION] = {.name = "commit_queue_ack"},
+        [OP_QUEUED_THROUGHPUT] = {.name = "commit_queue_8_clerks"},
+        [OP_INGEST] = {.name = "ingest_transactions"},
+        [OP_GET_PRODUCT] = {.name = "get_product_by_id"},
+        [OP_GET_SUPPLIER] = {.name = "get_supplier_by_id"},
+        [OP_UPDATE_STOCK] = {.name = "update_stock_quantity"},
+        [OP_LIST_PRODUCTS] = {.name = "list_all_products"},
+        [OP_LIST_SUPPLIERS] = {.name = "list_all_suppliers"},
+        [OP_LIST_TRANSACTIONS] = {.name = "list_transactions"},
+        [OP_PRODUCTS_PAGE] = {.name = "list_products_page"},
+        [OP_TRANSACTIONS_PAGE] = {.name = "list_transactions_page"},
+        [OP_SALES_REPORT_MONTH] = {.name = "sales_report_30d"},
+        [OP_SALES_REPORT_YEAR] = {.name = "sales_report_365d"},
+        [OP_LOW_STOCK] = {.name = "list_low_stock_products"},
+        [OP_SEARCH_PRODUCTS] = {.name = "search_products"},
+        [OP_STOCK_AS_OF] = {.name = "get_stock_as_of"},
+        [OP_PARALLEL_REPORT] = {.name = "parallel_report_365d"},
+        [OP_IMPORT_PRODUCTS] = {.name = "import_products_csv"},
+        [OP_DELETE_PRODUCT] = {.name = "delete_product"},
+    };
+
+    // Start from an empty database file
+    char path[512];
+    const char *suffixes[] = {"", "-wal", "-shm"};
+    for (int i = 0; i < 3; i++) {
+        snprintf(path, sizeof(path), "%s%s", options.db_name, suffixes[i]);
+        unlink(path);
+    }
+
+    DatabaseConfig config;
+    database_config_for_profile(&config, options.profile);
+    Database db;
+    if (initialize_database(&db, options.db_name, &config) != 0) {
+        return 1;
+    }
+
+    int null_fd = open("/dev/null", O_WRONLY);
+    OutputSink sink;
+    if (null_fd < 0 || output_open(&sink, null_fd, OUTPUT_TABLE) != 0) {
+        fprintf(stderr, "Cannot open /dev/null for output benchmarks\n");
+        return 1;
+    }
+
+    unsigned int rng = options.seed;
+    double *popularity = build_zipf_cdf(options.products);
+    char name[64], description[128], contact[64], address[96], date[16], end_date[16];
+    double started, elapsed;
+    int next_id;
+
+    printf("Generating %d suppliers, %d products, %d transactions (seed %u)\n",
+           options.suppliers, options.products, options.transactions, options.seed);
+
+    for (int i = 0; i < options.suppliers; i++) {
+        snprintf(name, sizeof(name), "Supplier %d", i + 1);
+        snprintf(contact, sizeof(contact), "orders%d@supplier.example", i + 1);
+        snprintf(address, sizeof(address), "%d Warehouse Road, Unit %d", 100 + i, i % 40);
+        started = metrics_now_seconds();
+        int status = add_supplier(&db, name, contact, address);
+        record_status(&ops[OP_ADD_SUPPLIER], metrics_now_seconds() - started, status);
+    }
+
+    for (int i = 0; i < options.products; i++) {
+        double cost = 0.5 + random_unit(&rng) * 99.5;
+        snprintf(name, sizeof(name), "SKU-%06d", i + 1);
+        snprintf(description, sizeof(description), "Synthetic product %d, pack of %d", i + 1, 1 + i % 24);
+        started = metrics_now_seconds();
+        int status = add_product(&db, name, description, categories[i % CATEGORY_COUNT], cost, cost * 1.3,
+                                 1000 + rand_r(&rng) % 5000, 50 + rand_r(&rng) % 500);
+        record_status(&ops[OP_ADD_PRODUCT], metrics_now_seconds() - started, status);
+    }
+
+    // Per-row path for a bounded sample, the bulk path for the rest
+    int per_row = options.transactions < 2000 ? options.transactions : 2000;
+    for (int i = 0; i < per_row; i++) {
+        int product_id = 1 + sample_zipf(popularity, options.products, &rng);
+        int is_sale = rand_r(&rng) % 4 != 0;
+        format_day(rand_r(&rng) % BENCH_DAYS, date, sizeof(date));
+        started = metrics_now_seconds();
+        int status = add_transaction(&db, product_id, is_sale ? "OUT" : "IN", 1 + rand_r(&rng) % 20, date,
+                                     1 + rand_r(&rng) % options.suppliers);
+        record_status(&ops[OP_ADD_TRANSACTION], metrics_now_seconds() - started, status);
+    }
+
+    // The same volume again from concurrent clerks, each waiting for its commit;
+    // commit_queue_ack is the per-call latency, commit_queue_8_clerks the wall-clock rate
+    CommitQueueOptions queue_options;
+    commit_queue_default_options(&queue_options);
+    queue_options.config = config;
+    CommitQueue queue;
+    if (per_row > 0 && commit_queue_open(&queue, options.db_name, &queue_options) == 0) {
+        Clerk clerks[BENCH_CLERKS];
+        pthread_t threads[BENCH_CLERKS];
+        int threads_started[BENCH_CLERKS];
+        started = metrics_now_seconds();
+        for (int i = 0; i < BENCH_CLERKS; i++) {
+            clerks[i] = (Clerk){.queue = &queue, .popularity = popularity, .options = &options,
+                                .seed = options.seed + i + 1, .count = per_row / BENCH_CLERKS};
+            if (pthread_create(&threads[i], NULL, run_clerk, &clerks[i]) != 0) {
+                // Run this clerk's share inline rather than lose it
+                run_clerk(&clerks[i]);
+                threads_started[i] = 0;
+            } else {
+                threads_started[i] = 1;
+            }
+        }
+        for (int i = 0; i < BENCH_CLERKS; i++) {
+            if (threads_started[i]) {
+                pthread_join(threads[i], NULL);
+            }
+            for (int j = 0; j < clerks[i].stats.count; j++) {
+                record(&ops[OP_QUEUED_TRANSACTION], clerks[i].stats.samples[j], 1);
+            }
+            ops[OP_QUEUED_TRANSACTION].failures += clerks[i].stats.failures;
+            free(clerks[i].stats.samples);
+        }
+        record(&ops[OP_QUEUED_THROUGHPUT], metrics_now_seconds() - started, ops[OP_QUEUED_TRANSACTION].count);
+        commit_queue_close(&queue);
+        // The queue's connection changed stock behind this handle's catalog
+        refresh_catalog(&db);
+    } else if (per_row > 0) {
+        ops[OP_QUEUED_TRANSACTION].failures++;
+    }
+
+    char *csv = NULL;
+    size_t csv_size = 0;
+    FILE *csv_stream = open_memstream(&csv, &csv_size);
+    for (int i = per_row; i < options.transactions; i++) {
+        int product_id = 1 + sample_zipf(popularity, options.products, &rng);
+        int is_sale = rand_r(&rng) % 4 != 0;
+        format_day(rand_r(&rng) % BENCH_DAYS, date, sizeof(date));
+        fprintf(csv_stream, "%d,%s,%d,%s,%d\n", product_id, is_sale ? "OUT" : "IN",
+                1 + rand_r(&rng) % 20, date, 1 + rand_r(&rng) % options.suppliers);
+    }
+    fclose(csv_stream);
+
+    FILE *ingest_input = fmemopen(csv, csv_size ? csv_size : 1, "r");
+    BulkIngestStats ingest_stats;
+    if (ingest_transactions(&db, ingest_input, 1000, &ingest_stats) == 0) {
+        record(&ops[OP_INGEST], ingest_stats.elapsed_seconds, ingest_stats.rows_inserted);
+        ops[OP_INGEST].failures += ingest_stats.rows_rejected;
+    } else {
+        ops[OP_INGEST].failures++;
+    }
+    fclose(ingest_input);
+    free(csv);
+
+    printf("Running read benchmarks\n");
+
+    for (int i = 0; i < options.lookups; i++) {
+        Product product;
+        int product_id = 1 + sample_zipf(popularity, options.products, &rng);
+        started = metrics_now_seconds();
+        int status = get_product_by_id(&db, product_id, &product);
+        record_status(&ops[OP_GET_PRODUCT], metrics_now_seconds() - started, status);
+    }
+
+    int supplier_lookups = options.lookups < 20000 ? options.lookups : 20000;
+    for (int i = 0; i < supplier_lookups; i++) {
+        Supplier supplier;
+        int supplier_id = 1 + rand_r(&rng) % options.suppliers;
+        started = metrics_now_seconds();
+        int status = get_supplier_by_id(&db, supplier_id, &supplier);
+        if (status == 0) {
+            free_supplier(&supplier);
+        }
+        record_status(&ops[OP_GET_SUPPLIER], metrics_now_seconds() - started, status);
+    }
+
+    for (int i = 0; i < 2000; i++) {
+        int product_id = 1 + rand_r(&rng) % options.products;
+        started = metrics_now_seconds();
+        int status = update_stock_quantity(&db, product_id, 1000 + rand_r(&rng) % 5000);
+        record_status(&ops[OP_UPDATE_STOCK], metrics_now_seconds() - started, status);
+    }
+
+    for (int i = 0; i < 5; i++) {
+        started = metrics_now_seconds();
+        int rows = write_products(&db, &sink);
+        output_flush(&sink);
+        record_rows(&ops[OP_LIST_PRODUCTS], metrics_now_seconds() - started, rows);
+
+        started = metrics_now_seconds();
+        rows = write_suppliers(&db, &sink);
+        output_flush(&sink);
+        record_rows(&ops[OP_LIST_SUPPLIERS], metrics_now_seconds() - started, rows);
+
+        started = metrics_now_seconds();
+        rows = write_transactions(&db, "OUT", &sink);
+        output_flush(&sink);
+        record_rows(&ops[OP_LIST_TRANSACTIONS], metrics_now_seconds() - started, rows);
+    }
+
+    for (int pass = 0; pass < 3; pass++) {
+        int after_id = 0;
+        do {
+            started = metrics_now_seconds();
+            int rows = write_products_page(&db, 100, after_id, &sink, &next_id);
+            record_rows(&ops[OP_PRODUCTS_PAGE], metrics_now_seconds() - started, rows);
+            after_id = rows < 0 ? 0 : next_id;
+        } while (after_id != 0);
+    }
+
+    int after_id = 0;
+    for (int i = 0; i < 1000; i++) {
+        started = metrics_now_seconds();
+        int rows = write_transactions_page(&db, "OUT", 100, after_id, &sink, &next_id);
+        record_rows(&ops[OP_TRANSACTIONS_PAGE], metrics_now_seconds() - started, rows);
+        after_id = rows < 0 ? 0 : next_id;
+    }
+    output_flush(&sink);
+
+    for (int i = 0; i < 100; i++) {
+        int first = rand_r(&rng) % (BENCH_DAYS - 30);
+        format_day(first, date, sizeof(date));
+        format_day(first + 29, end_date, sizeof(end_date));
+        started = metrics_now_seconds();
+        int rows = write_sales_report(&db, date, end_date, &sink);
+        record_rows(&ops[OP_SALES_REPORT_MONTH], metrics_now_seconds() - started, rows);
+    }
+    for (int i = 0; i < 10; i++) {
+        format_day(0, date, sizeof(date));
+        format_day(BENCH_DAYS - 1, end_date, sizeof(end_date));
+        started = metrics_now_seconds();
+        int rows = write_sales_report(&db, date, end_date, &sink);
+        record_rows(&ops[OP_SALES_REPORT_YEAR], metrics_now_seconds() - started, rows);
+    }
+
+    for (int i = 0; i < 50; i++) {
+        started = metrics_now_seconds();
+        int rows = write_low_stock_products(&db, &sink);
+        record_rows(&ops[OP_LOW_STOCK], metrics_now_seconds() - started, rows);
+    }
+
+    // Words match as prefixes, so a query finds a category or a band of SKUs
+    for (int i = 0; i < 1000; i++) {
+        char query[32];
+        if (i % 2 == 0) {
+            snprintf(query, sizeof(query), "%.4s", categories[rand_r(&rng) % CATEGORY_COUNT]);
+        } else {
+            snprintf(query, sizeof(query), "SKU-%04d", rand_r(&rng) % ((options.products + 99) / 100));
+        }
+        started = metrics_now_seconds();
+        int rows = write_product_search(&db, query, SEARCH_ALL, 50, &sink);
+        record_rows(&ops[OP_SEARCH_PRODUCTS], metrics_now_seconds() - started, rows);
+    }
+    output_flush(&sink);
+
+    for (int i = 0; i < 2000; i++) {
+        int product_id = 1 + sample_zipf(popularity, options.products, &rng);
+        int stock_quantity;
+        format_day(rand_r(&rng) % BENCH_DAYS, date, sizeof(date));
+        started = metrics_now_seconds();
+        int status = get_stock_as_of(&db, product_id, date, &stock_quantity);
+        record_status(&ops[OP_STOCK_AS_OF], metrics_now_seconds() - started, status);
+    }
+
+    format_day(0, date, sizeof(date));
+    format_day(BENCH_DAYS - 1, end_date, sizeof(end_date));
+    for (int i = 0; i < 10; i++) {
+        started = metrics_now_seconds();
+        int rows = write_parallel_report(&db, i % 2 ? BREAKDOWN_CATEGORY : BREAKDOWN_PRODUCT, date, end_date, 0,
+                                         &sink);
+        record_rows(&ops[OP_PARALLEL_REPORT], metrics_now_seconds() - started, rows);
+    }
+    output_flush(&sink);
+
+    // Re-import the catalog as dumped: every row replaces an existing product
+    char csv_path[512];
+    snprintf(csv_path, sizeof(csv_path), "%s.products.csv", options.db_name);
+    int csv_fd = open(csv_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    OutputSink csv_sink;
+    if (csv_fd >= 0 && output_open(&csv_sink, csv_fd, OUTPUT_CSV) == 0) {
+        int exported = write_products(&db, &csv_sink);
+        if (output_close(&csv_sink) == 0 && exported >= 0) {
+            for (int i = 0; i < 3; i++) {
+                BulkIngestStats import_stats;
+                started = metrics_now_seconds();
+                int status = import_products_csv(&db, csv_path, 1000, &import_stats);
+                double seconds = metrics_now_seconds() - started;
+                if (status == 0) {
+                    record(&ops[OP_IMPORT_PRODUCTS], seconds, import_stats.rows_inserted);
+                    ops[OP_IMPORT_PRODUCTS].failures += import_stats.rows_rejected;
+                } else {
+                    ops[OP_IMPORT_PRODUCTS].failures++;
+                }
+            }
+        } else {
+            ops[OP_IMPORT_PRODUCTS].failures++;
+        }
+    } else {
+        perror(csv_path);
+        ops[OP_IMPORT_PRODUCTS].failures++;
+    }
+    if (csv_fd >= 0) {
+        close(csv_fd);
+    }
+    unlink(csv_path);
+
+    int deletes = options.products / 100 > 0 ? options.products / 100 : 1;
+    for (int i = 0; i < deletes; i++) {
+        started = metrics_now_seconds();
+        int status = delete_product(&db, options.products - i);
+        record_status(&ops[OP_DELETE_PRODUCT], metrics_now_seconds() - started, status);
+    }
+
+    elapsed = 0.0;
+    for (int i = 0; i < OP_COUNT; i++) {
+        for (int j = 0; j < ops[i].count; j++) {
+            elapsed += ops[i].samples[j];
+        }
+    }
+    printf("Measured %.2f s across %d operations\n\n", elapsed, OP_COUNT);
+    print_results(ops, OP_COUNT, &options);
+
+    output_close(&sink);
+    close(null_fd);
+    close_database(&db);
+    free(popularity);
+    for (int i = 0; i < OP_COUNT; i++) {
+        free(ops[i].samples);
+    }
+    return 0;
+}
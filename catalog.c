@@ -0,0 +1,315 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "catalog.h"
+
+#define CATALOG_INITIAL_CAPACITY 64
+
+// Fibonacci hashing of the product id into a power-of-two table
+static int slot_for(const ProductCatalog *catalog, int product_id) {
+    return (int)(((unsigned int)product_id * 2654435769u) & (unsigned int)(catalog->slot_count - 1));
+}
+
+static char *copy_string(const char *value) {
+    return value ? strdup(value) : NULL;
+}
+
+static void free_strings(Product *product) {
+    free(product->product_name);
+    free(product->description);
+    free(product->category);
+}
+
+// Low-stock heap
+
+static long long shortfall(const Product *product) {
+    return (long long)product->reorder_level - product->stock_quantity;
+}
+
+// Heap order: larger shortfall first, then lower product id
+static int heap_before(const ProductCatalog *catalog, int a, int b) {
+    const Product *pa = &catalog->products[catalog->low_stock[a]];
+    const Product *pb = &catalog->products[catalog->low_stock[b]];
+    long long sa = shortfall(pa), sb = shortfall(pb);
+    return sa != sb ? sa > sb : pa->product_id < pb->product_id;
+}
+
+static void heap_swap(ProductCatalog *catalog, int a, int b) {
+    int record = catalog->low_stock[a];
+    catalog->low_stock[a] = catalog->low_stock[b];
+    catalog->low_stock[b] = record;
+    catalog->heap_positions[catalog->low_stock[a]] = a;
+    catalog->heap_positions[catalog->low_stock[b]] = b;
+}
+
+static void sift_up(ProductCatalog *catalog, int position) {
+    while (position > 0) {
+        int parent = (position - 1) / 2;
+        if (!heap_before(catalog, position, parent)) {
+            break;
+        }
+        heap_swap(catalog, position, parent);
+        position = parent;
+    }
+}
+
+static void sift_down(ProductCatalog *catalog, int position) {
+    for (;;) {
+        int best = position;
+        int left = 2 * position + 1;
+        int right = left + 1;
+        if (left < catalog->low_stock_count && heap_before(catalog, left, best)) {
+            best = left;
+        }
+        if (right < catalog->low_stock_count && heap_before(catalog, right, best)) {
+            best = right;
+        }
+        if (best == position) {
+            break;
+        }
+        heap_swap(catalog, position, best);
+        position = best;
+    }
+}
+
+static void heap_remove(ProductCatalog *catalog, int index) {
+    int position = catalog->heap_positions[index];
+    int last = --catalog->low_stock_count;
+    catalog->heap_positions[index] = -1;
+    if (position == last) {
+        return;
+    }
+    int moved = catalog->low_stock[last];
+    catalog->low_stock[position] = moved;
+    catalog->heap_positions[moved] = position;
+    sift_up(catalog, position);
+    sift_down(catalog, catalog->heap_positions[moved]);
+}
+
+// Add, move or drop the record at index after its stock or reorder level changed
+static void heap_update(ProductCatalog *catalog, int index) {
+    int position = catalog->heap_positions[index];
+    if (shortfall(&catalog->products[index]) <= 0) {
+        if (position >= 0) {
+            heap_remove(catalog, index);
+        }
+        return;
+    }
+    if (position < 0) {
+        position = catalog->low_stock_count++;
+        catalog->low_stock[position] = index;
+        catalog->heap_positions[index] = position;
+    }
+    sift_up(catalog, position);
+    sift_down(catalog, catalog->heap_positions[index]);
+}
+
+// Find the slot holding product_id, or the empty slot where it would go
+static int probe(const ProductCatalog *catalog, int product_id) {
+    int slot = slot_for(catalog, product_id);
+    while (catalog->slots[slot].index >= 0 && catalog->slots[slot].product_id != product_id) {
+        slot = (slot + 1) & (catalog->slot_count - 1);
+    }
+    return slot;
+}
+
+// Allocate a table of slot_count empty slots and rehash every record into it
+static int rebuild_slots(ProductCatalog *catalog, int slot_count) {
+    CatalogSlot *slots = malloc(sizeof(CatalogSlot) * slot_count);
+    if (!slots) {
+        fprintf(stderr, "Out of memory growing product catalog\n");
+        return -1;
+    }
+    for (int i = 0; i < slot_count; i++) {
+        slots[i].index = -1;
+    }
+
+    free(catalog->slots);
+    catalog->slots = slots;
+    catalog->slot_count = slot_count;
+
+    for (int i = 0; i < catalog->count; i++) {
+        int slot = probe(catalog, catalog->products[i].product_id);
+        catalog->slots[slot].product_id = catalog->products[i].product_id;
+        catalog->slots[slot].index = i;
+    }
+    return 0;
+}
+
+int catalog_init(ProductCatalog *catalog) {
+    memset(catalog, 0, sizeof(*catalog));
+    catalog->products = malloc(sizeof(Product) * CATALOG_INITIAL_CAPACITY);
+    catalog->low_stock = malloc(sizeof(int) * CATALOG_INITIAL_CAPACITY);
+    catalog->heap_positions = malloc(sizeof(int) * CATALOG_INITIAL_CAPACITY);
+    if (!catalog->products || !catalog->low_stock || !catalog->heap_positions) {
+        catalog_free(catalog);
+        fprintf(stderr, "Out of memory allocating product catalog\n");
+        return -1;
+    }
+    catalog->capacity = CATALOG_INITIAL_CAPACITY;
+    if (rebuild_slots(catalog, CATALOG_INITIAL_CAPACITY * 2) != 0) {
+        catalog_free(catalog);
+        return -1;
+    }
+    return 0;
+}
+
+void catalog_free(ProductCatalog *catalog) {
+    catalog_clear(catalog);
+    free(catalog->products);
+    free(catalog->slots);
+    free(catalog->low_stock);
+    free(catalog->heap_positions);
+    memset(catalog, 0, sizeof(*catalog));
+}
+
+void catalog_clear(ProductCatalog *catalog) {
+    for (int i = 0; i < catalog->count; i++) {
+        free_strings(&catalog->products[i]);
+    }
+    catalog->count = 0;
+    catalog->low_stock_count = 0;
+    for (int i = 0; i < catalog->slot_count; i++) {
+        catalog->slots[i].index = -1;
+    }
+}
+
+int catalog_put(ProductCatalog *catalog, const Product *product) {
+    Product copy = *product;
+    copy.product_name = copy_string(product->product_name);
+    copy.description = copy_string(product->description);
+    copy.category = copy_string(product->category);
+
+    int slot = probe(catalog, product->product_id);
+    if (catalog->slots[slot].index >= 0) {
+        Product *existing = &catalog->products[catalog->slots[slot].index];
+        free_strings(existing);
+        *existing = copy;
+        heap_update(catalog, catalog->slots[slot].index);
+        return 0;
+    }
+
+    if (catalog->count == catalog->capacity) {
+        Product *grown = realloc(catalog->products, sizeof(Product) * catalog->capacity * 2);
+        if (grown) {
+            catalog->products = grown;
+        }
+        int *heap = grown ? realloc(catalog->low_stock, sizeof(int) * catalog->capacity * 2) : NULL;
+        if (heap) {
+            catalog->low_stock = heap;
+        }
+        int *positions = heap ? realloc(catalog->heap_positions, sizeof(int) * catalog->capacity * 2) : NULL;
+        if (!positions) {
+            fprintf(stderr, "Out of memory growing product catalog\n");
+            free_strings(&copy);
+            return -1;
+        }
+        catalog->heap_positions = positions;
+        catalog->capacity *= 2;
+    }
+
+    // Keep the load factor at or below one half
+    if ((catalog->count + 1) * 2 > catalog->slot_count) {
+        if (rebuild_slots(catalog, catalog->slot_count * 2) != 0) {
+            free_strings(&copy);
+            return -1;
+        }
+        slot = probe(catalog, product->product_id);
+    }
+
+    catalog->products[catalog->count] = copy;
+    catalog->slots[slot].product_id = product->product_id;
+    catalog->slots[slot].index = catalog->count;
+    catalog->heap_positions[catalog->count] = -1;
+    catalog->count++;
+    heap_update(catalog, catalog->count - 1);
+    return 0;
+}
+
+int catalog_remove(ProductCatalog *catalog, int product_id) {
+    int mask = catalog->slot_count - 1;
+    int slot = probe(catalog, product_id);
+    int index = catalog->slots[slot].index;
+    if (index < 0) {
+        return -1;
+    }
+
+    if (catalog->heap_positions[index] >= 0) {
+        heap_remove(catalog, index);
+    }
+
+    // Keep the record array dense by moving the last record into the hole
+    free_strings(&catalog->products[index]);
+    int last = catalog->count - 1;
+    if (index != last) {
+        catalog->products[index] = catalog->products[last];
+        catalog->slots[probe(catalog, catalog->products[index].product_id)].index = index;
+        catalog->heap_positions[index] = catalog->heap_positions[last];
+        if (catalog->heap_positions[index] >= 0) {
+            catalog->low_stock[catalog->heap_positions[index]] = index;
+        }
+    }
+    catalog->count--;
+
+    // Backward-shift deletion keeps probe chains intact without tombstones
+    catalog->slots[slot].index = -1;
+    int next = (slot + 1) & mask;
+    while (catalog->slots[next].index >= 0) {
+        int home = slot_for(catalog, catalog->slots[next].product_id);
+        if (((next - home) & mask) >= ((next - slot) & mask)) {
+            catalog->slots[slot] = catalog->slots[next];
+            catalog->slots[next].index = -1;
+            slot = next;
+        }
+        next = (next + 1) & mask;
+    }
+    return 0;
+}
+
+Product *catalog_find(const ProductCatalog *catalog, int product_id) {
+    int index = catalog->slots[probe(catalog, product_id)].index;
+    return index >= 0 ? &catalog->products[index] : NULL;
+}
+
+Product *catalog_set_stock(ProductCatalog *catalog, int product_id, int stock_quantity, int *crossed) {
+    int index = catalog->slots[probe(catalog, product_id)].index;
+    *crossed = 0;
+    if (index < 0) {
+        return NULL;
+    }
+
+    Product *product = &catalog->products[index];
+    int was_low = product->stock_quantity < product->reorder_level;
+    product->stock_quantity = stock_quantity;
+    int is_low = product->stock_quantity < product->reorder_level;
+    if (was_low != is_low) {
+        *crossed = is_low ? 1 : -1;
+    }
+    if (was_low || is_low) {
+        heap_update(catalog, index);
+    }
+    return product;
+}
+
+int catalog_low_stock_count(const ProductCatalog *catalog) {
+    return catalog->low_stock_count;
+}
+
+static int compare_low_stock(const void *a, const void *b) {
+    const Product *pa = *(const Product *const *)a;
+    const Product *pb = *(const Product *const *)b;
+    long long sa = shortfall(pa), sb = shortfall(pb);
+    if (sa != sb) {
+        return sa > sb ? -1 : 1;
+    }
+    return (pa->product_id > pb->product_id) - (pa->product_id < pb->product_id);
+}
+
+int catalog_low_stock(const ProductCatalog *catalog, const Product **products) {
+    for (int i = 0; i < catalog->low_stock_count; i++) {
+        products[i] = &catalog->products[catalog->low_stock[i]];
+    }
+    // The heap only orders its root; sort the (usually short) list for output
+    qsort(products, catalog->low_stock_count, sizeof(*products), compare_low_stock);
+    return catalog->low_stock_count;
+}
@@ -0,0 +1,69 @@
+#ifndef CATALOG_H
+#define CATALOG_H
+
+// Product record as stored in the Products table
+typedef struct {
+    int product_id;
+    char *product_name;
+    char *description;
+    char *category;
+    double cost_price;
+    double selling_price;
+    int stock_quantity;
+    int reorder_level;
+} Product;
+
+// Hash slot mapping a product_id to its position in the record array
+typedef struct {
+    int product_id;
+    int index;  // -1 when the slot is empty
+} CatalogSlot;
+
+// In-memory product catalog
+// Records live in one contiguous array; an open-addressing table (linear
+// probing, power-of-two size) maps product_id to the record's position.
+// Products below their reorder level are also kept in a binary max-heap
+// keyed by the shortfall (reorder_level - stock_quantity), so the low-stock
+// set is maintained on every change instead of being found by a scan.
+typedef struct {
+    Product *products;
+    int count;
+    int capacity;
+    CatalogSlot *slots;
+    int slot_count;
+    int *low_stock;       // heap of record positions, largest shortfall first
+    int low_stock_count;
+    int *heap_positions;  // per record: its position in low_stock, or -1
+} ProductCatalog;
+
+// Initialize an empty catalog
+int catalog_init(ProductCatalog *catalog);
+
+// Free all records and the table
+void catalog_free(ProductCatalog *catalog);
+
+// Remove every record, keeping the allocated memory
+void catalog_clear(ProductCatalog *catalog);
+
+// Insert or replace a product (strings are copied)
+int catalog_put(ProductCatalog *catalog, const Product *product);
+
+// Remove a product; returns -1 if it is not in the catalog
+int catalog_remove(ProductCatalog *catalog, int product_id);
+
+// Look up a product; the record stays valid until the catalog is next modified
+Product *catalog_find(const ProductCatalog *catalog, int product_id);
+
+// Set a product's stock and reposition it in the low-stock heap. *crossed is
+// set to 1 when the product drops below its reorder level, -1 when it climbs
+// back to it, 0 otherwise. Returns NULL if the product is not in the catalog.
+Product *catalog_set_stock(ProductCatalog *catalog, int product_id, int stock_quantity, int *crossed);
+
+// Number of products below their reorder level
+int catalog_low_stock_count(const ProductCatalog *catalog);
+
+// Fill products (catalog_low_stock_count entries) with the products below
+// their reorder level, largest shortfall first; returns the count
+int catalog_low_stock(const ProductCatalog *catalog, const Product **products);
+
+#endif // CATALOG_H
@@ -0,0 +1,303 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include "commit_queue.h"
+
+// Arguments of a queued add_transaction, copied so the caller's buffers can go away
+typedef struct {
+    int product_id;
+    char transaction_type[8];
+    int quantity;
+    char transaction_date[32];
+    int customer_supplier_id;
+} QueuedTransaction;
+
+void commit_queue_default_options(CommitQueueOptions *options) {
+    options->batch_size = 512;
+    options->flush_interval_ms = 5;
+    database_config_for_profile(&options->config, PROFILE_BALANCED);
+    options->config.synchronous = "FULL";
+    options->group_hook = NULL;
+    options->group_context = NULL;
+}
+
+// Producer side: one atomic exchange, no locks
+static void push_entry(CommitQueue *queue, CommitEntry *entry) {
+    atomic_store_explicit(&entry->next, NULL, memory_order_relaxed);
+    CommitEntry *previous = atomic_exchange_explicit(&queue->head, entry, memory_order_acq_rel);
+    atomic_store_explicit(&previous->next, entry, memory_order_release);
+}
+
+// Consumer side; returns NULL when empty or when a producer is between its
+// exchange and its link (the entry is picked up on the next pass)
+static CommitEntry *pop_entry(CommitQueue *queue) {
+    CommitEntry *tail = queue->tail;
+    CommitEntry *next = atomic_load_explicit(&tail->next, memory_order_acquire);
+
+    if (tail == &queue->stub) {
+        if (!next) {
+            return NULL;
+        }
+        queue->tail = next;
+        tail = next;
+        next = atomic_load_explicit(&tail->next, memory_order_acquire);
+    }
+    if (next) {
+        queue->tail = next;
+        return tail;
+    }
+    if (tail != atomic_load_explicit(&queue->head, memory_order_acquire)) {
+        return NULL;
+    }
+
+    // tail is the last entry: park the stub behind it so it can be detached
+    push_entry(queue, &queue->stub);
+    next = atomic_load_explicit(&tail->next, memory_order_acquire);
+    if (next) {
+        queue->tail = next;
+        return tail;
+    }
+    return NULL;
+}
+
+static void wait_for_work(CommitQueue *queue) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_nsec += (long)queue->options.flush_interval_ms * 1000000L;
+    deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+    deadline.tv_nsec %= 1000000000L;
+
+    pthread_mutex_lock(&queue->wake_lock);
+    while (atomic_load(&queue->pending) < queue->options.batch_size && !atomic_load(&queue->stopping)) {
+        if (pthread_cond_timedwait(&queue->wake, &queue->wake_lock, &deadline) == ETIMEDOUT) {
+            break;
+        }
+    }
+    pthread_mutex_unlock(&queue->wake_lock);
+}
+
+// Apply one group inside a transaction and report every entry's outcome
+static void commit_group(CommitQueue *queue, CommitEntry *group) {
+    Database *db = &queue->db;
+    int committed = begin_transaction(db) == 0;
+
+    for (CommitEntry *entry = group; entry; entry = atomic_load_explicit(&entry->next, memory_order_relaxed)) {
+        entry->status = committed ? entry->operation(db, entry->arg) : -1;
+        if (committed && sqlite3_get_autocommit(db->connection)) {
+            // The error rolled back the whole group (I/O error, disk full); the
+            // rest must not run in autocommit and land while the group fails
+            fprintf(stderr, "Commit group rolled back: %s\n", sqlite3_errmsg(db->connection));
+            rollback_transaction(db);
+            committed = 0;
+        }
+    }
+    if (committed && commit_transaction(db) != 0) {
+        rollback_transaction(db);
+        committed = 0;
+    }
+    if (committed) {
+        queue->groups_committed++;
+    }
+    if (queue->options.group_hook) {
+        queue->options.group_hook(db, queue->options.group_context);
+    }
+
+    for (CommitEntry *entry = group; entry;) {
+        CommitEntry *next = atomic_load_explicit(&entry->next, memory_order_relaxed);
+        int status = committed ? entry->status : -1;
+        if (status == 0) {
+            queue->entries_committed++;
+        } else {
+            queue->entries_failed++;
+        }
+        if (entry->callback) {
+            entry->callback(status, entry->context);
+        }
+        if (entry->owns_arg) {
+            free(entry->arg);
+        }
+        free(entry);
+        entry = next;
+    }
+}
+
+static void *committer_main(void *arg) {
+    CommitQueue *queue = arg;
+
+    for (;;) {
+        if (atomic_load(&queue->pending) < queue->options.batch_size) {
+            if (atomic_load(&queue->stopping) && atomic_load(&queue->pending) == 0) {
+                break;
+            }
+            wait_for_work(queue);
+        }
+
+        // Detach up to batch_size entries, relinking them as a private list
+        CommitEntry *group = NULL;
+        CommitEntry *last = NULL;
+        int count = 0;
+        CommitEntry *entry;
+        while (count < queue->options.batch_size && (entry = pop_entry(queue)) != NULL) {
+            atomic_store_explicit(&entry->next, NULL, memory_order_relaxed);
+            if (last) {
+                atomic_store_explicit(&last->next, entry, memory_order_relaxed);
+            } else {
+                group = entry;
+            }
+            last = entry;
+            count++;
+        }
+        if (count == 0) {
+            continue;
+        }
+        atomic_fetch_sub(&queue->pending, count);
+        commit_group(queue, group);
+    }
+    return NULL;
+}
+
+int commit_queue_open(CommitQueue *queue, const char *db_name, const CommitQueueOptions *options) {
+    memset(queue, 0, sizeof(*queue));
+    queue->options = *options;
+    if (queue->options.batch_size < 1) {
+        queue->options.batch_size = 1;
+    }
+    if (queue->options.flush_interval_ms < 1) {
+        queue->options.flush_interval_ms = 1;
+    }
+    queue->options.config.read_only = 0;
+
+    if (initialize_database(&queue->db, db_name, &queue->options.config) != 0) {
+        return -1;
+    }
+
+    atomic_init(&queue->stub.next, NULL);
+    atomic_init(&queue->head, &queue->stub);
+    queue->tail = &queue->stub;
+    atomic_init(&queue->pending, 0);
+    atomic_init(&queue->stopping, 0);
+    pthread_mutex_init(&queue->wake_lock, NULL);
+    pthread_cond_init(&queue->wake, NULL);
+
+    if (queue->options.group_hook) {
+        queue->options.group_hook(&queue->db, queue->options.group_context);
+    }
+    if (pthread_create(&queue->thread, NULL, committer_main, queue) != 0) {
+        fprintf(stderr, "Failed to start the commit thread\n");
+        pthread_mutex_destroy(&queue->wake_lock);
+        pthread_cond_destroy(&queue->wake);
+        close_database(&queue->db);
+        return -1;
+    }
+    return 0;
+}
+
+void commit_queue_close(CommitQueue *queue) {
+    pthread_mutex_lock(&queue->wake_lock);
+    atomic_store(&queue->stopping, 1);
+    pthread_cond_signal(&queue->wake);
+    pthread_mutex_unlock(&queue->wake_lock);
+
+    pthread_join(queue->thread, NULL);
+    pthread_mutex_destroy(&queue->wake_lock);
+    pthread_cond_destroy(&queue->wake);
+    close_database(&queue->db);
+}
+
+static int submit_entry(CommitQueue *queue, CommitOperation operation, void *arg, int owns_arg,
+                        CommitCallback callback, void *context) {
+    CommitEntry *entry = malloc(sizeof(CommitEntry));
+    if (!entry) {
+        return -1;
+    }
+    entry->operation = operation;
+    entry->arg = arg;
+    entry->owns_arg = owns_arg;
+    entry->callback = callback;
+    entry->context = context;
+
+    // Count before checking for close: the committer reads stopping and then
+    // pending, so either it sees this entry or this sees stopping and backs out
+    int pending = atomic_fetch_add(&queue->pending, 1) + 1;
+    if (atomic_load(&queue->stopping)) {
+        atomic_fetch_sub(&queue->pending, 1);
+        free(entry);
+        return -1;
+    }
+    push_entry(queue, entry);
+
+    if (pending == queue->options.batch_size) {
+        pthread_mutex_lock(&queue->wake_lock);
+        pthread_cond_signal(&queue->wake);
+        pthread_mutex_unlock(&queue->wake_lock);
+    }
+    return 0;
+}
+
+int commit_queue_submit(CommitQueue *queue, CommitOperation operation, void *arg,
+                        CommitCallback callback, void *context) {
+    return submit_entry(queue, operation, arg, 0, callback, context);
+}
+
+static int apply_transaction(Database *db, void *arg) {
+    QueuedTransaction *t = arg;
+    return add_transaction(db, t->product_id, t->transaction_type, t->quantity,
+                           t->transaction_date, t->customer_supplier_id);
+}
+
+int commit_queue_add_transaction(CommitQueue *queue, int product_id, const char *transaction_type,
+                                 int quantity, const char *transaction_date, int customer_supplier_id,
+                                 CommitCallback callback, void *context) {
+    if (strlen(transaction_type) >= sizeof(((QueuedTransaction *)0)->transaction_type) ||
+        strlen(transaction_date) >= sizeof(((QueuedTransaction *)0)->transaction_date)) {
+        return -1;
+    }
+    QueuedTransaction *t = malloc(sizeof(QueuedTransaction));
+    if (!t) {
+        return -1;
+    }
+    t->product_id = product_id;
+    strcpy(t->transaction_type, transaction_type);
+    t->quantity = quantity;
+    strcpy(t->transaction_date, transaction_date);
+    t->customer_supplier_id = customer_supplier_id;
+
+    if (submit_entry(queue, apply_transaction, t, 1, callback, context) != 0) {
+        free(t);
+        return -1;
+    }
+    return 0;
+}
+
+void commit_ticket_init(CommitTicket *ticket) {
+    pthread_mutex_init(&ticket->lock, NULL);
+    pthread_cond_init(&ticket->done_cond, NULL);
+    ticket->done = 0;
+    ticket->status = -1;
+}
+
+void commit_ticket_complete(int status, void *context) {
+    CommitTicket *ticket = context;
+    pthread_mutex_lock(&ticket->lock);
+    ticket->status = status;
+    ticket->done = 1;
+    pthread_cond_signal(&ticket->done_cond);
+    pthread_mutex_unlock(&ticket->lock);
+}
+
+int commit_ticket_wait(CommitTicket *ticket) {
+    pthread_mutex_lock(&ticket->lock);
+    while (!ticket->done) {
+        pthread_cond_wait(&ticket->done_cond, &ticket->lock);
+    }
+    int status = ticket->status;
+    pthread_mutex_unlock(&ticket->lock);
+    return status;
+}
+
+void commit_ticket_destroy(CommitTicket *ticket) {
+    pthread_mutex_destroy(&ticket->lock);
+    pthread_cond_destroy(&ticket->done_cond);
+}
@@ -0,0 +1,106 @@
+#ifndef COMMIT_QUEUE_H
+#define COMMIT_QUEUE_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include "database.h"
+
+// Asynchronous group commit.
+//
+// Producers push writes onto a lock-free multi-producer queue and return
+// immediately. A committer thread that owns the writer connection drains the
+// queue every flush_interval_ms, or as soon as batch_size entries are pending,
+// and applies everything it took inside one SQL transaction, so a single sync
+// covers the whole group. Each entry's completion callback runs on the
+// committer thread after COMMIT returns, with 0 if the write is committed and
+// -1 if it was rejected or the group failed to commit.
+//
+// Commits are durable to the level of the connection's synchronous setting;
+// the default options use synchronous=FULL so an acknowledged write survives
+// power loss, and the group amortizes that sync across all of its entries.
+
+// Completion callback; runs on the committer thread and must not block
+typedef void (*CommitCallback)(int status, void *context);
+
+// A write applied on the committer's connection; returns 0 on success
+typedef int (*CommitOperation)(Database *db, void *arg);
+
+// Reads the committer's connection between groups, e.g. to publish a copy of
+// its catalog; runs on the committer thread and must not block
+typedef void (*CommitGroupHook)(Database *db, void *context);
+
+typedef struct CommitEntry {
+    _Atomic(struct CommitEntry *) next;
+    CommitOperation operation;
+    void *arg;
+    CommitCallback callback;
+    void *context;
+    int owns_arg;  // free arg once the entry completes
+    int status;    // result of operation, set by the committer
+} CommitEntry;
+
+typedef struct {
+    int batch_size;          // most entries folded into one commit
+    int flush_interval_ms;   // longest an entry waits for a group to fill
+    DatabaseConfig config;   // committer connection settings
+    // Called once by commit_queue_open, then after every group has committed
+    // or rolled back and before its callbacks run; NULL for none
+    CommitGroupHook group_hook;
+    void *group_context;
+} CommitQueueOptions;
+
+typedef struct {
+    CommitQueueOptions options;
+    Database db;  // committer connection; only touched by the committer thread
+
+    // Intrusive MPSC queue: producers swap head, the committer walks from tail
+    _Atomic(CommitEntry *) head;
+    CommitEntry *tail;
+    CommitEntry stub;
+    atomic_int pending;
+
+    // Only used to wake the committer early when a batch fills up
+    pthread_mutex_t wake_lock;
+    pthread_cond_t wake;
+    atomic_int stopping;
+    pthread_t thread;
+
+    // Totals, read after commit_queue_close
+    long long entries_committed;
+    long long entries_failed;
+    long long groups_committed;
+} CommitQueue;
+
+// Completion handle for callers that want to block until their write is durable
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t done_cond;
+    int done;
+    int status;
+} CommitTicket;
+
+// Fill options with defaults (512 entries or 5 ms per group, balanced profile with FULL sync, no hook)
+void commit_queue_default_options(CommitQueueOptions *options);
+
+// Open the committer connection and start the committer thread
+int commit_queue_open(CommitQueue *queue, const char *db_name, const CommitQueueOptions *options);
+
+// Commit everything still queued, stop the thread and close the connection
+void commit_queue_close(CommitQueue *queue);
+
+// Queue an arbitrary write; callback may be NULL. Returns -1 if the queue is closing.
+int commit_queue_submit(CommitQueue *queue, CommitOperation operation, void *arg,
+                        CommitCallback callback, void *context);
+
+// Queue add_transaction with copies of the arguments; same contract as commit_queue_submit
+int commit_queue_add_transaction(CommitQueue *queue, int product_id, const char *transaction_type,
+                                 int quantity, const char *transaction_date, int customer_supplier_id,
+                                 CommitCallback callback, void *context);
+
+// Ticket helpers: pass commit_ticket_complete and the ticket as callback and context
+void commit_ticket_init(CommitTicket *ticket);
+void commit_ticket_complete(int status, void *context);
+int commit_ticket_wait(CommitTicket *ticket);  // returns the write's status
+void commit_ticket_destroy(CommitTicket *ticket);
+
+#endif // COMMIT_QUEUE_H
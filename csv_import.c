@@ -0,0 +1,554 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "csv_import.h"
+#include "metrics.h"
+
+#define CSV_MAX_FIELDS 16
+#define CSV_NUMBER_MAX 64
+#define STDIN_CHUNK (1 << 20)
+
+typedef enum {
+    COLUMN_ID,    // integer key; empty means "assign a new one"
+    COLUMN_TEXT,
+    COLUMN_REAL,
+    COLUMN_INT
+} ImportColumnKind;
+
+typedef struct {
+    const char *name;
+    ImportColumnKind kind;
+    int required;
+} ImportColumn;
+
+// Column i binds parameter i + 1 of sql
+// Tables with triggers stage their rows: sql fills a temporary table created
+// by staging_sql, and flush_sql moves the staged rows over in one statement
+// per batch. The product search triggers write to an FTS5 index, which flushes
+// its pending terms at the end of every statement; one row per statement
+// makes that about ten times slower than the insert itself.
+typedef struct {
+    const char *label;
+    const ImportColumn *columns;
+    int column_count;
+    const char *sql;
+    int reload_catalog;
+    const char *staging_sql;  // NULL: sql writes the table directly
+    const char *flush_sql;
+} ImportTable;
+
+static const ImportColumn product_import_columns[] = {
+    {"product_id", COLUMN_ID, 0},
+    {"product_name", COLUMN_TEXT, 1},
+    {"description", COLUMN_TEXT, 0},
+    {"category", COLUMN_TEXT, 0},
+    {"cost_price", COLUMN_REAL, 1},
+    {"selling_price", COLUMN_REAL, 1},
+    {"stock_quantity", COLUMN_INT, 1},
+    {"reorder_level", COLUMN_INT, 1},
+};
+
+static const ImportColumn supplier_import_columns[] = {
+    {"supplier_id", COLUMN_ID, 0},
+    {"supplier_name", COLUMN_TEXT, 1},
+    {"contact_info", COLUMN_TEXT, 0},
+    {"address", COLUMN_TEXT, 0},
+};
+
+static const ImportTable product_import = {
+    "product",
+    product_import_columns,
+    (int)(sizeof(product_import_columns) / sizeof(product_import_columns[0])),
+    "INSERT INTO temp.ProductImport (product_id, product_name, description, category, cost_price, "
+    "selling_price, stock_quantity, reorder_level) VALUES (?1, ?2, ?3, ?4, ?5, ?6, ?7, ?8);",
+    1,
+    "CREATE TEMP TABLE IF NOT EXISTS ProductImport ("
+    "product_id INTEGER, "
+    "product_name TEXT NOT NULL, "
+    "description TEXT, "
+    "category TEXT, "
+    "cost_price REAL NOT NULL, "
+    "selling_price REAL NOT NULL, "
+    "stock_quantity INTEGER NOT NULL, "
+    "reorder_level INTEGER NOT NULL"
+    ");"
+    "DELETE FROM temp.ProductImport;",
+    // In file order, so a repeated id still ends with its last row
+    "INSERT INTO Products (product_id, product_name, description, category, cost_price, "
+    "selling_price, stock_quantity, reorder_level) "
+    "SELECT product_id, product_name, description, category, cost_price, "
+    "selling_price, stock_quantity, reorder_level FROM temp.ProductImport WHERE true ORDER BY rowid "
+    "ON CONFLICT (product_id) DO UPDATE SET product_name = excluded.product_name, "
+    "description = excluded.description, category = excluded.category, "
+    "cost_price = excluded.cost_price, selling_price = excluded.selling_price, "
+    "stock_quantity = excluded.stock_quantity, reorder_level = excluded.reorder_level;"
+    // Imported stock is a manual count: rows with an id start a new stock
+    // checkpoint (see create_stock_checkpoint), net of future-dated movements
+    "INSERT INTO StockCheckpoints (product_id, checkpoint_time, stock_quantity) "
+    "SELECT p.product_id, unixepoch('now'), p.stock_quantity - coalesce(("
+    "SELECT SUM(CASE t.transaction_type WHEN 1 THEN t.quantity WHEN 2 THEN -t.quantity ELSE 0 END) "
+    "FROM Transactions t WHERE t.product_id = p.product_id AND t.transaction_date > unixepoch('now')), 0) "
+    "FROM Products p WHERE p.product_id IN (SELECT product_id FROM temp.ProductImport) "
+    "ON CONFLICT (product_id, checkpoint_time) DO UPDATE SET stock_quantity = excluded.stock_quantity;"
+    "DELETE FROM temp.ProductImport;",
+};
+
+static const ImportTable supplier_import = {
+    "supplier",
+    supplier_import_columns,
+    (int)(sizeof(supplier_import_columns) / sizeof(supplier_import_columns[0])),
+    "INSERT INTO Suppliers (supplier_id, supplier_name, contact_info, address) "
+    "VALUES (?1, ?2, ?3, ?4) "
+    "ON CONFLICT (supplier_id) DO UPDATE SET supplier_name = excluded.supplier_name, "
+    "contact_info = excluded.contact_info, address = excluded.address;",
+    0,
+    NULL,
+    NULL,
+};
+
+// The whole input as one writable buffer
+typedef struct {
+    char *data;
+    size_t size;
+    int mapped;
+} CsvInput;
+
+// A field inside the input buffer; not NUL-terminated
+typedef struct {
+    const char *text;
+    int length;
+} CsvField;
+
+typedef struct {
+    char *cursor;
+    char *end;
+    long line;
+} CsvReader;
+
+static int read_all(int fd, CsvInput *input) {
+    size_t capacity = 0;
+
+    input->data = NULL;
+    input->size = 0;
+    input->mapped = 0;
+    for (;;) {
+        if (capacity - input->size < STDIN_CHUNK) {
+            capacity = capacity ? capacity * 2 : 4 * STDIN_CHUNK;
+            char *grown = realloc(input->data, capacity);
+            if (!grown) {
+                free(input->data);
+                fprintf(stderr, "Out of memory reading import input\n");
+                return -1;
+            }
+            input->data = grown;
+        }
+        ssize_t n = read(fd, input->data + input->size, capacity - input->size);
+        if (n < 0) {
+            perror("read");
+            free(input->data);
+            return -1;
+        }
+        if (n == 0) {
+            return 0;
+        }
+        input->size += (size_t)n;
+    }
+}
+
+// Regular files are mapped privately: unquoting writes only touch our copy
+static int open_input(const char *path, CsvInput *input) {
+    if (strcmp(path, "-") == 0) {
+        return read_all(STDIN_FILENO, input);
+    }
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror(path);
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        perror(path);
+        close(fd);
+        return -1;
+    }
+
+    int status = 0;
+    if (!S_ISREG(st.st_mode)) {
+        status = read_all(fd, input);
+    } else if (st.st_size == 0) {
+        input->data = NULL;
+        input->size = 0;
+        input->mapped = 0;
+    } else {
+        input->data = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        if (input->data == MAP_FAILED) {
+            perror(path);
+            status = -1;
+        } else {
+            input->size = (size_t)st.st_size;
+            input->mapped = 1;
+            madvise(input->data, input->size, MADV_SEQUENTIAL);
+        }
+    }
+    close(fd);
+    return status;
+}
+
+static void close_input(CsvInput *input) {
+    if (input->mapped) {
+        munmap(input->data, input->size);
+    } else {
+        free(input->data);
+    }
+}
+
+// Split the next record into fields, unquoting in place.
+// Returns the number of fields, 0 at the end of input, or -1 for a record with
+// an unterminated quote or more than max_fields fields (the record is consumed).
+static int csv_next_record(CsvReader *reader, CsvField *fields, int max_fields) {
+    char *p = reader->cursor;
+    char *end = reader->end;
+    int count = 0;
+    int malformed = 0;
+
+    if (p >= end) {
+        return 0;
+    }
+    reader->line++;
+
+    for (;;) {
+        char *start = p;
+        char *field_end;
+
+        if (p < end && *p == '"') {
+            // Quoted: shift text left over each doubled quote
+            char *out = ++p;
+            start = out;
+            for (;;) {
+                if (p >= end) {
+                    malformed = 1;
+                    break;
+                }
+                if (*p == '"') {
+                    if (p + 1 < end && p[1] == '"') {
+                        *out++ = '"';
+                        p += 2;
+                        continue;
+                    }
+                    p++;
+                    break;
+                }
+                if (*p == '\n') {
+                    reader->line++;
+                }
+                *out++ = *p++;
+            }
+            field_end = out;
+            // Anything between the closing quote and the separator is dropped
+            while (p < end && *p != ',' && *p != '\n') {
+                p++;
+            }
+        } else {
+            while (p < end && *p != ',' && *p != '\n') {
+                p++;
+            }
+            field_end = p;
+            if (field_end > start && field_end[-1] == '\r') {
+                field_end--;
+            }
+        }
+
+        if (count < max_fields) {
+            fields[count].text = start;
+            fields[count].length = (int)(field_end - start);
+        } else {
+            malformed = 1;
+        }
+        count++;
+
+        if (p < end && *p == ',') {
+            p++;
+            continue;
+        }
+        if (p < end) {
+            p++;  // newline
+        }
+        break;
+    }
+
+    reader->cursor = p;
+    return malformed ? -1 : count;
+}
+
+static int field_equals(const CsvField *field, const char *name) {
+    size_t length = strlen(name);
+    return (size_t)field->length == length && memcmp(field->text, name, length) == 0;
+}
+
+// Strict numeric parsing; the field is copied so strto* sees a terminated string.
+// Only plain decimal notation is accepted: strtod would also take "nan", "inf"
+// and hex floats, and out-of-range values are rejected rather than clamped.
+static int parse_number(const char *text, size_t length, ImportColumnKind kind, long long *integer,
+                        double *real) {
+    char number[CSV_NUMBER_MAX];
+    char *end;
+
+    if (length == 0 || length >= CSV_NUMBER_MAX) {
+        return -1;
+    }
+    memcpy(number, text, length);
+    number[length] = '\0';
+    if (number[strspn(number, kind == COLUMN_REAL ? " \t+-.0123456789eE" : " \t+-0123456789")] != '\0') {
+        return -1;
+    }
+
+    errno = 0;
+    if (kind == COLUMN_REAL) {
+        *real = strtod(number, &end);
+        if (!isfinite(*real)) {
+            return -1;
+        }
+    } else {
+        *integer = strtoll(number, &end, 10);
+    }
+    if (errno == ERANGE) {
+        return -1;
+    }
+    while (*end == ' ' || *end == '\t') {
+        end++;
+    }
+    return *end == '\0' && end != number ? 0 : -1;
+}
+
+int parse_strict_integer(const char *text, size_t length, long long *value) {
+    double unused;
+    return parse_number(text, length, COLUMN_INT, value, &unused);
+}
+
+int parse_strict_real(const char *text, size_t length, double *value) {
+    long long unused;
+    return parse_number(text, length, COLUMN_REAL, &unused, value);
+}
+
+// Bind one record; returns 0 or -1 with a reason for the error report
+static int bind_record(sqlite3_stmt *stmt, const ImportTable *table, const int *field_of_column,
+                       const CsvField *fields, int field_count, const char **reason) {
+    for (int i = 0; i < table->column_count; i++) {
+        const ImportColumn *column = &table->columns[i];
+        int f = field_of_column[i];
+        const CsvField *field = f >= 0 && f < field_count ? &fields[f] : NULL;
+        long long integer;
+        double real;
+
+        if (!field || field->length == 0) {
+            if (column->required) {
+                *reason = column->name;
+                return -1;
+            }
+            sqlite3_bind_null(stmt, i + 1);
+            continue;
+        }
+
+        switch (column->kind) {
+            case COLUMN_TEXT:
+                sqlite3_bind_text(stmt, i + 1, field->text, field->length, SQLITE_STATIC);
+                break;
+            case COLUMN_REAL:
+                if (parse_number(field->text, field->length, column->kind, &integer, &real) != 0) {
+                    *reason = column->name;
+                    return -1;
+                }
+                sqlite3_bind_double(stmt, i + 1, real);
+                break;
+            case COLUMN_ID:
+            case COLUMN_INT:
+                if (parse_number(field->text, field->length, column->kind, &integer, &real) != 0 ||
+                    (column->kind == COLUMN_ID && integer < 1)) {
+                    *reason = column->name;
+                    return -1;
+                }
+                sqlite3_bind_int64(stmt, i + 1, integer);
+                break;
+        }
+    }
+    return 0;
+}
+
+// Move staged rows into their table; the staging table is emptied either way
+static int flush_staged_rows(Database *db, const ImportTable *table) {
+    char *err_msg = NULL;
+
+    if (!table->flush_sql) {
+        return 0;
+    }
+    if (sqlite3_exec(db->connection, table->flush_sql, 0, 0, &err_msg) != SQLITE_OK) {
+        fprintf(stderr, "Failed to write staged %s rows: %s\n", table->label, err_msg);
+        sqlite3_free(err_msg);
+        sqlite3_exec(db->connection, table->staging_sql, 0, 0, NULL);
+        return -1;
+    }
+    return 0;
+}
+
+// Map header names to column positions; unknown header columns are ignored
+static int map_header(const ImportTable *table, const CsvField *fields, int field_count, int *field_of_column) {
+    for (int i = 0; i < table->column_count; i++) {
+        field_of_column[i] = -1;
+        for (int f = 0; f < field_count; f++) {
+            if (field_equals(&fields[f], table->columns[i].name)) {
+                field_of_column[i] = f;
+                break;
+            }
+        }
+        if (field_of_column[i] < 0 && table->columns[i].required) {
+            fprintf(stderr, "Import header is missing the %s column\n", table->columns[i].name);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int import_csv(Database *db, const ImportTable *table, const char *path, int batch_size,
+                      BulkIngestStats *stats) {
+    CsvInput input;
+    CsvField fields[CSV_MAX_FIELDS];
+    int field_of_column[CSV_MAX_FIELDS];
+    sqlite3_stmt *stmt;
+
+    memset(stats, 0, sizeof(*stats));
+    double started = metrics_now_seconds();
+
+    if (open_input(path, &input) != 0) {
+        return -1;
+    }
+    CsvReader reader = {input.data, input.data + input.size, 0};
+
+    // Header
+    int field_count;
+    do {
+        field_count = csv_next_record(&reader, fields, CSV_MAX_FIELDS);
+    } while (field_count == 1 && fields[0].length == 0);
+    if (field_count <= 0 || map_header(table, fields, field_count, field_of_column) != 0) {
+        if (field_count <= 0) {
+            fprintf(stderr, "Import input has no header row\n");
+        }
+        close_input(&input);
+        return -1;
+    }
+
+    char *err_msg = NULL;
+    if (table->staging_sql && sqlite3_exec(db->connection, table->staging_sql, 0, 0, &err_msg) != SQLITE_OK) {
+        fprintf(stderr, "Failed to create staging table: %s\n", err_msg);
+        sqlite3_free(err_msg);
+        close_input(&input);
+        return -1;
+    }
+    if (sqlite3_prepare_v3(db->connection, table->sql, -1, SQLITE_PREPARE_PERSISTENT, &stmt, NULL) != SQLITE_OK) {
+        fprintf(stderr, "Failed to prepare statement: %s\n", sqlite3_errmsg(db->connection));
+        close_input(&input);
+        return -1;
+    }
+
+    int in_batch = 0;
+    int rows_in_batch = 0;
+    int status = 0;
+    for (;;) {
+        long line_number = reader.line + 1;
+        field_count = csv_next_record(&reader, fields, CSV_MAX_FIELDS);
+        if (field_count == 0) {
+            break;
+        }
+        if (field_count == 1 && fields[0].length == 0) {
+            continue;  // blank line
+        }
+        stats->rows_read++;
+
+        const char *reason = NULL;
+        if (field_count < 0) {
+            stats->rows_rejected++;
+            fprintf(stderr, "Line %ld: malformed row, skipped\n", line_number);
+            continue;
+        }
+        if (bind_record(stmt, table, field_of_column, fields, field_count, &reason) != 0) {
+            stats->rows_rejected++;
+            fprintf(stderr, "Line %ld: missing or invalid %s, skipped\n", line_number, reason);
+            sqlite3_clear_bindings(stmt);
+            continue;
+        }
+
+        if (batch_size >= 1 && !in_batch) {
+            if (begin_transaction(db) != 0) {
+                status = -1;
+                break;
+            }
+            in_batch = 1;
+        }
+
+        // A failed statement is rolled back on its own and leaves the batch open
+        if (sqlite3_step(stmt) == SQLITE_DONE) {
+            if (batch_size < 1 && flush_staged_rows(db, table) != 0) {
+                stats->rows_rejected++;
+                sqlite3_reset(stmt);
+                continue;
+            }
+            stats->rows_inserted++;
+            if (batch_size < 1) {
+                stats->batches_committed++;
+            }
+        } else {
+            stats->rows_rejected++;
+            fprintf(stderr, "Line %ld: %s row rejected: %s\n", line_number, table->label,
+                    sqlite3_errmsg(db->connection));
+        }
+        sqlite3_reset(stmt);
+
+        if (in_batch && sqlite3_get_autocommit(db->connection)) {
+            // The error rolled back the whole batch (I/O error, disk full)
+            fprintf(stderr, "Import aborted: the open batch was rolled back\n");
+            in_batch = 0;
+            status = -1;
+            break;
+        }
+        if (in_batch && ++rows_in_batch >= batch_size) {
+            if (flush_staged_rows(db, table) != 0 || commit_transaction(db) != 0) {
+                status = -1;
+                break;
+            }
+            in_batch = 0;
+            rows_in_batch = 0;
+            stats->batches_committed++;
+        }
+    }
+
+    if (in_batch) {
+        if (status == 0 && flush_staged_rows(db, table) == 0 && commit_transaction(db) == 0) {
+            stats->batches_committed++;
+        } else {
+            rollback_transaction(db);
+            status = -1;
+        }
+    }
+    sqlite3_finalize(stmt);
+    close_input(&input);
+
+    if (table->reload_catalog && refresh_catalog(db) != 0) {
+        status = -1;
+    }
+    stats->elapsed_seconds = metrics_now_seconds() - started;
+    return status;
+}
+
+int import_products_csv(Database *db, const char *path, int batch_size, BulkIngestStats *stats) {
+    return import_csv(db, &product_import, path, batch_size, stats);
+}
+
+int import_suppliers_csv(Database *db, const char *path, int batch_size, BulkIngestStats *stats) {
+    return import_csv(db, &supplier_import, path, batch_size, stats);
+}
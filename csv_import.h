@@ -0,0 +1,37 @@
+#ifndef CSV_IMPORT_H
+#define CSV_IMPORT_H
+
+#include "database.h"
+
+// Bulk catalog import
+// Reads the CSV written by --dump products / --dump suppliers --format csv:
+// a header row naming the columns (any order), then one record per row.
+// Quoted fields may contain commas, doubled quotes and line breaks.
+//
+// The file is memory-mapped copy-on-write (stdin is read into one buffer)
+// and tokenized in place, so field text is bound straight from the buffer.
+// Rows are upserted through one prepared statement (products through a
+// temporary staging table flushed once per batch, which keeps the search
+// index triggers cheap): a row whose id exists replaces that record, a row
+// with an empty or missing id gets a new one.
+// Rejected rows are reported on stderr with their line number and skipped;
+// the rest of the batch still commits. A batch_size below 1 commits per row.
+//
+// Products columns: product_name, cost_price, selling_price, stock_quantity
+// and reorder_level are required; product_id, description and category are
+// optional. Suppliers columns: supplier_name is required; supplier_id,
+// contact_info and address are optional. Empty optional text becomes NULL.
+//
+// Imported products are picked up by reloading the catalog once at the end,
+// so no low-stock callbacks fire during an import.
+
+// Strict parsing of one number as the importer reads it: plain decimal
+// notation only (no nan, inf or hex), surrounding blanks allowed, nothing
+// else after it, and no value out of range. Returns 0 or -1.
+int parse_strict_integer(const char *text, size_t length, long long *value);
+int parse_strict_real(const char *text, size_t length, double *value);
+
+int import_products_csv(Database *db, const char *path, int batch_size, BulkIngestStats *stats);
+int import_suppliers_csv(Database *db, const char *path, int batch_size, BulkIngestStats *stats);
+
+#endif // CSV_IMPORT_H
@@ -1,16 +1,713 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <unistd.h>
 #include "database.h"
+#include "metrics.h"
+
+// Transactions store transaction_date as unix seconds and DailySales stores
+// sale_day as a day number (unix seconds of midnight / 86400); both are
+// converted from and to the text dates of the public API in SQL.
+
+// Render a stored transaction_date: plain date at midnight, date and time
+// otherwise; values a migration could not parse are kept as text
+#define TRANSACTION_DATE_TEXT(column) \
+    "(CASE WHEN typeof(" column ") <> 'integer' THEN " column \
+    " WHEN " column " % 86400 = 0 THEN date(" column ", 'unixepoch') " \
+    "ELSE datetime(" column ", 'unixepoch') END)"
+
+// Signed stock change of a Transactions row aliased t
+#define STOCK_DELTA "CASE t.transaction_type WHEN 1 THEN t.quantity WHEN 2 THEN -t.quantity ELSE 0 END"
+
+// Net stock change of one product from transactions dated after a time
+#define MOVEMENTS_AFTER(product, time) \
+    "coalesce((SELECT SUM(" STOCK_DELTA ") FROM Transactions t " \
+    "WHERE t.product_id = " product " AND t.transaction_date > " time "), 0)"
+
+// Checkpoint the products of a FROM clause (aliased p) that have at least ?1
+// transactions since their latest checkpoint, or no checkpoint yet
+#define CHECKPOINT_PRODUCTS(from) \
+    "INSERT INTO StockCheckpoints (product_id, checkpoint_time, stock_quantity) " \
+    "SELECT p.product_id, unixepoch('now'), " \
+    "p.stock_quantity - " MOVEMENTS_AFTER("p.product_id", "unixepoch('now')") " " \
+    "FROM " from " " \
+    "WHERE ?1 <= 0 " \
+    "OR NOT EXISTS (SELECT 1 FROM StockCheckpoints c WHERE c.product_id = p.product_id) " \
+    "OR (SELECT count(*) FROM (SELECT 1 FROM Transactions t " \
+    "WHERE t.product_id = p.product_id AND t.transaction_date <= unixepoch('now') " \
+    "AND t.transaction_date > (SELECT max(c.checkpoint_time) FROM StockCheckpoints c " \
+    "WHERE c.product_id = p.product_id) " \
+    "LIMIT ?1)) >= ?1 " \
+    "ON CONFLICT (product_id, checkpoint_time) DO UPDATE SET stock_quantity = excluded.stock_quantity;"
+
+// SQL for each cached statement, indexed by StatementId
+static const char *statement_sql[STMT_COUNT] = {
+    [STMT_ADD_PRODUCT] =
+        "INSERT INTO Products (product_id, product_name, description, category, cost_price, selling_price, stock_quantity, reorder_level) "
+        "VALUES (?, ?, ?, ?, ?, ?, ?, ?);",
+    [STMT_DELETE_PRODUCT] = "DELETE FROM Products WHERE product_id = ?;",
+    [STMT_LIST_PRODUCTS] = "SELECT * FROM Products;",
+    // Whole days in [?1, ?2] come from the DailySales rollup; only the partial
+    // days at the edges are read from Transactions. The first whole day is ?1
+    // itself when it falls on midnight, or the day after ?1 when it carries a time.
+    [STMT_SALES_REPORT] =
+        "WITH bounds (lo, hi, first_whole, last_start) AS ("
+        "SELECT unixepoch(?1), unixepoch(?2), "
+        "CASE WHEN unixepoch(?1) = unixepoch(?1, 'start of day') THEN unixepoch(?1) "
+        "ELSE unixepoch(?1, 'start of day', '+1 day') END, "
+        "unixepoch(?2, 'start of day')"
+        "), "
+        "sales (product_id, quantity) AS ("
+        "SELECT d.product_id, d.quantity FROM bounds b, DailySales d "
+        "WHERE d.sale_day >= b.first_whole / 86400 AND d.sale_day < b.last_start / 86400 "
+        "UNION ALL "
+        "SELECT t.product_id, t.quantity FROM bounds b, Transactions t "
+        "WHERE t.transaction_type = 2 AND t.transaction_date BETWEEN b.lo AND b.hi "
+        "AND t.transaction_date < b.first_whole "
+        "UNION ALL "
+        "SELECT t.product_id, t.quantity FROM bounds b, Transactions t "
+        "WHERE t.transaction_type = 2 AND t.transaction_date BETWEEN b.lo AND b.hi "
+        "AND t.transaction_date >= max(b.last_start, b.first_whole)"
+        ") "
+        "SELECT p.product_name, SUM(s.quantity) AS total_sold, SUM(s.quantity * p.selling_price) AS total_sales "
+        "FROM sales s "
+        "JOIN Products p ON s.product_id = p.product_id "
+        "GROUP BY p.product_name;",
+    [STMT_ADD_SUPPLIER] =
+        "INSERT INTO Suppliers (supplier_name, contact_info, address) "
+        "VALUES (?, ?, ?);",
+    [STMT_LIST_SUPPLIERS] = "SELECT * FROM Suppliers;",
+    [STMT_ADD_TRANSACTION] =
+        "INSERT INTO Transactions (product_id, transaction_type, quantity, transaction_date, customer_supplier_id) "
+        "VALUES (?1, ?2, ?3, unixepoch(?4), ?5);",
+    [STMT_LIST_TRANSACTIONS] =
+        "SELECT t.transaction_id, p.product_name, t.quantity, "
+        TRANSACTION_DATE_TEXT("t.transaction_date") ", t.customer_supplier_id "
+        "FROM Transactions t "
+        "JOIN Products p ON t.product_id = p.product_id "
+        "WHERE t.transaction_type = ?;",
+    [STMT_LOW_STOCK] =
+        "SELECT * FROM Products WHERE stock_quantity < reorder_level "
+        "ORDER BY reorder_level - stock_quantity DESC, product_id;",
+    [STMT_UPDATE_STOCK] = "UPDATE Products SET stock_quantity = ? WHERE product_id = ?;",
+    [STMT_ADJUST_STOCK] =
+        "UPDATE Products SET stock_quantity = stock_quantity + ?1 "
+        "WHERE product_id = ?2 AND (?3 = 0 OR stock_quantity + ?1 >= 0);",
+    [STMT_SAVEPOINT] = "SAVEPOINT stock_movement;",
+    [STMT_RELEASE_SAVEPOINT] = "RELEASE stock_movement;",
+    [STMT_ROLLBACK_SAVEPOINT] = "ROLLBACK TO stock_movement;",
+    [STMT_PRODUCTS_PAGE] =
+        "SELECT * FROM Products WHERE product_id > ? ORDER BY product_id LIMIT ?;",
+    [STMT_TRANSACTIONS_PAGE] =
+        "SELECT t.transaction_id, p.product_name, t.quantity, "
+        TRANSACTION_DATE_TEXT("t.transaction_date") ", t.customer_supplier_id "
+        "FROM Transactions t "
+        "JOIN Products p ON t.product_id = p.product_id "
+        "WHERE t.transaction_type = ? AND t.transaction_id > ? "
+        "ORDER BY t.transaction_id LIMIT ?;",
+    [STMT_ADD_DAILY_SALES] =
+        "INSERT INTO DailySales (sale_day, product_id, quantity) "
+        "VALUES (unixepoch(?1, 'start of day') / 86400, ?2, ?3) "
+        "ON CONFLICT (sale_day, product_id) DO UPDATE SET quantity = quantity + excluded.quantity;",
+    [STMT_GET_PRODUCT] = "SELECT * FROM Products WHERE product_id = ?;",
+    [STMT_BEGIN] = "BEGIN;",
+    [STMT_COMMIT] = "COMMIT;",
+    [STMT_ROLLBACK] = "ROLLBACK;",
+    [STMT_GET_SUPPLIER] =
+        "SELECT supplier_id, supplier_name, contact_info, address "
+        "FROM Suppliers WHERE supplier_id = ?;",
+    // Rank inside the index, then fetch only the rows that made the cut
+    [STMT_SEARCH_PRODUCTS] =
+        "SELECT p.* FROM ("
+        "SELECT rowid AS product_id, rank FROM ProductSearch WHERE ProductSearch MATCH ?1 "
+        "ORDER BY rank LIMIT ?2"
+        ") s JOIN Products p USING (product_id) "
+        "ORDER BY s.rank, p.product_id;",
+    // A checkpoint counts transactions dated up to its time, so future-dated
+    // ones already in stock_quantity are taken back out
+    [STMT_SET_CHECKPOINT] =
+        "INSERT INTO StockCheckpoints (product_id, checkpoint_time, stock_quantity) "
+        "SELECT ?1, unixepoch('now'), ?2 - " MOVEMENTS_AFTER("?1", "unixepoch('now')") " WHERE true "
+        "ON CONFLICT (product_id, checkpoint_time) DO UPDATE SET stock_quantity = excluded.stock_quantity;",
+    // Products without a checkpoint always get one; counting stops at ?1
+    [STMT_CREATE_CHECKPOINT] = CHECKPOINT_PRODUCTS("Products p"),
+    // Same, limited to products with a transaction id after ?2 (NOT INDEXED
+    // keeps the rowid range scan; the planner would walk a whole index for DISTINCT)
+    [STMT_CHECKPOINT_MOVED] = CHECKPOINT_PRODUCTS(
+        "(SELECT DISTINCT product_id FROM Transactions NOT INDEXED WHERE transaction_id > ?2) m "
+        "JOIN Products p ON p.product_id = m.product_id"),
+    [STMT_SHIFT_CHECKPOINTS] =
+        "UPDATE StockCheckpoints SET stock_quantity = stock_quantity + ?1 "
+        "WHERE product_id = ?2 AND checkpoint_time >= unixepoch(?3);",
+    [STMT_CHECKPOINT_BEFORE] =
+        "SELECT checkpoint_time, stock_quantity FROM StockCheckpoints "
+        "WHERE product_id = ?1 AND checkpoint_time <= ?2 ORDER BY checkpoint_time DESC LIMIT 1;",
+    [STMT_CHECKPOINT_AFTER] =
+        "SELECT checkpoint_time, stock_quantity FROM StockCheckpoints "
+        "WHERE product_id = ?1 AND checkpoint_time > ?2 ORDER BY checkpoint_time LIMIT 1;",
+    [STMT_STOCK_MOVEMENTS] =
+        "SELECT coalesce(SUM(" STOCK_DELTA "), 0) FROM Transactions t "
+        "WHERE t.product_id = ?1 AND t.transaction_date > ?2 AND t.transaction_date <= ?3;",
+    // A plain date stands for the last second of that day
+    [STMT_AS_OF_TIME] =
+        "SELECT CASE WHEN ?1 IS NULL THEN unixepoch('now') "
+        "WHEN length(?1) <= 10 THEN unixepoch(?1, '+1 day') - 1 "
+        "ELSE unixepoch(?1) END;",
+    [STMT_EXPORT_RANGE] =
+        "SELECT coalesce((SELECT last_transaction_id FROM ExportState WHERE export_name = ?1), 0), "
+        "coalesce((SELECT max(transaction_id) FROM Transactions), 0);",
+    // Same columns as an --ingest row, so an export replays onto a restored backup
+    [STMT_EXPORT_TRANSACTIONS] =
+        "SELECT product_id, "
+        "CASE transaction_type WHEN 1 THEN 'IN' WHEN 2 THEN 'OUT' ELSE transaction_type END, "
+        "quantity, " TRANSACTION_DATE_TEXT("transaction_date") ", customer_supplier_id "
+        "FROM Transactions WHERE transaction_id > ?1 AND transaction_id <= ?2 "
+        "ORDER BY transaction_id;",
+    [STMT_MARK_EXPORTED] =
+        "INSERT INTO ExportState (export_name, last_transaction_id, exported_at) "
+        "VALUES (?1, ?2, unixepoch('now')) "
+        "ON CONFLICT (export_name) DO UPDATE SET "
+        "last_transaction_id = excluded.last_transaction_id, exported_at = excluded.exported_at;",
+};
+
+// Labels for the statement statistics
+static const char *statement_names[STMT_COUNT] = {
+    [STMT_ADD_PRODUCT] = "add_product",
+    [STMT_DELETE_PRODUCT] = "delete_product",
+    [STMT_LIST_PRODUCTS] = "list_products",
+    [STMT_SALES_REPORT] = "sales_report",
+    [STMT_ADD_SUPPLIER] = "add_supplier",
+    [STMT_LIST_SUPPLIERS] = "list_suppliers",
+    [STMT_ADD_TRANSACTION] = "add_transaction",
+    [STMT_LIST_TRANSACTIONS] = "list_transactions",
+    [STMT_LOW_STOCK] = "low_stock",
+    [STMT_UPDATE_STOCK] = "update_stock",
+    [STMT_ADJUST_STOCK] = "adjust_stock",
+    [STMT_SAVEPOINT] = "savepoint",
+    [STMT_RELEASE_SAVEPOINT] = "release_savepoint",
+    [STMT_ROLLBACK_SAVEPOINT] = "rollback_savepoint",
+    [STMT_PRODUCTS_PAGE] = "products_page",
+    [STMT_TRANSACTIONS_PAGE] = "transactions_page",
+    [STMT_ADD_DAILY_SALES] = "add_daily_sales",
+    [STMT_GET_PRODUCT] = "get_product",
+    [STMT_BEGIN] = "begin",
+    [STMT_COMMIT] = "commit",
+    [STMT_ROLLBACK] = "rollback",
+    [STMT_GET_SUPPLIER] = "get_supplier",
+    [STMT_SEARCH_PRODUCTS] = "search_products",
+    [STMT_SET_CHECKPOINT] = "set_checkpoint",
+    [STMT_CREATE_CHECKPOINT] = "create_checkpoint",
+    [STMT_CHECKPOINT_MOVED] = "checkpoint_moved",
+    [STMT_SHIFT_CHECKPOINTS] = "shift_checkpoints",
+    [STMT_CHECKPOINT_BEFORE] = "checkpoint_before",
+    [STMT_CHECKPOINT_AFTER] = "checkpoint_after",
+    [STMT_STOCK_MOVEMENTS] = "stock_movements",
+    [STMT_AS_OF_TIME] = "as_of_time",
+    [STMT_EXPORT_RANGE] = "export_range",
+    [STMT_EXPORT_TRANSACTIONS] = "export_transactions",
+    [STMT_MARK_EXPORTED] = "mark_exported",
+};
+
+// Schema migrations, applied in order; entry N upgrades user_version N to N + 1
+static const char *schema_migrations[] = {
+    // 1: secondary and covering indexes for reports, listings and low-stock checks
+    "CREATE INDEX IF NOT EXISTS idx_transactions_type_date "
+    "ON Transactions (transaction_type, transaction_date, product_id, quantity);"
+    "CREATE INDEX IF NOT EXISTS idx_transactions_product "
+    "ON Transactions (product_id);"
+    "CREATE INDEX IF NOT EXISTS idx_products_stock "
+    "ON Products (stock_quantity, reorder_level);",
+
+    // 2: per-day, per-product OUT totals maintained by add_transaction
+    "CREATE TABLE IF NOT EXISTS DailySales ("
+    "sale_day TEXT NOT NULL, "
+    "product_id INTEGER NOT NULL, "
+    "quantity INTEGER NOT NULL, "
+    "PRIMARY KEY (sale_day, product_id)"
+    ") WITHOUT ROWID;"
+    "INSERT INTO DailySales (sale_day, product_id, quantity) "
+    "SELECT substr(transaction_date, 1, 10), product_id, SUM(quantity) FROM Transactions "
+    "WHERE transaction_type = 'OUT' GROUP BY 1, 2;",
+
+    // 3: keyset pagination of transactions within a type
+    "CREATE INDEX IF NOT EXISTS idx_transactions_type_id "
+    "ON Transactions (transaction_type, transaction_id);",
+
+    // 4: compact storage: integer transaction types (TransactionType), unix-second
+    // transaction dates and day-number sale days; rows whose type or date cannot
+    // be converted are copied unchanged rather than dropped
+    "CREATE TABLE Transactions_compact ("
+    "transaction_id INTEGER PRIMARY KEY AUTOINCREMENT, "
+    "product_id INTEGER NOT NULL, "
+    "transaction_type INTEGER NOT NULL, "
+    "quantity INTEGER NOT NULL, "
+    "transaction_date INTEGER NOT NULL, "
+    "customer_supplier_id INTEGER, "
+    "FOREIGN KEY (product_id) REFERENCES Products(product_id)"
+    ");"
+    "INSERT INTO Transactions_compact "
+    "SELECT transaction_id, product_id, "
+    "CASE transaction_type WHEN 'IN' THEN 1 WHEN 'OUT' THEN 2 ELSE transaction_type END, "
+    "quantity, coalesce(unixepoch(transaction_date), transaction_date), customer_supplier_id "
+    "FROM Transactions;"
+    "DELETE FROM sqlite_sequence WHERE name = 'Transactions_compact';"
+    "INSERT INTO sqlite_sequence (name, seq) "
+    "SELECT 'Transactions_compact', seq FROM sqlite_sequence WHERE name = 'Transactions';"
+    "DROP TABLE Transactions;"
+    "ALTER TABLE Transactions_compact RENAME TO Transactions;"
+    "CREATE INDEX idx_transactions_type_date "
+    "ON Transactions (transaction_type, transaction_date, product_id, quantity);"
+    "CREATE INDEX idx_transactions_product ON Transactions (product_id);"
+    "CREATE INDEX idx_transactions_type_id ON Transactions (transaction_type, transaction_id);"
+    "CREATE TABLE DailySales_compact ("
+    "sale_day INTEGER NOT NULL, "
+    "product_id INTEGER NOT NULL, "
+    "quantity INTEGER NOT NULL, "
+    "PRIMARY KEY (sale_day, product_id)"
+    ") WITHOUT ROWID;"
+    "INSERT INTO DailySales_compact (sale_day, product_id, quantity) "
+    "SELECT unixepoch(sale_day) / 86400, product_id, SUM(quantity) FROM DailySales "
+    "WHERE unixepoch(sale_day) IS NOT NULL GROUP BY 1, 2;"
+    "DROP TABLE DailySales;"
+    "ALTER TABLE DailySales_compact RENAME TO DailySales;",
+
+    // 5: full-text product search over an external-content FTS5 index of
+    // Products, with prefix indexes for type-ahead and bm25 weights favouring
+    // the name, then the category
+    "CREATE VIRTUAL TABLE ProductSearch USING fts5("
+    "product_name, category, description, "
+    "content = 'Products', content_rowid = 'product_id', "
+    "tokenize = 'unicode61 remove_diacritics 2', prefix = '2 3'"
+    ");"
+    "INSERT INTO ProductSearch (ProductSearch, rank) VALUES ('rank', 'bm25(10.0, 5.0, 1.0)');"
+    "CREATE TRIGGER products_search_insert AFTER INSERT ON Products BEGIN "
+    "INSERT INTO ProductSearch (rowid, product_name, category, description) "
+    "VALUES (new.product_id, new.product_name, new.category, new.description); "
+    "END;"
+    "CREATE TRIGGER products_search_delete AFTER DELETE ON Products BEGIN "
+    "INSERT INTO ProductSearch (ProductSearch, rowid, product_name, category, description) "
+    "VALUES ('delete', old.product_id, old.product_name, old.category, old.description); "
+    "END;"
+    // Stock updates leave the indexed text alone and skip this trigger
+    "CREATE TRIGGER products_search_update AFTER UPDATE OF product_name, category, description "
+    "ON Products BEGIN "
+    "INSERT INTO ProductSearch (ProductSearch, rowid, product_name, category, description) "
+    "VALUES ('delete', old.product_id, old.product_name, old.category, old.description); "
+    "INSERT INTO ProductSearch (rowid, product_name, category, description) "
+    "VALUES (new.product_id, new.product_name, new.category, new.description); "
+    "END;"
+    "INSERT INTO ProductSearch (ProductSearch) VALUES ('rebuild');",
+
+    // 6: per-product stock checkpoints for as-of queries, seeded with the
+    // current stock; the product index widens to cover date-bounded replays
+    "CREATE TABLE StockCheckpoints ("
+    "product_id INTEGER NOT NULL, "
+    "checkpoint_time INTEGER NOT NULL, "
+    "stock_quantity INTEGER NOT NULL, "
+    "PRIMARY KEY (product_id, checkpoint_time)"
+    ") WITHOUT ROWID;"
+    "DROP INDEX IF EXISTS idx_transactions_product;"
+    "CREATE INDEX idx_transactions_product_date "
+    "ON Transactions (product_id, transaction_date, transaction_type, quantity);"
+    "INSERT INTO StockCheckpoints (product_id, checkpoint_time, stock_quantity) "
+    "SELECT p.product_id, unixepoch('now'), "
+    "p.stock_quantity - " MOVEMENTS_AFTER("p.product_id", "unixepoch('now')") " FROM Products p;"
+    "CREATE TRIGGER products_checkpoints_delete AFTER DELETE ON Products BEGIN "
+    "DELETE FROM StockCheckpoints WHERE product_id = old.product_id; "
+    "END;",
+
+    // 7: how far each incremental export has read the Transactions table
+    "CREATE TABLE ExportState ("
+    "export_name TEXT PRIMARY KEY, "
+    "last_transaction_id INTEGER NOT NULL, "
+    "exported_at INTEGER NOT NULL"
+    ");",
+
+    // 8: which shard of a sharded set (shard.h) this file is; empty otherwise
+    "CREATE TABLE ShardInfo ("
+    "singleton INTEGER PRIMARY KEY CHECK (singleton = 1), "
+    "shard INTEGER NOT NULL, "
+    "shard_count INTEGER NOT NULL"
+    ");",
+};
+
+#define SCHEMA_VERSION ((int)(sizeof(schema_migrations) / sizeof(schema_migrations[0])))
+
+// Read the schema version recorded in the database file
+static int get_schema_version(Database *db) {
+    sqlite3_stmt *stmt;
+    int version = -1;
+
+    if (sqlite3_prepare_v2(db->connection, "PRAGMA user_version;", -1, &stmt, NULL) != SQLITE_OK) {
+        fprintf(stderr, "Failed to read schema version: %s\n", sqlite3_errmsg(db->connection));
+        return -1;
+    }
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        version = sqlite3_column_int(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+    return version;
+}
+
+// Upgrade an existing database file in place to SCHEMA_VERSION
+static int migrate_schema(Database *db) {
+    int version = get_schema_version(db);
+    if (version < 0) {
+        return -1;
+    }
+    if (version > SCHEMA_VERSION) {
+        fprintf(stderr, "Database schema version %d is newer than supported version %d\n",
+                version, SCHEMA_VERSION);
+        return -1;
+    }
+
+    for (; version < SCHEMA_VERSION; version++) {
+        char set_version[64];
+        char *err_msg = NULL;
+        snprintf(set_version, sizeof(set_version), "PRAGMA user_version = %d;", version + 1);
+
+        // Each step and its version bump commit together
+        if (sqlite3_exec(db->connection, "BEGIN;", 0, 0, &err_msg) != SQLITE_OK ||
+            sqlite3_exec(db->connection, schema_migrations[version], 0, 0, &err_msg) != SQLITE_OK ||
+            sqlite3_exec(db->connection, set_version, 0, 0, &err_msg) != SQLITE_OK ||
+            sqlite3_exec(db->connection, "COMMIT;", 0, 0, &err_msg) != SQLITE_OK) {
+            fprintf(stderr, "Failed to migrate schema to version %d: %s\n", version + 1, err_msg);
+            sqlite3_free(err_msg);
+            sqlite3_exec(db->connection, "ROLLBACK;", 0, 0, NULL);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Prepare every cached statement once
+static int prepare_statements(Database *db) {
+    for (int i = 0; i < STMT_COUNT; i++) {
+        if (sqlite3_prepare_v3(db->connection, statement_sql[i], -1, SQLITE_PREPARE_PERSISTENT,
+                               &db->statements[i], NULL) != SQLITE_OK) {
+            fprintf(stderr, "Failed to prepare statement: %s\n", sqlite3_errmsg(db->connection));
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Return a cached statement to its initial state after use
+static void reset_statement(sqlite3_stmt *stmt) {
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+}
+
+// Run a cached statement that takes no parameters and returns no rows
+static int run_statement(Database *db, StatementId id) {
+    sqlite3_stmt *stmt = db->statements[id];
+    int status = sqlite3_step(stmt) == SQLITE_DONE ? 0 : -1;
+    if (status != 0) {
+        fprintf(stderr, "Failed to execute statement: %s\n", sqlite3_errmsg(db->connection));
+    }
+    sqlite3_reset(stmt);
+    return status;
+}
+
+// Reset a cursor after its last step; returns row_count, or -1 if the step failed
+static int finish_query(Database *db, sqlite3_stmt *stmt, int rc, int row_count) {
+    if (rc != SQLITE_DONE) {
+        fprintf(stderr, "Failed to execute statement: %s\n", sqlite3_errmsg(db->connection));
+        row_count = -1;
+    }
+    reset_statement(stmt);
+    return row_count;
+}
+
+// Open a table sink on stdout for the list_* functions
+static int open_stdout_table(OutputSink *sink) {
+    // Anything already printf'd must reach the terminal before the sink's output
+    fflush(stdout);
+    return output_open(sink, STDOUT_FILENO, OUTPUT_TABLE);
+}
+
+// Column layouts for the row streams
+static const OutputColumn product_columns[] = {
+    {"ID", "product_id", 4},
+    {"Name", "product_name", 20},
+    {"Description", "description", 30},
+    {"Category", "category", 15},
+    {"Cost", "cost_price", 10},
+    {"Selling", "selling_price", 12},
+    {"Stock", "stock_quantity", 8},
+    {"Reorder Level", "reorder_level", 15},
+};
+#define PRODUCT_COLUMN_COUNT ((int)(sizeof(product_columns) / sizeof(product_columns[0])))
+
+static const OutputColumn supplier_columns[] = {
+    {"ID", "supplier_id", 4},
+    {"Name", "supplier_name", 20},
+    {"Contact Info", "contact_info", 30},
+    {"Address", "address", 30},
+};
+#define SUPPLIER_COLUMN_COUNT ((int)(sizeof(supplier_columns) / sizeof(supplier_columns[0])))
+
+static const OutputColumn transaction_columns[] = {
+    {"Transaction ID", "transaction_id", 14},
+    {"Product", "product_name", 20},
+    {"Quantity", "quantity", 8},
+    {"Date", "transaction_date", 12},
+    {"Customer/Supplier ID", "customer_supplier_id", 20},
+};
+#define TRANSACTION_COLUMN_COUNT ((int)(sizeof(transaction_columns) / sizeof(transaction_columns[0])))
+
+static const OutputColumn sales_report_columns[] = {
+    {"Product", "product_name", 20},
+    {"Total Sold", "total_sold", 12},
+    {"Total Sales", "total_sales", 14},
+};
+#define SALES_REPORT_COLUMN_COUNT ((int)(sizeof(sales_report_columns) / sizeof(sales_report_columns[0])))
+
+static const OutputColumn low_stock_columns[] = {
+    {"ID", "product_id", 4},
+    {"Name", "product_name", 20},
+    {"Stock Quantity", "stock_quantity", 14},
+    {"Reorder Level", "reorder_level", 13},
+};
+#define LOW_STOCK_COLUMN_COUNT ((int)(sizeof(low_stock_columns) / sizeof(low_stock_columns[0])))
+
+void begin_product_rows(OutputSink *sink) {
+    output_begin(sink, product_columns, PRODUCT_COLUMN_COUNT);
+}
+
+void begin_supplier_rows(OutputSink *sink) {
+    output_begin(sink, supplier_columns, SUPPLIER_COLUMN_COUNT);
+}
+
+void begin_sales_report_rows(OutputSink *sink) {
+    output_begin(sink, sales_report_columns, SALES_REPORT_COLUMN_COUNT);
+}
+
+void begin_low_stock_rows(OutputSink *sink) {
+    output_begin(sink, low_stock_columns, LOW_STOCK_COLUMN_COUNT);
+}
+
+// Copy a nullable text column into a heap string
+static char *column_strdup(sqlite3_stmt *stmt, int column) {
+    const char *value = (const char *)sqlite3_column_text(stmt, column);
+    return value ? strdup(value) : NULL;
+}
+
+// Read the Products row at the current position of a SELECT * cursor
+static void read_product_row(sqlite3_stmt *stmt, Product *product) {
+    product->product_id = sqlite3_column_int(stmt, 0);
+    product->product_name = (char *)sqlite3_column_text(stmt, 1);
+    product->description = (char *)sqlite3_column_text(stmt, 2);
+    product->category = (char *)sqlite3_column_text(stmt, 3);
+    product->cost_price = sqlite3_column_double(stmt, 4);
+    product->selling_price = sqlite3_column_double(stmt, 5);
+    product->stock_quantity = sqlite3_column_int(stmt, 6);
+    product->reorder_level = sqlite3_column_int(stmt, 7);
+}
+
+// Read the current row of a transactions listing cursor
+static void read_transaction_row(sqlite3_stmt *stmt, TransactionRecord *transaction) {
+    transaction->transaction_id = sqlite3_column_int(stmt, 0);
+    transaction->product_name = (char *)sqlite3_column_text(stmt, 1);
+    transaction->quantity = sqlite3_column_int(stmt, 2);
+    transaction->transaction_date = (char *)sqlite3_column_text(stmt, 3);
+    transaction->customer_supplier_id = sqlite3_column_int(stmt, 4);
+}
+
+// Pass up to limit rows (limit < 0: all) of a SELECT * FROM Products cursor to
+// a visitor; *last_id receives the id of the last row visited, or 0 if the
+// visitor stopped the walk, so a page it ended carries no continuation token
+static int visit_product_cursor(Database *db, sqlite3_stmt *stmt, int limit, ProductVisitor visitor,
+                                void *context, int *last_id) {
+    int row_count = 0;
+    int stopped = 0;
+    int rc;
+
+    while (row_count != limit && (rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        Product row;
+        read_product_row(stmt, &row);
+        row_count++;
+        *last_id = row.product_id;
+        if (visitor(&row, context) != 0) {
+            stopped = 1;
+            break;
+        }
+    }
+    if (stopped) {
+        *last_id = 0;
+    }
+    if (row_count == limit || rc == SQLITE_ROW) {
+        rc = SQLITE_DONE;  // stopped early, not failed
+    }
+
+    return finish_query(db, stmt, rc, row_count);
+}
+
+// Same for the transactions listing cursors
+static int visit_transaction_cursor(Database *db, sqlite3_stmt *stmt, int limit, TransactionVisitor visitor,
+                                    void *context, int *last_id) {
+    int row_count = 0;
+    int stopped = 0;
+    int rc;
+
+    while (row_count != limit && (rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        TransactionRecord row;
+        read_transaction_row(stmt, &row);
+        row_count++;
+        *last_id = row.transaction_id;
+        if (visitor(&row, context) != 0) {
+            stopped = 1;
+            break;
+        }
+    }
+    if (stopped) {
+        *last_id = 0;
+    }
+    if (row_count == limit || rc == SQLITE_ROW) {
+        rc = SQLITE_DONE;
+    }
+
+    return finish_query(db, stmt, rc, row_count);
+}
+
+// (Re)load the in-memory catalog from the Products table
+static int load_catalog(Database *db) {
+    sqlite3_stmt *stmt = db->statements[STMT_LIST_PRODUCTS];
+    int status = 0;
+    int rc;
+
+    catalog_clear(&db->catalog);
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        Product product;
+        read_product_row(stmt, &product);
+        if (catalog_put(&db->catalog, &product) != 0) {
+            status = -1;
+            break;
+        }
+    }
+    if (rc != SQLITE_ROW && rc != SQLITE_DONE) {
+        fprintf(stderr, "Failed to load product catalog: %s\n", sqlite3_errmsg(db->connection));
+        status = -1;
+    }
+
+    reset_statement(stmt);
+    return status;
+}
+
+// Connection profiles
+// All profiles use WAL so reports and writers can run against the same file
+// concurrently; synchronous=NORMAL is durable across crashes of the process and
+// only risks the last commits on power loss.
+void database_config_for_profile(DatabaseConfig *config, ConnectionProfile profile) {
+    config->journal_mode = "WAL";
+    config->synchronous = "NORMAL";
+    config->cache_size_kb = 16 * 1024;
+    config->mmap_size = 256LL * 1024 * 1024;
+    config->temp_store = "MEMORY";
+    config->busy_timeout_ms = 5000;
+    config->reject_negative_stock = 0;
+    config->checkpoint_interval = 10000;
+    config->read_only = 0;
+
+    switch (profile) {
+        case PROFILE_REPORTING:
+            config->cache_size_kb = 64 * 1024;
+            config->mmap_size = 1024LL * 1024 * 1024;
+            break;
+        case PROFILE_INGEST:
+            config->cache_size_kb = 64 * 1024;
+            config->busy_timeout_ms = 30000;
+            break;
+        case PROFILE_BALANCED:
+            break;
+    }
+}
+
+int parse_connection_profile(const char *name, ConnectionProfile *profile) {
+    if (strcmp(name, "balanced") == 0) {
+        *profile = PROFILE_BALANCED;
+    } else if (strcmp(name, "reporting") == 0) {
+        *profile = PROFILE_REPORTING;
+    } else if (strcmp(name, "ingest") == 0) {
+        *profile = PROFILE_INGEST;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+// Apply the connection profile to an open connection
+static int apply_connection_config(Database *db) {
+    const DatabaseConfig *config = &db->config;
+    char pragma[128];
+    char *err_msg = NULL;
+    int status = SQLITE_OK;
+
+    if (config->busy_timeout_ms > 0) {
+        sqlite3_busy_timeout(db->connection, config->busy_timeout_ms);
+    }
+    // The journal mode is a property of the file, set by read-write handles
+    if (config->journal_mode && !config->read_only) {
+        snprintf(pragma, sizeof(pragma), "PRAGMA journal_mode = %s;", config->journal_mode);
+        status = sqlite3_exec(db->connection, pragma, 0, 0, &err_msg);
+    }
+    if (status == SQLITE_OK && config->synchronous) {
+        snprintf(pragma, sizeof(pragma), "PRAGMA synchronous = %s;", config->synchronous);
+        status = sqlite3_exec(db->connection, pragma, 0, 0, &err_msg);
+    }
+    if (status == SQLITE_OK && config->cache_size_kb > 0) {
+        // Negative cache_size is interpreted by SQLite as KiB rather than pages
+        snprintf(pragma, sizeof(pragma), "PRAGMA cache_size = -%d;", config->cache_size_kb);
+        status = sqlite3_exec(db->connection, pragma, 0, 0, &err_msg);
+    }
+    if (status == SQLITE_OK && config->mmap_size > 0) {
+        snprintf(pragma, sizeof(pragma), "PRAGMA mmap_size = %lld;", config->mmap_size);
+        status = sqlite3_exec(db->connection, pragma, 0, 0, &err_msg);
+    }
+    if (status == SQLITE_OK && config->temp_store) {
+        snprintf(pragma, sizeof(pragma), "PRAGMA temp_store = %s;", config->temp_store);
+        status = sqlite3_exec(db->connection, pragma, 0, 0, &err_msg);
+    }
+
+    if (status != SQLITE_OK) {
+        fprintf(stderr, "Failed to apply connection settings: %s\n", err_msg);
+        sqlite3_free(err_msg);
+        return -1;
+    }
+    return 0;
+}
 
 // Initialize the database (create tables if they don't exist)
-int initialize_database(Database *db, const char *db_name) {
+static int initialize_database_unmetered(Database *db, const char *db_name, const DatabaseConfig *config) {
+    memset(db, 0, sizeof(*db));
+    if (config) {
+        db->config = *config;
+    } else {
+        database_config_for_profile(&db->config, PROFILE_BALANCED);
+    }
     db->db_name = strdup(db_name);
     if (connect_to_database(db) != SQLITE_OK) {
         fprintf(stderr, "Failed to connect to database: %s\n", db_name);
+        close_database(db);
         return -1;
     }
 
+    // Read-only handles attach to a file a writer has already set up
+    if (db->config.read_only) {
+        if (get_schema_version(db) != SCHEMA_VERSION) {
+            fprintf(stderr, "Database %s is not at schema version %d\n", db_name, SCHEMA_VERSION);
+            close_database(db);
+            return -1;
+        }
+        if (prepare_statements(db) != 0 || catalog_init(&db->catalog) != 0) {
+            close_database(db);
+            return -1;
+        }
+        return 0;
+    }
+
     const char *create_tables_query =
         "CREATE TABLE IF NOT EXISTS Products ("
         "product_id INTEGER PRIMARY KEY AUTOINCREMENT, "
@@ -51,293 +748,1976 @@ int initialize_database(Database *db, const char *db_name) {
         return -1;
     }
 
+    if (migrate_schema(db) != 0 || prepare_statements(db) != 0 ||
+        catalog_init(&db->catalog) != 0 || load_catalog(db) != 0) {
+        close_database(db);
+        return -1;
+    }
+
     return 0;
 }
 
 // Connect to the database
-int connect_to_database(Database *db) {
-    if (sqlite3_open(db->db_name, &db->connection) != SQLITE_OK) {
+static int connect_to_database_unmetered(Database *db) {
+    int flags = db->config.read_only ? SQLITE_OPEN_READONLY : SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE;
+    if (sqlite3_open_v2(db->db_name, &db->connection, flags, NULL) != SQLITE_OK) {
         fprintf(stderr, "Cannot open database: %s\n", sqlite3_errmsg(db->connection));
         return -1;
     }
+    if (apply_connection_config(db) != 0) {
+        return -1;
+    }
     return SQLITE_OK;
 }
 
 // Close the database connection
-void close_database(Database *db) {
+static void close_database_unmetered(Database *db) {
+    for (int i = 0; i < STMT_COUNT; i++) {
+        sqlite3_finalize(db->statements[i]);
+        db->statements[i] = NULL;
+    }
+    if (db->catalog.products) {
+        catalog_free(&db->catalog);
+    }
     if (db->connection) {
         sqlite3_close(db->connection);
         db->connection = NULL;
     }
     if (db->db_name) {
         free(db->db_name);
+        db->db_name = NULL;
     }
 }
 
-// Products Table Operations
+// Explicit transactions
 
-// Add a new product
-int add_product(Database *db, const char *name, const char *description, const char *category,
-                double cost_price, double selling_price, int stock_quantity, int reorder_level) {
-    const char *query =
-        "INSERT INTO Products (product_name, description, category, cost_price, selling_price, stock_quantity, reorder_level) "
-        "VALUES (?, ?, ?, ?, ?, ?, ?);";
-    sqlite3_stmt *stmt;
+static int begin_transaction_unmetered(Database *db) {
+    return run_statement(db, STMT_BEGIN);
+}
+
+static int commit_transaction_unmetered(Database *db) {
+    return run_statement(db, STMT_COMMIT);
+}
 
-    if (sqlite3_prepare_v2(db->connection, query, -1, &stmt, NULL) != SQLITE_OK) {
-        fprintf(stderr, "Failed to prepare statement: %s\n", sqlite3_errmsg(db->connection));
+static int rollback_transaction_unmetered(Database *db) {
+    // SQLite may already have rolled back after an error; that is not a failure
+    if (sqlite3_get_autocommit(db->connection) == 0 && run_statement(db, STMT_ROLLBACK) != 0) {
         return -1;
     }
+    // Stock changes of the rolled-back work are already in the catalog
+    return load_catalog(db);
+}
 
-    sqlite3_bind_text(stmt, 1, name, -1, SQLITE_STATIC);
-    sqlite3_bind_text(stmt, 2, description, -1, SQLITE_STATIC);
-    sqlite3_bind_text(stmt, 3, category, -1, SQLITE_STATIC);
-    sqlite3_bind_double(stmt, 4, cost_price);
-    sqlite3_bind_double(stmt, 5, selling_price);
-    sqlite3_bind_int(stmt, 6, stock_quantity);
-    sqlite3_bind_int(stmt, 7, reorder_level);
-
-    if (sqlite3_step(stmt) != SQLITE_DONE) {
-        fprintf(stderr, "Failed to execute statement: %s\n", sqlite3_errmsg(db->connection));
-        sqlite3_finalize(stmt);
-        return -1;
+static int refresh_catalog_unmetered(Database *db) {
+    if (db->config.read_only) {
+        return 0;  // read-only handles do not cache the table
     }
+    return load_catalog(db);
+}
 
-    sqlite3_finalize(stmt);
-    return 0;
+// Low-stock notifications
+
+void set_low_stock_callback(Database *db, LowStockCallback callback, void *context) {
+    db->low_stock_callback = callback;
+    db->low_stock_context = context;
 }
 
-// Delete a product
-int delete_product(Database *db, int product_id) {
-    const char *query = "DELETE FROM Products WHERE product_id = ?;";
-    sqlite3_stmt *stmt;
+static void notify_low_stock(Database *db, const Product *product, int below) {
+    if (db->low_stock_callback) {
+        db->low_stock_callback(product, below, db->low_stock_context);
+    }
+}
 
-    if (sqlite3_prepare_v2(db->connection, query, -1, &stmt, NULL) != SQLITE_OK) {
-        fprintf(stderr, "Failed to prepare statement: %s\n", sqlite3_errmsg(db->connection));
-        return -1;
+// Apply a stock change to the catalog and report a reorder-level crossing
+static void set_cached_stock(Database *db, int product_id, int stock_quantity) {
+    int crossed;
+    Product *product = catalog_set_stock(&db->catalog, product_id, stock_quantity, &crossed);
+    if (product && crossed) {
+        notify_low_stock(db, product, crossed > 0);
     }
+}
+
+// Products Table Operations
+
+// Record a product's stock as of now
+static int set_stock_checkpoint(Database *db, int product_id, int stock_quantity) {
+    sqlite3_stmt *stmt = db->statements[STMT_SET_CHECKPOINT];
 
     sqlite3_bind_int(stmt, 1, product_id);
+    sqlite3_bind_int(stmt, 2, stock_quantity);
 
-    if (sqlite3_step(stmt) != SQLITE_DONE) {
-        fprintf(stderr, "Failed to execute statement: %s\n", sqlite3_errmsg(db->connection));
-        sqlite3_finalize(stmt);
-        return -1;
+    int status = sqlite3_step(stmt) == SQLITE_DONE ? 0 : -1;
+    if (status != 0) {
+        fprintf(stderr, "Failed to record stock checkpoint: %s\n", sqlite3_errmsg(db->connection));
     }
-
-    sqlite3_finalize(stmt);
-    return 0;
+    reset_statement(stmt);
+    return status;
 }
 
-// List all products
-int list_all_products(Database *db) {
-    const char *query = "SELECT * FROM Products;";
-    sqlite3_stmt *stmt;
-
-    // Prepare the SQL statement
-    if (sqlite3_prepare_v2(db->connection, query, -1, &stmt, NULL) != SQLITE_OK) {
-        fprintf(stderr, "Failed to prepare statement: %s\n", sqlite3_errmsg(db->connection));
-        return -1; // Error code for preparation failure
+// Add a new product
+static int add_product_unmetered(Database *db, int product_id, const char *name,
+                                 const char *description, const char *category, double cost_price,
+                                 double selling_price, int stock_quantity, int reorder_level) {
+    // The product and its first stock checkpoint commit together
+    if (run_statement(db, STMT_SAVEPOINT) != 0) {
+        return -1;
     }
 
-    // Print table headers
-    printf("%-4s %-20s %-30s %-15s %-10s %-12s %-8s %-15s\n",
-           "ID", "Name", "Description", "Category", "Cost", "Selling", "Stock", "Reorder Level");
-
-    // Loop through each row returned by the query
-    int row_count = 0; // Counter for rows
-    while (sqlite3_step(stmt) == SQLITE_ROW) {
-        row_count++;
-        int id = sqlite3_column_int(stmt, 0);
-        const char *name = (const char *)sqlite3_column_text(stmt, 1);
-        const char *description = (const char *)sqlite3_column_text(stmt, 2);
-        const char *category = (const char *)sqlite3_column_text(stmt, 3);
-        double cost_price = sqlite3_column_double(stmt, 4);
-        double selling_price = sqlite3_column_double(stmt, 5);
-        int stock_quantity = sqlite3_column_int(stmt, 6);
-        int reorder_level = sqlite3_column_int(stmt, 7);
+    sqlite3_stmt *stmt = db->statements[STMT_ADD_PRODUCT];
 
-        // Print each row
-        printf("%-4d %-20s %-30s %-15s %-10.2f %-12.2f %-8d %-15d\n",
-               id, name, description, category, cost_price, selling_price, stock_quantity, reorder_level);
+    // A NULL product_id lets AUTOINCREMENT pick the next one
+    if (product_id > 0) {
+        sqlite3_bind_int(stmt, 1, product_id);
+    } else {
+        sqlite3_bind_null(stmt, 1);
     }
+    sqlite3_bind_text(stmt, 2, name, -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 3, description, -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 4, category, -1, SQLITE_STATIC);
+    sqlite3_bind_double(stmt, 5, cost_price);
+    sqlite3_bind_double(stmt, 6, selling_price);
+    sqlite3_bind_int(stmt, 7, stock_quantity);
+    sqlite3_bind_int(stmt, 8, reorder_level);
 
-    // Finalize the prepared statement to release resources
-    sqlite3_finalize(stmt);
-
-    // Check if no rows were returned
-    if (row_count == 0) {
-        printf("No products found in the database.\n");
+    if (sqlite3_step(stmt) != SQLITE_DONE) {
+        fprintf(stderr, "Failed to execute statement: %s\n", sqlite3_errmsg(db->connection));
+        reset_statement(stmt);
+        goto rollback;
     }
 
-    return 0; // Success
-}
+    reset_statement(stmt);
 
-// Sales Report
-int generate_sales_report(Database *db, const char *start_date, const char *end_date) {
-    const char *query =
-        "SELECT p.product_name, SUM(t.quantity) AS total_sold, SUM(t.quantity * p.selling_price) AS total_sales "
-        "FROM Transactions t "
-        "JOIN Products p ON t.product_id = p.product_id "
-        "WHERE t.transaction_type = 'OUT' "
-        "AND t.transaction_date BETWEEN ? AND ? "
-        "GROUP BY p.product_name;";
+    product_id = (int)sqlite3_last_insert_rowid(db->connection);
+    if (set_stock_checkpoint(db, product_id, stock_quantity) != 0) {
+        goto rollback;
+    }
+    if (run_statement(db, STMT_RELEASE_SAVEPOINT) != 0) {
+        return -1;
+    }
 
-    sqlite3_stmt *stmt;
-    if (sqlite3_prepare_v2(db->connection, query, -1, &stmt, NULL) != SQLITE_OK) {
-        fprintf(stderr, "Failed to prepare statement: %s\n", sqlite3_errmsg(db->connection));
+    // Keep the catalog coherent with the new row
+    Product product = {
+        .product_id = product_id,
+        .product_name = (char *)name,
+        .description = (char *)description,
+        .category = (char *)category,
+        .cost_price = cost_price,
+        .selling_price = selling_price,
+        .stock_quantity = stock_quantity,
+        .reorder_level = reorder_level,
+    };
+    if (catalog_put(&db->catalog, &product) != 0) {
         return -1;
     }
+    if (stock_quantity < reorder_level) {
+        notify_low_stock(db, catalog_find(&db->catalog, product.product_id), 1);
+    }
+    return 0;
 
-    sqlite3_bind_text(stmt, 1, start_date, -1, SQLITE_STATIC);
-    sqlite3_bind_text(stmt, 2, end_date, -1, SQLITE_STATIC);
+rollback:
+    run_statement(db, STMT_ROLLBACK_SAVEPOINT);
+    run_statement(db, STMT_RELEASE_SAVEPOINT);
+    return -1;
+}
 
-    printf("Sales Report (%s to %s)\n", start_date, end_date);
-    printf("Product\t\tTotal Sold\tTotal Sales\n");
-    while (sqlite3_step(stmt) == SQLITE_ROW) {
-        const char *product_name = (const char *)sqlite3_column_text(stmt, 0);
-        int total_sold = sqlite3_column_int(stmt, 1);
-        double total_sales = sqlite3_column_double(stmt, 2);
+// Delete a product
+static int delete_product_unmetered(Database *db, int product_id) {
+    sqlite3_stmt *stmt = db->statements[STMT_DELETE_PRODUCT];
+
+    sqlite3_bind_int(stmt, 1, product_id);
 
-        printf("%s\t\t%d\t\t%.2f\n", product_name, total_sold, total_sales);
+    if (sqlite3_step(stmt) != SQLITE_DONE) {
+        fprintf(stderr, "Failed to execute statement: %s\n", sqlite3_errmsg(db->connection));
+        reset_statement(stmt);
+        return -1;
     }
 
-    sqlite3_finalize(stmt);
+    reset_statement(stmt);
+
+    catalog_remove(&db->catalog, product_id);
     return 0;
 }
 
-// Suppliers Table Operations
-
-// Add a new supplier
-int add_supplier(Database *db, const char *name, const char *contact_info, const char *address) {
-    const char *query =
-        "INSERT INTO Suppliers (supplier_name, contact_info, address) "
-        "VALUES (?, ?, ?);";
-    sqlite3_stmt *stmt;
-
-    if (sqlite3_prepare_v2(db->connection, query, -1, &stmt, NULL) != SQLITE_OK) {
-        fprintf(stderr, "Failed to prepare statement: %s\n", sqlite3_errmsg(db->connection));
+// Set a product's stock level directly (stock count corrections)
+static int update_stock_quantity_unmetered(Database *db, int product_id, int new_quantity) {
+    // A manual count is not a transaction, so it starts a new checkpoint
+    if (run_statement(db, STMT_SAVEPOINT) != 0) {
         return -1;
     }
 
-    sqlite3_bind_text(stmt, 1, name, -1, SQLITE_STATIC);
-    sqlite3_bind_text(stmt, 2, contact_info, -1, SQLITE_STATIC);
-    sqlite3_bind_text(stmt, 3, address, -1, SQLITE_STATIC);
+    sqlite3_stmt *stmt = db->statements[STMT_UPDATE_STOCK];
+
+    sqlite3_bind_int(stmt, 1, new_quantity);
+    sqlite3_bind_int(stmt, 2, product_id);
 
     if (sqlite3_step(stmt) != SQLITE_DONE) {
         fprintf(stderr, "Failed to execute statement: %s\n", sqlite3_errmsg(db->connection));
-        sqlite3_finalize(stmt);
+        reset_statement(stmt);
+        goto rollback;
+    }
+    reset_statement(stmt);
+
+    if (sqlite3_changes(db->connection) == 0) {
+        fprintf(stderr, "Product %d not found\n", product_id);
+        goto rollback;
+    }
+    if (set_stock_checkpoint(db, product_id, new_quantity) != 0) {
+        goto rollback;
+    }
+    if (run_statement(db, STMT_RELEASE_SAVEPOINT) != 0) {
         return -1;
     }
 
-    sqlite3_finalize(stmt);
+    set_cached_stock(db, product_id, new_quantity);
     return 0;
+
+rollback:
+    run_statement(db, STMT_ROLLBACK_SAVEPOINT);
+    run_statement(db, STMT_RELEASE_SAVEPOINT);
+    return -1;
 }
 
-// List all suppliers
-int list_all_suppliers(Database *db) {
-    const char *query = "SELECT * FROM Suppliers;";
-    sqlite3_stmt *stmt;
+// Read-only handles share the file with a writer, so their catalog cannot be
+// kept coherent; lookups go to SQL and the catalog holds just the last row
+static int fetch_product(Database *db, int product_id, Product *product) {
+    sqlite3_stmt *stmt = db->statements[STMT_GET_PRODUCT];
+    int status = -1;
 
-    if (sqlite3_prepare_v2(db->connection, query, -1, &stmt, NULL) != SQLITE_OK) {
-        fprintf(stderr, "Failed to prepare statement: %s\n", sqlite3_errmsg(db->connection));
-        return -1;
+    sqlite3_bind_int(stmt, 1, product_id);
+
+    int rc = sqlite3_step(stmt);
+    catalog_clear(&db->catalog);
+    if (rc == SQLITE_ROW) {
+        Product row;
+        read_product_row(stmt, &row);
+        if (catalog_put(&db->catalog, &row) == 0) {
+            *product = *catalog_find(&db->catalog, product_id);
+            status = 0;
+        }
+    } else if (rc != SQLITE_DONE) {
+        fprintf(stderr, "Failed to execute statement: %s\n", sqlite3_errmsg(db->connection));
     }
 
-    printf("ID\tName\tContact Info\tAddress\n");
-    while (sqlite3_step(stmt) == SQLITE_ROW) {
-        int id = sqlite3_column_int(stmt, 0);
-        const char *name = (const char *)sqlite3_column_text(stmt, 1);
-        const char *contact_info = (const char *)sqlite3_column_text(stmt, 2);
-        const char *address = (const char *)sqlite3_column_text(stmt, 3);
+    reset_statement(stmt);
+    return status;
+}
 
-        printf("%d\t%s\t%s\t%s\n", id, name, contact_info, address);
+// Look up a product by id from the in-memory catalog
+static int get_product_by_id_unmetered(Database *db, int product_id, Product *product) {
+    if (db->config.read_only) {
+        return fetch_product(db, product_id, product);
     }
 
-    sqlite3_finalize(stmt);
+    Product *cached = catalog_find(&db->catalog, product_id);
+    if (!cached) {
+        return -1;
+    }
+    *product = *cached;
     return 0;
 }
 
-// Transactions Table Operations
+// Visit all products in table order
+static int visit_products_unmetered(Database *db, ProductVisitor visitor, void *context) {
+    int last_id;
+    return visit_product_cursor(db, db->statements[STMT_LIST_PRODUCTS], -1, visitor, context, &last_id);
+}
 
-// Add a new transaction
-int add_transaction(Database *db, int product_id, const char *transaction_type,
-                    int quantity, const char *transaction_date, int customer_supplier_id) {
-    const char *query =
-        "INSERT INTO Transactions (product_id, transaction_type, quantity, transaction_date, customer_supplier_id) "
-        "VALUES (?, ?, ?, ?, ?);";
-    sqlite3_stmt *stmt;
+int write_product_row(const Product *product, void *context) {
+    OutputSink *sink = context;
+    output_int(sink, product->product_id);
+    output_text(sink, product->product_name);
+    output_text(sink, product->description);
+    output_text(sink, product->category);
+    output_decimal(sink, product->cost_price, 2);
+    output_decimal(sink, product->selling_price, 2);
+    output_int(sink, product->stock_quantity);
+    output_int(sink, product->reorder_level);
+    output_end_row(sink);
+    return 0;
+}
+
+// Stream all products to a sink; returns the number of rows written or -1
+static int write_products_unmetered(Database *db, OutputSink *sink) {
+    output_begin(sink, product_columns, PRODUCT_COLUMN_COUNT);
+    return visit_products(db, write_product_row, sink);
+}
 
-    if (sqlite3_prepare_v2(db->connection, query, -1, &stmt, NULL) != SQLITE_OK) {
-        fprintf(stderr, "Failed to prepare statement: %s\n", sqlite3_errmsg(db->connection));
+// List all products
+static int list_all_products_unmetered(Database *db) {
+    OutputSink sink;
+    if (open_stdout_table(&sink) != 0) {
         return -1;
     }
 
-    sqlite3_bind_int(stmt, 1, product_id);
-    sqlite3_bind_text(stmt, 2, transaction_type, -1, SQLITE_STATIC);
-    sqlite3_bind_int(stmt, 3, quantity);
-    sqlite3_bind_text(stmt, 4, transaction_date, -1, SQLITE_STATIC);
-    sqlite3_bind_int(stmt, 5, customer_supplier_id);
-
-    if (sqlite3_step(stmt) != SQLITE_DONE) {
-        fprintf(stderr, "Failed to execute statement: %s\n", sqlite3_errmsg(db->connection));
-        sqlite3_finalize(stmt);
+    int row_count = write_products(db, &sink);
+    if (output_close(&sink) != 0 || row_count < 0) {
         return -1;
     }
 
-    sqlite3_finalize(stmt);
-    return 0;
-}
+    // Check if no rows were returned
+    if (row_count == 0) {
+        printf("No products found in the database.\n");
+    }
+
+    return 0; // Success
+}
+
+// Visit the sales report rows for a date range
+static int visit_sales_report_unmetered(Database *db, const char *start_date, const char *end_date,
+                                        SalesReportVisitor visitor, void *context) {
+    sqlite3_stmt *stmt = db->statements[STMT_SALES_REPORT];
+    int row_count = 0;
+    int rc;
+
+    sqlite3_bind_text(stmt, 1, start_date, -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 2, end_date, -1, SQLITE_STATIC);
+
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        SalesReportRow row = {
+            .product_name = (char *)sqlite3_column_text(stmt, 0),
+            .total_sold = sqlite3_column_int64(stmt, 1),
+            .total_sales = sqlite3_column_double(stmt, 2),
+        };
+        row_count++;
+        if (visitor(&row, context) != 0) {
+            rc = SQLITE_DONE;
+            break;
+        }
+    }
+
+    return finish_query(db, stmt, rc, row_count);
+}
+
+int write_sales_report_row(const SalesReportRow *row, void *context) {
+    OutputSink *sink = context;
+    output_text(sink, row->product_name);
+    output_int(sink, row->total_sold);
+    output_decimal(sink, row->total_sales, 2);
+    output_end_row(sink);
+    return 0;
+}
+
+// Stream the sales report for a date range to a sink
+static int write_sales_report_unmetered(Database *db, const char *start_date, const char *end_date,
+                                        OutputSink *sink) {
+    output_begin(sink, sales_report_columns, SALES_REPORT_COLUMN_COUNT);
+    return visit_sales_report(db, start_date, end_date, write_sales_report_row, sink);
+}
+
+// Visit one page of products with product_id > after_id
+// *next_after_id is set to the token for the following page, or 0 after the last page.
+static int visit_products_page_unmetered(Database *db, int page_size, int after_id, ProductVisitor visitor,
+                                         void *context, int *next_after_id) {
+    sqlite3_stmt *stmt = db->statements[STMT_PRODUCTS_PAGE];
+    int last_id = 0;
+
+    sqlite3_bind_int(stmt, 1, after_id);
+    sqlite3_bind_int(stmt, 2, page_size);
+
+    int row_count = visit_product_cursor(db, stmt, page_size, visitor, context, &last_id);
+    // last_id is 0 when the visitor ended the page
+    *next_after_id = row_count == page_size ? last_id : 0;
+    return row_count;
+}
+
+// Stream one page of products to a sink
+static int write_products_page_unmetered(Database *db, int page_size, int after_id, OutputSink *sink,
+                                         int *next_after_id) {
+    output_begin(sink, product_columns, PRODUCT_COLUMN_COUNT);
+    return visit_products_page(db, page_size, after_id, write_product_row, sink, next_after_id);
+}
+
+// List one page of products
+static int list_products_page_unmetered(Database *db, int page_size, int after_id, int *next_after_id) {
+    OutputSink sink;
+    if (open_stdout_table(&sink) != 0) {
+        return -1;
+    }
+
+    int row_count = write_products_page(db, page_size, after_id, &sink, next_after_id);
+    return output_close(&sink) != 0 || row_count < 0 ? -1 : 0;
+}
+
+// Sales Report
+static int generate_sales_report_unmetered(Database *db, const char *start_date, const char *end_date) {
+    OutputSink sink;
+    if (open_stdout_table(&sink) != 0) {
+        return -1;
+    }
+
+    printf("Sales Report (%s to %s)\n", start_date, end_date);
+    fflush(stdout);
+
+    int row_count = write_sales_report(db, start_date, end_date, &sink);
+    return output_close(&sink) != 0 || row_count < 0 ? -1 : 0;
+}
+
+// Suppliers Table Operations
+
+// Add a new supplier
+static int add_supplier_unmetered(Database *db, const char *name, const char *contact_info,
+                                  const char *address) {
+    sqlite3_stmt *stmt = db->statements[STMT_ADD_SUPPLIER];
+
+    sqlite3_bind_text(stmt, 1, name, -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 2, contact_info, -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 3, address, -1, SQLITE_STATIC);
+
+    if (sqlite3_step(stmt) != SQLITE_DONE) {
+        fprintf(stderr, "Failed to execute statement: %s\n", sqlite3_errmsg(db->connection));
+        reset_statement(stmt);
+        return -1;
+    }
+
+    reset_statement(stmt);
+    return 0;
+}
+
+// Look up a supplier by id
+static int get_supplier_by_id_unmetered(Database *db, int supplier_id, Supplier *supplier) {
+    sqlite3_stmt *stmt = db->statements[STMT_GET_SUPPLIER];
+    int status = -1;
+
+    sqlite3_bind_int(stmt, 1, supplier_id);
+
+    int rc = sqlite3_step(stmt);
+    if (rc == SQLITE_ROW) {
+        supplier->supplier_id = sqlite3_column_int(stmt, 0);
+        supplier->supplier_name = column_strdup(stmt, 1);
+        supplier->contact_info = column_strdup(stmt, 2);
+        supplier->address = column_strdup(stmt, 3);
+        status = 0;
+    } else if (rc != SQLITE_DONE) {
+        fprintf(stderr, "Failed to execute statement: %s\n", sqlite3_errmsg(db->connection));
+    }
+
+    reset_statement(stmt);
+    return status;
+}
+
+// Release the strings of a supplier returned by get_supplier_by_id
+void free_supplier(Supplier *supplier) {
+    free(supplier->supplier_name);
+    free(supplier->contact_info);
+    free(supplier->address);
+    supplier->supplier_name = supplier->contact_info = supplier->address = NULL;
+}
+
+// Visit all suppliers in table order
+static int visit_suppliers_unmetered(Database *db, SupplierVisitor visitor, void *context) {
+    sqlite3_stmt *stmt = db->statements[STMT_LIST_SUPPLIERS];
+    int row_count = 0;
+    int rc;
+
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        Supplier row = {
+            .supplier_id = sqlite3_column_int(stmt, 0),
+            .supplier_name = (char *)sqlite3_column_text(stmt, 1),
+            .contact_info = (char *)sqlite3_column_text(stmt, 2),
+            .address = (char *)sqlite3_column_text(stmt, 3),
+        };
+        row_count++;
+        if (visitor(&row, context) != 0) {
+            rc = SQLITE_DONE;
+            break;
+        }
+    }
+
+    return finish_query(db, stmt, rc, row_count);
+}
+
+int write_supplier_row(const Supplier *supplier, void *context) {
+    OutputSink *sink = context;
+    output_int(sink, supplier->supplier_id);
+    output_text(sink, supplier->supplier_name);
+    output_text(sink, supplier->contact_info);
+    output_text(sink, supplier->address);
+    output_end_row(sink);
+    return 0;
+}
+
+// Stream all suppliers to a sink
+static int write_suppliers_unmetered(Database *db, OutputSink *sink) {
+    output_begin(sink, supplier_columns, SUPPLIER_COLUMN_COUNT);
+    return visit_suppliers(db, write_supplier_row, sink);
+}
+
+// List all suppliers
+static int list_all_suppliers_unmetered(Database *db) {
+    OutputSink sink;
+    if (open_stdout_table(&sink) != 0) {
+        return -1;
+    }
+
+    int row_count = write_suppliers(db, &sink);
+    return output_close(&sink) != 0 || row_count < 0 ? -1 : 0;
+}
+
+// Transactions Table Operations
+
+TransactionType parse_transaction_type(const char *name) {
+    if (strcmp(name, "IN") == 0) {
+        return TRANSACTION_IN;
+    }
+    if (strcmp(name, "OUT") == 0) {
+        return TRANSACTION_OUT;
+    }
+    return 0;
+}
+
+// Periodic checkpoint: once checkpoint_interval transactions have been added
+// since the last one, checkpoint the products among them that have moved
+// STOCK_CHECKPOINT_MIN_MOVEMENTS times since their own last checkpoint. Only
+// products with new transactions can have crossed that count, so the cost
+// follows the interval rather than the catalog size.
+static void checkpoint_if_due(Database *db, sqlite3_int64 transaction_id) {
+    if (db->checkpoint_after_id == 0) {
+        db->checkpoint_after_id = transaction_id - 1;
+    }
+    if (transaction_id - db->checkpoint_after_id < db->config.checkpoint_interval) {
+        return;
+    }
+
+    sqlite3_stmt *stmt = db->statements[STMT_CHECKPOINT_MOVED];
+    sqlite3_bind_int(stmt, 1, STOCK_CHECKPOINT_MIN_MOVEMENTS);
+    sqlite3_bind_int64(stmt, 2, db->checkpoint_after_id);
+    if (sqlite3_step(stmt) == SQLITE_DONE) {
+        db->checkpoint_after_id = transaction_id;
+    } else {
+        fprintf(stderr, "Failed to create stock checkpoint: %s\n", sqlite3_errmsg(db->connection));
+    }
+    reset_statement(stmt);
+}
+
+// Add a new transaction
+static int add_transaction_unmetered(Database *db, int product_id, const char *transaction_type, int quantity,
+                                     const char *transaction_date, int customer_supplier_id) {
+    TransactionType type = parse_transaction_type(transaction_type);
+    if (type == 0) {
+        fprintf(stderr, "Invalid transaction type: %s (expected IN or OUT)\n", transaction_type);
+        return -1;
+    }
+    // The type gives the direction; a zero or negative quantity would invert it
+    if (quantity <= 0) {
+        fprintf(stderr, "Invalid quantity: %d (expected a positive number)\n", quantity);
+        return -1;
+    }
+    int delta = type == TRANSACTION_IN ? quantity : -quantity;
+
+    // The savepoint nests inside a caller's BEGIN (bulk ingest) or commits on its own
+    if (run_statement(db, STMT_SAVEPOINT) != 0) {
+        return -1;
+    }
+
+    sqlite3_stmt *stmt = db->statements[STMT_ADD_TRANSACTION];
+
+    sqlite3_bind_int(stmt, 1, product_id);
+    sqlite3_bind_int(stmt, 2, type);
+    sqlite3_bind_int(stmt, 3, quantity);
+    sqlite3_bind_text(stmt, 4, transaction_date, -1, SQLITE_STATIC);
+    sqlite3_bind_int(stmt, 5, customer_supplier_id);
+
+    if (sqlite3_step(stmt) != SQLITE_DONE) {
+        fprintf(stderr, "Failed to execute statement: %s\n", sqlite3_errmsg(db->connection));
+        reset_statement(stmt);
+        goto rollback;
+    }
+    reset_statement(stmt);
+    sqlite3_int64 transaction_id = sqlite3_last_insert_rowid(db->connection);
+
+    // Adjust stock in the same transaction
+    stmt = db->statements[STMT_ADJUST_STOCK];
+    sqlite3_bind_int(stmt, 1, delta);
+    sqlite3_bind_int(stmt, 2, product_id);
+    sqlite3_bind_int(stmt, 3, db->config.reject_negative_stock);
+
+    if (sqlite3_step(stmt) != SQLITE_DONE) {
+        fprintf(stderr, "Failed to update stock: %s\n", sqlite3_errmsg(db->connection));
+        reset_statement(stmt);
+        goto rollback;
+    }
+    reset_statement(stmt);
+
+    if (sqlite3_changes(db->connection) == 0) {
+        fprintf(stderr, "Product %d not found or insufficient stock for %s of %d\n",
+                product_id, transaction_type, quantity);
+        goto rollback;
+    }
+
+    // Roll sales into the daily aggregate used by generate_sales_report
+    if (delta < 0) {
+        stmt = db->statements[STMT_ADD_DAILY_SALES];
+        sqlite3_bind_text(stmt, 1, transaction_date, -1, SQLITE_STATIC);
+        sqlite3_bind_int(stmt, 2, product_id);
+        sqlite3_bind_int(stmt, 3, quantity);
+
+        if (sqlite3_step(stmt) != SQLITE_DONE) {
+            fprintf(stderr, "Failed to update daily sales: %s\n", sqlite3_errmsg(db->connection));
+            reset_statement(stmt);
+            goto rollback;
+        }
+        reset_statement(stmt);
+    }
+
+    // A backdated movement also belongs in every checkpoint taken since its date
+    stmt = db->statements[STMT_SHIFT_CHECKPOINTS];
+    sqlite3_bind_int(stmt, 1, delta);
+    sqlite3_bind_int(stmt, 2, product_id);
+    sqlite3_bind_text(stmt, 3, transaction_date, -1, SQLITE_STATIC);
+
+    if (sqlite3_step(stmt) != SQLITE_DONE) {
+        fprintf(stderr, "Failed to update stock checkpoints: %s\n", sqlite3_errmsg(db->connection));
+        reset_statement(stmt);
+        goto rollback;
+    }
+    reset_statement(stmt);
+
+    if (run_statement(db, STMT_RELEASE_SAVEPOINT) != 0) {
+        return -1;
+    }
+
+    Product *cached = catalog_find(&db->catalog, product_id);
+    if (cached) {
+        set_cached_stock(db, product_id, cached->stock_quantity + delta);
+    }
+
+    // The transaction stands even if the periodic checkpoint fails
+    if (db->config.checkpoint_interval > 0) {
+        checkpoint_if_due(db, transaction_id);
+    }
+    return 0;
+
+rollback:
+    run_statement(db, STMT_ROLLBACK_SAVEPOINT);
+    run_statement(db, STMT_RELEASE_SAVEPOINT);
+    return -1;
+}
+
+// Visit transactions of one type
+static int visit_transactions_unmetered(Database *db, const char *transaction_type,
+                                        TransactionVisitor visitor, void *context) {
+    sqlite3_stmt *stmt = db->statements[STMT_LIST_TRANSACTIONS];
+    int last_id;
+
+    sqlite3_bind_int(stmt, 1, parse_transaction_type(transaction_type));
+    return visit_transaction_cursor(db, stmt, -1, visitor, context, &last_id);
+}
+
+static int write_transaction_row(const TransactionRecord *transaction, void *context) {
+    OutputSink *sink = context;
+    output_int(sink, transaction->transaction_id);
+    output_text(sink, transaction->product_name);
+    output_int(sink, transaction->quantity);
+    output_text(sink, transaction->transaction_date);
+    output_int(sink, transaction->customer_supplier_id);
+    output_end_row(sink);
+    return 0;
+}
+
+// Stream transactions of one type to a sink
+static int write_transactions_unmetered(Database *db, const char *transaction_type, OutputSink *sink) {
+    output_begin(sink, transaction_columns, TRANSACTION_COLUMN_COUNT);
+    return visit_transactions(db, transaction_type, write_transaction_row, sink);
+}
 
 // List transactions by type (IN or OUT)
-int list_transactions(Database *db, const char *transaction_type) {
-    const char *query =
-        "SELECT t.transaction_id, p.product_name, t.quantity, t.transaction_date, t.customer_supplier_id "
-        "FROM Transactions t "
-        "JOIN Products p ON t.product_id = p.product_id "
-        "WHERE t.transaction_type = ?;";
-    sqlite3_stmt *stmt;
+static int list_transactions_unmetered(Database *db, const char *transaction_type) {
+    OutputSink sink;
+    if (open_stdout_table(&sink) != 0) {
+        return -1;
+    }
+
+    int row_count = write_transactions(db, transaction_type, &sink);
+    return output_close(&sink) != 0 || row_count < 0 ? -1 : 0;
+}
+
+// Visit one page of transactions of a type with transaction_id > after_id
+static int visit_transactions_page_unmetered(Database *db, const char *transaction_type, int page_size,
+                                             int after_id, TransactionVisitor visitor, void *context,
+                                             int *next_after_id) {
+    sqlite3_stmt *stmt = db->statements[STMT_TRANSACTIONS_PAGE];
+    int last_id = 0;
+
+    sqlite3_bind_int(stmt, 1, parse_transaction_type(transaction_type));
+    sqlite3_bind_int(stmt, 2, after_id);
+    sqlite3_bind_int(stmt, 3, page_size);
+
+    int row_count = visit_transaction_cursor(db, stmt, page_size, visitor, context, &last_id);
+    // last_id is 0 when the visitor ended the page
+    *next_after_id = row_count == page_size ? last_id : 0;
+    return row_count;
+}
+
+// Stream one page of transactions of a type to a sink
+static int write_transactions_page_unmetered(Database *db, const char *transaction_type, int page_size,
+                                             int after_id, OutputSink *sink, int *next_after_id) {
+    output_begin(sink, transaction_columns, TRANSACTION_COLUMN_COUNT);
+    return visit_transactions_page(db, transaction_type, page_size, after_id, write_transaction_row, sink,
+                                   next_after_id);
+}
 
-    if (sqlite3_prepare_v2(db->connection, query, -1, &stmt, NULL) != SQLITE_OK) {
-        fprintf(stderr, "Failed to prepare statement: %s\n", sqlite3_errmsg(db->connection));
+// List one page of transactions of a type
+static int list_transactions_page_unmetered(Database *db, const char *transaction_type, int page_size,
+                                            int after_id, int *next_after_id) {
+    OutputSink sink;
+    if (open_stdout_table(&sink) != 0) {
         return -1;
     }
 
-    sqlite3_bind_text(stmt, 1, transaction_type, -1, SQLITE_STATIC);
+    int row_count = write_transactions_page(db, transaction_type, page_size, after_id, &sink, next_after_id);
+    return output_close(&sink) != 0 || row_count < 0 ? -1 : 0;
+}
+
+// Record-returning queries
 
-    printf("Transaction ID\tProduct\tQuantity\tDate\tCustomer/Supplier ID\n");
-    while (sqlite3_step(stmt) == SQLITE_ROW) {
-        int transaction_id = sqlite3_column_int(stmt, 0);
-        const char *product_name = (const char *)sqlite3_column_text(stmt, 1);
-        int quantity = sqlite3_column_int(stmt, 2);
-        const char *transaction_date = (const char *)sqlite3_column_text(stmt, 3);
-        int customer_supplier_id = sqlite3_column_int(stmt, 4);
+// Copy text into the arena; fails only when a non-NULL string could not be copied
+static int arena_copy_text(Arena *arena, const char *text, char **copy) {
+    *copy = arena_strdup(arena, text);
+    return text && !*copy ? -1 : 0;
+}
 
-        printf("%d\t%s\t%d\t%s\t%d\n", transaction_id, product_name, quantity, transaction_date, customer_supplier_id);
+static int copy_product(Arena *arena, const Product *source, Product *copy) {
+    *copy = *source;
+    if (arena_copy_text(arena, source->product_name, &copy->product_name) != 0 ||
+        arena_copy_text(arena, source->description, &copy->description) != 0 ||
+        arena_copy_text(arena, source->category, &copy->category) != 0) {
+        fprintf(stderr, "Out of memory copying product %d\n", source->product_id);
+        return -1;
     }
+    return 0;
+}
 
-    sqlite3_finalize(stmt);
+static int get_product_record_unmetered(Database *db, int product_id, Arena *arena, Product **product) {
+    Product found;
+    if (get_product_by_id(db, product_id, &found) != 0) {
+        return -1;
+    }
+    *product = arena_alloc(arena, sizeof(Product));
+    return *product ? copy_product(arena, &found, *product) : -1;
+}
+
+static int get_supplier_record_unmetered(Database *db, int supplier_id, Arena *arena, Supplier **supplier) {
+    sqlite3_stmt *stmt = db->statements[STMT_GET_SUPPLIER];
+    int status = -1;
+
+    sqlite3_bind_int(stmt, 1, supplier_id);
+
+    int rc = sqlite3_step(stmt);
+    if (rc == SQLITE_ROW) {
+        Supplier *record = arena_alloc(arena, sizeof(Supplier));
+        if (record) {
+            record->supplier_id = sqlite3_column_int(stmt, 0);
+            if (arena_copy_text(arena, (const char *)sqlite3_column_text(stmt, 1), &record->supplier_name) == 0 &&
+                arena_copy_text(arena, (const char *)sqlite3_column_text(stmt, 2), &record->contact_info) == 0 &&
+                arena_copy_text(arena, (const char *)sqlite3_column_text(stmt, 3), &record->address) == 0) {
+                *supplier = record;
+                status = 0;
+            }
+        }
+    } else if (rc != SQLITE_DONE) {
+        fprintf(stderr, "Failed to execute statement: %s\n", sqlite3_errmsg(db->connection));
+    }
+
+    reset_statement(stmt);
+    return status;
+}
+
+// Collects visited rows into an array grown inside an arena
+typedef struct {
+    Arena *arena;
+    void *rows;
+    size_t row_size;
+    int count;
+    int capacity;
+    int failed;
+} RecordCollector;
+
+static void collector_init(RecordCollector *collector, Arena *arena, size_t row_size, int capacity) {
+    collector->arena = arena;
+    collector->rows = NULL;
+    collector->row_size = row_size;
+    collector->count = 0;
+    collector->capacity = 0;
+    collector->failed = 0;
+    if (capacity > 0) {
+        collector->rows = arena_alloc(arena, row_size * capacity);
+        collector->capacity = collector->rows ? capacity : 0;
+    }
+}
+
+// Slot for the next row, or NULL (and failed set) when out of memory
+static void *collector_next(RecordCollector *collector) {
+    if (collector->count == collector->capacity) {
+        int grown = collector->capacity ? collector->capacity * 2 : 64;
+        void *rows = arena_grow(collector->arena, collector->rows, collector->row_size * collector->capacity,
+                                collector->row_size * grown);
+        if (!rows) {
+            collector->failed = 1;
+            return NULL;
+        }
+        collector->rows = rows;
+        collector->capacity = grown;
+    }
+    return (char *)collector->rows + collector->row_size * collector->count++;
+}
+
+// Finish a collection; returns the row count or -1
+static int collector_finish(RecordCollector *collector, int row_count, void **rows) {
+    if (collector->failed) {
+        fprintf(stderr, "Out of memory collecting rows\n");
+        return -1;
+    }
+    *rows = collector->rows;
+    return row_count < 0 ? -1 : collector->count;
+}
+
+static int collect_product(const Product *product, void *context) {
+    RecordCollector *collector = context;
+    Product *copy = collector_next(collector);
+    if (!copy || copy_product(collector->arena, product, copy) != 0) {
+        collector->failed = 1;
+        return 1;
+    }
     return 0;
 }
-int list_low_stock_products(Database *db) {
-    const char *query = "SELECT product_id, name, stock_quantity, reorder_level FROM Products WHERE stock_quantity < reorder_level;";
-    sqlite3_stmt *stmt;
 
-    if (sqlite3_prepare_v2(db->connection, query, -1, &stmt, NULL) != SQLITE_OK) {
-        fprintf(stderr, "Failed to prepare low stock query: %s\n", sqlite3_errmsg(db->connection));
+static int collect_transaction(const TransactionRecord *transaction, void *context) {
+    RecordCollector *collector = context;
+    TransactionRecord *copy = collector_next(collector);
+    if (!copy) {
+        return 1;
+    }
+    *copy = *transaction;
+    if (arena_copy_text(collector->arena, transaction->product_name, &copy->product_name) != 0 ||
+        arena_copy_text(collector->arena, transaction->transaction_date, &copy->transaction_date) != 0) {
+        collector->failed = 1;
+        return 1;
+    }
+    return 0;
+}
+
+static int collect_sales_report_row(const SalesReportRow *row, void *context) {
+    RecordCollector *collector = context;
+    SalesReportRow *copy = collector_next(collector);
+    if (!copy) {
+        return 1;
+    }
+    *copy = *row;
+    if (arena_copy_text(collector->arena, row->product_name, &copy->product_name) != 0) {
+        collector->failed = 1;
+        return 1;
+    }
+    return 0;
+}
+
+static int get_products_page_unmetered(Database *db, int page_size, int after_id, Arena *arena,
+                                       Product **rows, int *next_after_id) {
+    RecordCollector collector;
+    collector_init(&collector, arena, sizeof(Product), page_size);
+    int row_count = visit_products_page(db, page_size, after_id, collect_product, &collector, next_after_id);
+    return collector_finish(&collector, row_count, (void **)rows);
+}
+
+static int get_transactions_page_unmetered(Database *db, const char *transaction_type, int page_size,
+                                           int after_id, Arena *arena, TransactionRecord **rows,
+                                           int *next_after_id) {
+    RecordCollector collector;
+    collector_init(&collector, arena, sizeof(TransactionRecord), page_size);
+    int row_count = visit_transactions_page(db, transaction_type, page_size, after_id, collect_transaction,
+                                            &collector, next_after_id);
+    return collector_finish(&collector, row_count, (void **)rows);
+}
+
+static int get_sales_report_unmetered(Database *db, const char *start_date, const char *end_date,
+                                      Arena *arena, SalesReportRow **rows) {
+    RecordCollector collector;
+    collector_init(&collector, arena, sizeof(SalesReportRow), 0);
+    int row_count = visit_sales_report(db, start_date, end_date, collect_sales_report_row, &collector);
+    return collector_finish(&collector, row_count, (void **)rows);
+}
+
+static int get_low_stock_products_unmetered(Database *db, Arena *arena, Product **rows) {
+    RecordCollector collector;
+    collector_init(&collector, arena, sizeof(Product), catalog_low_stock_count(&db->catalog));
+    int row_count = visit_low_stock_products(db, collect_product, &collector);
+    return collector_finish(&collector, row_count, (void **)rows);
+}
+
+// Bulk transaction ingest
+
+#define INGEST_LINE_MAX 512
+
+// Trim leading and trailing whitespace in place
+static char *trim_field(char *field) {
+    while (isspace((unsigned char)*field)) {
+        field++;
+    }
+    char *end = field + strlen(field);
+    while (end > field && isspace((unsigned char)end[-1])) {
+        *--end = '\0';
+    }
+    return field;
+}
+
+// Parse one CSV ingest row in place; returns 0 on success
+static int parse_transaction_row(char *line, int *product_id, char **transaction_type,
+                                 int *quantity, char **transaction_date, int *customer_supplier_id) {
+    char *fields[5];
+    int count = 0;
+    char *cursor = line;
+
+    while (count < 5) {
+        fields[count++] = cursor;
+        char *comma = strchr(cursor, ',');
+        if (!comma) {
+            break;
+        }
+        *comma = '\0';
+        cursor = comma + 1;
+    }
+    if (count != 5 || strchr(cursor, ',')) {
         return -1;
     }
 
-    printf("ID\tName\tStock Quantity\tReorder Level\n");
-    while (sqlite3_step(stmt) == SQLITE_ROW) {
-        int product_id = sqlite3_column_int(stmt, 0);
-        const char *name = (const char *)sqlite3_column_text(stmt, 1);
-        int stock_quantity = sqlite3_column_int(stmt, 2);
-        int reorder_level = sqlite3_column_int(stmt, 3);
+    char *end;
+    *product_id = (int)strtol(trim_field(fields[0]), &end, 10);
+    if (*end != '\0') {
+        return -1;
+    }
+    *transaction_type = trim_field(fields[1]);
+    *quantity = (int)strtol(trim_field(fields[2]), &end, 10);
+    if (*end != '\0' || *quantity <= 0) {
+        return -1;
+    }
+    *transaction_date = trim_field(fields[3]);
+    *customer_supplier_id = (int)strtol(trim_field(fields[4]), &end, 10);
+    if (*end != '\0' || **transaction_type == '\0' || **transaction_date == '\0') {
+        return -1;
+    }
+    return 0;
+}
+
+// Stream transaction rows from input, committing every batch_size rows
+static int ingest_transactions_unmetered(Database *db, FILE *input, int batch_size, BulkIngestStats *stats) {
+    char line[INGEST_LINE_MAX];
+    long line_number = 0;
+    int in_batch = 0;
+    int rows_in_batch = 0;
+    int status = 0;
+
+    memset(stats, 0, sizeof(*stats));
+    double started = metrics_now_seconds();
+
+    while (fgets(line, sizeof(line), input)) {
+        line_number++;
+        size_t length = strlen(line);
+        if (length == sizeof(line) - 1 && line[length - 1] != '\n') {
+            // Overlong line: report it and discard the remainder
+            int c;
+            while ((c = fgetc(input)) != EOF && c != '\n') {
+            }
+            stats->rows_read++;
+            stats->rows_rejected++;
+            fprintf(stderr, "Line %ld: row too long, skipped\n", line_number);
+            continue;
+        }
+
+        char *row = trim_field(line);
+        if (*row == '\0' || *row == '#' ||
+            (stats->rows_read == 0 && strncmp(row, "product_id", 10) == 0)) {
+            continue;
+        }
+        stats->rows_read++;
+
+        int product_id, quantity, customer_supplier_id;
+        char *transaction_type, *transaction_date;
+        if (parse_transaction_row(row, &product_id, &transaction_type, &quantity,
+                                  &transaction_date, &customer_supplier_id) != 0) {
+            stats->rows_rejected++;
+            fprintf(stderr, "Line %ld: malformed row, skipped\n", line_number);
+            continue;
+        }
 
-        printf("%d\t%s\t%d\t%d\n", product_id, name, stock_quantity, reorder_level);
+        if (batch_size < 1) {
+            // Per-row path, kept for throughput comparison
+            if (add_transaction(db, product_id, transaction_type, quantity,
+                                transaction_date, customer_supplier_id) == 0) {
+                stats->rows_inserted++;
+                stats->batches_committed++;
+            } else {
+                stats->rows_rejected++;
+                fprintf(stderr, "Line %ld: row rejected\n", line_number);
+            }
+            continue;
+        }
+
+        if (!in_batch) {
+            if (begin_transaction(db) != 0) {
+                status = -1;
+                break;
+            }
+            in_batch = 1;
+        }
+
+        // Each row runs in its own savepoint, so a rejected row leaves the batch intact
+        if (add_transaction(db, product_id, transaction_type, quantity,
+                            transaction_date, customer_supplier_id) == 0) {
+            stats->rows_inserted++;
+        } else {
+            stats->rows_rejected++;
+            fprintf(stderr, "Line %ld: row rejected\n", line_number);
+        }
+
+        if (++rows_in_batch >= batch_size) {
+            if (commit_transaction(db) != 0) {
+                status = -1;
+                break;
+            }
+            in_batch = 0;
+            rows_in_batch = 0;
+            stats->batches_committed++;
+        }
     }
 
-    sqlite3_finalize(stmt);
+    if (in_batch) {
+        if (status == 0 && commit_transaction(db) == 0) {
+            stats->batches_committed++;
+        } else {
+            rollback_transaction(db);
+            status = -1;
+        }
+    }
+    if (ferror(input)) {
+        fprintf(stderr, "Failed to read transaction input\n");
+        status = -1;
+    }
+
+    stats->elapsed_seconds = metrics_now_seconds() - started;
+    return status;
+}
+
+// Visit products below their reorder level, largest shortfall first
+// Writable handles read the catalog's low-stock heap; read-only handles query.
+static int visit_low_stock_products_unmetered(Database *db, ProductVisitor visitor, void *context) {
+    if (db->config.read_only) {
+        int last_id;
+        return visit_product_cursor(db, db->statements[STMT_LOW_STOCK], -1, visitor, context, &last_id);
+    }
+
+    int count = catalog_low_stock_count(&db->catalog);
+    const Product **products = malloc(sizeof(*products) * (count ? count : 1));
+    if (!products) {
+        fprintf(stderr, "Out of memory listing low-stock products\n");
+        return -1;
+    }
+    catalog_low_stock(&db->catalog, products);
+
+    int row_count = 0;
+    while (row_count < count && visitor(products[row_count++], context) == 0) {
+    }
+    free(products);
+    return row_count;
+}
+
+int write_low_stock_row(const Product *product, void *context) {
+    OutputSink *sink = context;
+    output_int(sink, product->product_id);
+    output_text(sink, product->product_name);
+    output_int(sink, product->stock_quantity);
+    output_int(sink, product->reorder_level);
+    output_end_row(sink);
+    return 0;
+}
+
+// Stream products below their reorder level to a sink
+static int write_low_stock_products_unmetered(Database *db, OutputSink *sink) {
+    output_begin(sink, low_stock_columns, LOW_STOCK_COLUMN_COUNT);
+    return visit_low_stock_products(db, write_low_stock_row, sink);
+}
+
+// List products below their reorder level
+static int list_low_stock_products_unmetered(Database *db) {
+    OutputSink sink;
+    if (open_stdout_table(&sink) != 0) {
+        return -1;
+    }
+
+    int row_count = write_low_stock_products(db, &sink);
+    return output_close(&sink) != 0 || row_count < 0 ? -1 : 0;
+}
+
+// Stock checkpoints
+
+static const OutputColumn stock_level_columns[] = {
+    {"ID", "product_id", 4},
+    {"Name", "product_name", 20},
+    {"Stock", "stock_quantity", 8},
+    {"Cost", "cost_price", 10},
+    {"Value", "stock_value", 14},
+};
+#define STOCK_LEVEL_COLUMN_COUNT ((int)(sizeof(stock_level_columns) / sizeof(stock_level_columns[0])))
+
+static int create_stock_checkpoint_unmetered(Database *db, int min_movements) {
+    sqlite3_stmt *stmt = db->statements[STMT_CREATE_CHECKPOINT];
+
+    sqlite3_bind_int(stmt, 1, min_movements);
+
+    if (sqlite3_step(stmt) != SQLITE_DONE) {
+        fprintf(stderr, "Failed to create stock checkpoint: %s\n", sqlite3_errmsg(db->connection));
+        reset_statement(stmt);
+        return -1;
+    }
+    reset_statement(stmt);
+    return sqlite3_changes(db->connection);
+}
+
+// Convert an as-of date to unix seconds
+static int resolve_as_of_time(Database *db, const char *as_of_date, sqlite3_int64 *as_of) {
+    sqlite3_stmt *stmt = db->statements[STMT_AS_OF_TIME];
+    int status = -1;
+
+    sqlite3_bind_text(stmt, 1, as_of_date, -1, SQLITE_STATIC);
+    if (sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_type(stmt, 0) != SQLITE_NULL) {
+        *as_of = sqlite3_column_int64(stmt, 0);
+        status = 0;
+    } else {
+        fprintf(stderr, "Invalid date: %s\n", as_of_date);
+    }
+    reset_statement(stmt);
+    return status;
+}
+
+// Net stock change of a product from transactions dated in (after, up_to]
+static int sum_stock_movements(Database *db, int product_id, sqlite3_int64 after, sqlite3_int64 up_to,
+                               long long *delta) {
+    sqlite3_stmt *stmt = db->statements[STMT_STOCK_MOVEMENTS];
+    int status = -1;
+
+    sqlite3_bind_int(stmt, 1, product_id);
+    sqlite3_bind_int64(stmt, 2, after);
+    sqlite3_bind_int64(stmt, 3, up_to);
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        *delta = sqlite3_column_int64(stmt, 0);
+        status = 0;
+    } else {
+        fprintf(stderr, "Failed to execute statement: %s\n", sqlite3_errmsg(db->connection));
+    }
+    reset_statement(stmt);
+    return status;
+}
+
+// Find the checkpoint a cursor selects; returns 1 if there is one, 0 if not, -1 on error
+static int find_checkpoint(Database *db, StatementId id, int product_id, sqlite3_int64 as_of,
+                           sqlite3_int64 *checkpoint_time, long long *stock_quantity) {
+    sqlite3_stmt *stmt = db->statements[id];
+    int found;
+
+    sqlite3_bind_int(stmt, 1, product_id);
+    sqlite3_bind_int64(stmt, 2, as_of);
+
+    int rc = sqlite3_step(stmt);
+    if (rc == SQLITE_ROW) {
+        *checkpoint_time = sqlite3_column_int64(stmt, 0);
+        *stock_quantity = sqlite3_column_int64(stmt, 1);
+        found = 1;
+    } else if (rc == SQLITE_DONE) {
+        found = 0;
+    } else {
+        fprintf(stderr, "Failed to execute statement: %s\n", sqlite3_errmsg(db->connection));
+        found = -1;
+    }
+    reset_statement(stmt);
+    return found;
+}
+
+// Stock of one product at as_of. Replays forward from the latest checkpoint
+// at or before it; only before the first checkpoint does it replay backward,
+// from that checkpoint or, with none at all, from current_stock. Backward
+// replay never crosses a manual count, which always has a checkpoint.
+static int stock_as_of(Database *db, int product_id, int current_stock, sqlite3_int64 as_of, int *stock) {
+    sqlite3_int64 checkpoint_time;
+    long long checkpoint_stock;
+    long long delta;
+
+    int found = find_checkpoint(db, STMT_CHECKPOINT_BEFORE, product_id, as_of, &checkpoint_time,
+                                &checkpoint_stock);
+    if (found == 1) {
+        if (sum_stock_movements(db, product_id, checkpoint_time, as_of, &delta) != 0) {
+            return -1;
+        }
+        *stock = (int)(checkpoint_stock + delta);
+        return 0;
+    }
+    if (found == 0) {
+        found = find_checkpoint(db, STMT_CHECKPOINT_AFTER, product_id, as_of, &checkpoint_time,
+                                &checkpoint_stock);
+    }
+    if (found == 0) {
+        checkpoint_time = INT64_MAX;
+        checkpoint_stock = current_stock;
+    } else if (found < 0) {
+        return -1;
+    }
+    if (sum_stock_movements(db, product_id, as_of, checkpoint_time, &delta) != 0) {
+        return -1;
+    }
+    *stock = (int)(checkpoint_stock - delta);
+    return 0;
+}
+
+static int get_stock_as_of_unmetered(Database *db, int product_id, const char *as_of_date, int *stock_quantity) {
+    Product product;
+    sqlite3_int64 as_of;
+
+    if (resolve_as_of_time(db, as_of_date, &as_of) != 0) {
+        return -1;
+    }
+    if (get_product_by_id(db, product_id, &product) != 0) {
+        fprintf(stderr, "Product %d not found\n", product_id);
+        return -1;
+    }
+    return stock_as_of(db, product_id, product.stock_quantity, as_of, stock_quantity);
+}
+
+typedef struct {
+    Database *db;
+    sqlite3_int64 as_of;
+    StockLevelVisitor visitor;
+    void *context;
+    int failed;
+} StockLevelScan;
+
+static int visit_stock_level(const Product *product, void *context) {
+    StockLevelScan *scan = context;
+    StockLevel level = {
+        .product_id = product->product_id,
+        .product_name = product->product_name,
+        .cost_price = product->cost_price,
+    };
+
+    if (stock_as_of(scan->db, product->product_id, product->stock_quantity, scan->as_of,
+                    &level.stock_quantity) != 0) {
+        scan->failed = 1;
+        return 1;
+    }
+    return scan->visitor(&level, scan->context);
+}
+
+// Visit every product's stock as of a date
+static int visit_stock_as_of_unmetered(Database *db, const char *as_of_date, StockLevelVisitor visitor,
+                                       void *context) {
+    StockLevelScan scan = {db, 0, visitor, context, 0};
+    int last_id;
+
+    if (resolve_as_of_time(db, as_of_date, &scan.as_of) != 0) {
+        return -1;
+    }
+    int row_count = visit_product_cursor(db, db->statements[STMT_LIST_PRODUCTS], -1, visit_stock_level, &scan,
+                                         &last_id);
+    return scan.failed ? -1 : row_count;
+}
+
+static int write_stock_level_row(const StockLevel *level, void *context) {
+    OutputSink *sink = context;
+    output_int(sink, level->product_id);
+    output_text(sink, level->product_name);
+    output_int(sink, level->stock_quantity);
+    output_decimal(sink, level->cost_price, 2);
+    output_decimal(sink, level->stock_quantity * level->cost_price, 2);
+    output_end_row(sink);
     return 0;
 }
+
+// Stream every product's stock and its value at cost as of a date
+static int write_stock_as_of_unmetered(Database *db, const char *as_of_date, OutputSink *sink) {
+    output_begin(sink, stock_level_columns, STOCK_LEVEL_COLUMN_COUNT);
+    return visit_stock_as_of(db, as_of_date, write_stock_level_row, sink);
+}
+
+// Incremental transaction export
+
+static const OutputColumn export_columns[] = {
+    {"Product ID", "product_id", 10},
+    {"Type", "transaction_type", 4},
+    {"Quantity", "quantity", 8},
+    {"Date", "transaction_date", 19},
+    {"Customer/Supplier ID", "customer_supplier_id", 20},
+};
+#define EXPORT_COLUMN_COUNT ((int)(sizeof(export_columns) / sizeof(export_columns[0])))
+
+// Stream the transactions appended after the export's last position
+static int write_new_transactions_unmetered(Database *db, const char *export_name, OutputSink *sink,
+                                            sqlite3_int64 *last_transaction_id) {
+    sqlite3_stmt *stmt = db->statements[STMT_EXPORT_RANGE];
+    sqlite3_int64 after_id = 0;
+    int rc;
+
+    // Fix the upper bound first, so rows appended meanwhile wait for the next export
+    sqlite3_bind_text(stmt, 1, export_name, -1, SQLITE_STATIC);
+    if ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        after_id = sqlite3_column_int64(stmt, 0);
+        *last_transaction_id = sqlite3_column_int64(stmt, 1);
+        rc = SQLITE_DONE;
+    }
+    if (finish_query(db, stmt, rc, 0) != 0) {
+        return -1;
+    }
+    if (*last_transaction_id < after_id) {
+        *last_transaction_id = after_id;
+    }
+
+    stmt = db->statements[STMT_EXPORT_TRANSACTIONS];
+    int row_count = 0;
+    sqlite3_bind_int64(stmt, 1, after_id);
+    sqlite3_bind_int64(stmt, 2, *last_transaction_id);
+    output_begin(sink, export_columns, EXPORT_COLUMN_COUNT);
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        output_int(sink, sqlite3_column_int(stmt, 0));
+        output_text(sink, (const char *)sqlite3_column_text(stmt, 1));
+        output_int(sink, sqlite3_column_int(stmt, 2));
+        output_text(sink, (const char *)sqlite3_column_text(stmt, 3));
+        output_int(sink, sqlite3_column_int(stmt, 4));
+        output_end_row(sink);
+        row_count++;
+    }
+    return finish_query(db, stmt, rc, row_count);
+}
+
+// Move the export's position to last_transaction_id
+static int mark_transactions_exported_unmetered(Database *db, const char *export_name,
+                                                sqlite3_int64 last_transaction_id) {
+    sqlite3_stmt *stmt = db->statements[STMT_MARK_EXPORTED];
+
+    sqlite3_bind_text(stmt, 1, export_name, -1, SQLITE_STATIC);
+    sqlite3_bind_int64(stmt, 2, last_transaction_id);
+    int status = sqlite3_step(stmt) == SQLITE_DONE ? 0 : -1;
+    if (status != 0) {
+        fprintf(stderr, "Failed to record export position: %s\n", sqlite3_errmsg(db->connection));
+    }
+    reset_statement(stmt);
+    return status;
+}
+
+// Product search
+
+// Index column each field searches; NULL searches every column
+static const char *search_field_columns[] = {
+    [SEARCH_ALL] = NULL,
+    [SEARCH_NAME] = "product_name",
+    [SEARCH_CATEGORY] = "category",
+    [SEARCH_DESCRIPTION] = "description",
+};
+
+int parse_search_field(const char *name, SearchField *field) {
+    if (strcmp(name, "all") == 0) {
+        *field = SEARCH_ALL;
+    } else if (strcmp(name, "name") == 0) {
+        *field = SEARCH_NAME;
+    } else if (strcmp(name, "category") == 0) {
+        *field = SEARCH_CATEGORY;
+    } else if (strcmp(name, "description") == 0) {
+        *field = SEARCH_DESCRIPTION;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+// Word characters as the unicode61 tokenizer sees them (bytes of multi-byte
+// UTF-8 sequences are kept together with the word)
+static int is_search_word_char(unsigned char c) {
+    return isalnum(c) || c >= 0x80;
+}
+
+// Turn free text into an FTS5 query: each word becomes a quoted prefix term,
+// optionally restricted to one column, and all of them must match. Quoting
+// keeps FTS5 operators and punctuation in the input from reaching the parser.
+// Returns the term count (0: nothing to search for) or -1 if out of memory.
+static int build_search_query(const char *text, SearchField field, char **match) {
+    const char *column = search_field_columns[field];
+    size_t capacity = strlen(text) * (column ? strlen(column) + 8 : 5) + 1;
+    char *query = malloc(capacity);
+    size_t length = 0;
+    int terms = 0;
+
+    if (!query) {
+        return -1;
+    }
+    for (const char *p = text; *p;) {
+        if (!is_search_word_char((unsigned char)*p)) {
+            p++;
+            continue;
+        }
+        const char *word = p;
+        while (*p && is_search_word_char((unsigned char)*p)) {
+            p++;
+        }
+        length += sprintf(query + length, "%s%s%s\"%.*s\"*", terms ? " " : "", column ? column : "",
+                          column ? " : " : "", (int)(p - word), word);
+        terms++;
+    }
+    query[length] = '\0';
+    *match = query;
+    return terms;
+}
+
+// Visit the best matches for a query, best first
+static int visit_product_search_unmetered(Database *db, const char *query, SearchField field, int limit,
+                                          ProductVisitor visitor, void *context) {
+    sqlite3_stmt *stmt = db->statements[STMT_SEARCH_PRODUCTS];
+    char *match;
+    int last_id;
+
+    if ((unsigned)field >= sizeof(search_field_columns) / sizeof(search_field_columns[0])) {
+        fprintf(stderr, "Unknown search field %d\n", (int)field);
+        return -1;
+    }
+    int terms = build_search_query(query, field, &match);
+    if (terms < 0) {
+        fprintf(stderr, "Out of memory building search query\n");
+        return -1;
+    }
+    if (terms == 0) {
+        free(match);
+        return 0;
+    }
+
+    sqlite3_bind_text(stmt, 1, match, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int(stmt, 2, limit > 0 ? limit : -1);
+    free(match);
+    return visit_product_cursor(db, stmt, -1, visitor, context, &last_id);
+}
+
+// Stream search results to a sink in the products layout
+static int write_product_search_unmetered(Database *db, const char *query, SearchField field, int limit,
+                                          OutputSink *sink) {
+    output_begin(sink, product_columns, PRODUCT_COLUMN_COUNT);
+    return visit_product_search(db, query, field, limit, write_product_row, sink);
+}
+
+// Print search results
+static int search_products_unmetered(Database *db, const char *query, SearchField field, int limit) {
+    OutputSink sink;
+    if (open_stdout_table(&sink) != 0) {
+        return -1;
+    }
+
+    int row_count = write_product_search(db, query, field, limit, &sink);
+    if (output_close(&sink) != 0 || row_count < 0) {
+        return -1;
+    }
+
+    if (row_count == 0) {
+        printf("No products match \"%s\".\n", query);
+    }
+    return 0;
+}
+
+// SQLite statistics
+
+static const OutputColumn statement_stats_columns[] = {
+    {"Statement", "statement", 20},
+    {"Runs", "runs", 10},
+    {"VM Steps", "vm_steps", 12},
+    {"Full Scan Steps", "fullscan_steps", 16},
+    {"Sorts", "sorts", 8},
+    {"Auto Indexes", "autoindexes", 13},
+    {"Reprepares", "reprepares", 11},
+    {"Memory", "memory_bytes", 10},
+};
+#define STATEMENT_STATS_COLUMN_COUNT ((int)(sizeof(statement_stats_columns) / sizeof(statement_stats_columns[0])))
+
+static const OutputColumn connection_stats_columns[] = {
+    {"Counter", "counter", 20},
+    {"Value", "value", 12},
+};
+#define CONNECTION_STATS_COLUMN_COUNT ((int)(sizeof(connection_stats_columns) / sizeof(connection_stats_columns[0])))
+
+static int write_statement_stats(Database *db, OutputSink *sink) {
+    int row_count = 0;
+
+    output_begin(sink, statement_stats_columns, STATEMENT_STATS_COLUMN_COUNT);
+    for (int i = 0; i < STMT_COUNT; i++) {
+        sqlite3_stmt *stmt = db->statements[i];
+        if (!stmt || sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_RUN, 0) == 0) {
+            continue;
+        }
+        row_count++;
+        output_text(sink, statement_names[i]);
+        output_int(sink, sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_RUN, 0));
+        output_int(sink, sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_VM_STEP, 0));
+        output_int(sink, sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_FULLSCAN_STEP, 0));
+        output_int(sink, sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_SORT, 0));
+        output_int(sink, sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_AUTOINDEX, 0));
+        output_int(sink, sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_REPREPARE, 0));
+        output_int(sink, sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_MEMUSED, 0));
+        output_end_row(sink);
+    }
+    return row_count;
+}
+
+static int write_connection_stats(Database *db, OutputSink *sink) {
+    static const struct {
+        const char *name;
+        int op;
+    } counters[] = {
+        {"cache_hit", SQLITE_DBSTATUS_CACHE_HIT},
+        {"cache_miss", SQLITE_DBSTATUS_CACHE_MISS},
+        {"cache_write", SQLITE_DBSTATUS_CACHE_WRITE},
+        {"cache_spill", SQLITE_DBSTATUS_CACHE_SPILL},
+        {"cache_used_bytes", SQLITE_DBSTATUS_CACHE_USED},
+        {"schema_used_bytes", SQLITE_DBSTATUS_SCHEMA_USED},
+        {"stmt_used_bytes", SQLITE_DBSTATUS_STMT_USED},
+        {"lookaside_used", SQLITE_DBSTATUS_LOOKASIDE_USED},
+    };
+    int row_count = 0;
+
+    output_begin(sink, connection_stats_columns, CONNECTION_STATS_COLUMN_COUNT);
+    for (size_t i = 0; i < sizeof(counters) / sizeof(counters[0]); i++) {
+        int current = 0, highwater = 0;
+        if (sqlite3_db_status(db->connection, counters[i].op, &current, &highwater, 0) != SQLITE_OK) {
+            continue;
+        }
+        row_count++;
+        output_text(sink, counters[i].name);
+        output_int(sink, current);
+        output_end_row(sink);
+    }
+    return row_count;
+}
+
+// Operation metrics, then this connection's statistics; titles are only
+// written in table format so CSV and JSONL stay machine-readable
+int write_metrics(Database *db, OutputSink *sink) {
+    int table = sink->format == OUTPUT_TABLE;
+
+    if (table) {
+        output_line(sink, "Operations");
+    }
+    int row_count = metrics_write(sink);
+    if (!db) {
+        return row_count;
+    }
+    if (table) {
+        output_line(sink, "");
+        output_line(sink, "Statements");
+    }
+    row_count += write_statement_stats(db, sink);
+    if (table) {
+        output_line(sink, "");
+        output_line(sink, "Connection");
+    }
+    return row_count + write_connection_stats(db, sink);
+}
+
+// Metered public API
+// Each public function runs its _unmetered implementation inside a
+// MetricScope that records latency, failure and rows touched.
+
+typedef struct {
+    uint64_t started_ns;
+    sqlite3_int64 changes;
+} MetricScope;
+
+static void metric_begin(MetricScope *scope, sqlite3 *connection) {
+    scope->changes = connection ? sqlite3_total_changes64(connection) : 0;
+    scope->started_ns = metrics_now_ns();
+}
+
+// rows_returned is added to the rows the call changed on the connection
+static int metric_end(const MetricScope *scope, MetricId id, sqlite3 *connection, int result,
+                      long long rows_returned) {
+    uint64_t elapsed_ns = metrics_now_ns() - scope->started_ns;
+    sqlite3_int64 changed = connection ? sqlite3_total_changes64(connection) - scope->changes : 0;
+    metrics_record(id, elapsed_ns, result < 0, (uint64_t)(rows_returned + changed));
+    return result;
+}
+
+int initialize_database(Database *db, const char *db_name, const DatabaseConfig *config) {
+    MetricScope scope;
+    metric_begin(&scope, NULL);
+    int result = initialize_database_unmetered(db, db_name, config);
+    return metric_end(&scope, METRIC_INITIALIZE_DATABASE, NULL, result, 0);
+}
+
+int connect_to_database(Database *db) {
+    MetricScope scope;
+    metric_begin(&scope, db->connection);
+    int result = connect_to_database_unmetered(db);
+    return metric_end(&scope, METRIC_CONNECT_TO_DATABASE, db->connection, result, 0);
+}
+
+void close_database(Database *db) {
+    MetricScope scope;
+    metric_begin(&scope, NULL);
+    close_database_unmetered(db);
+    metric_end(&scope, METRIC_CLOSE_DATABASE, NULL, 0, 0);
+}
+
+int begin_transaction(Database *db) {
+    MetricScope scope;
+    metric_begin(&scope, db->connection);
+    int result = begin_transaction_unmetered(db);
+    return metric_end(&scope, METRIC_BEGIN_TRANSACTION, db->connection, result, 0);
+}
+
+int commit_transaction(Database *db) {
+    MetricScope scope;
+    metric_begin(&scope, db->connection);
+    int result = commit_transaction_unmetered(db);
+    return metric_end(&scope, METRIC_COMMIT_TRANSACTION, db->connection, result, 0);
+}
+
+int rollback_transaction(Database *db) {
+    MetricScope scope;
+    metric_begin(&scope, db->connection);
+    int result = rollback_transaction_unmetered(db);
+    return metric_end(&scope, METRIC_ROLLBACK_TRANSACTION, db->connection, result, 0);
+}
+
+int refresh_catalog(Database *db) {
+    MetricScope scope;
+    metric_begin(&scope, db->connection);
+    int result = refresh_catalog_unmetered(db);
+    return metric_end(&scope, METRIC_REFRESH_CATALOG, db->connection, result, 0);
+}
+
+int add_product(Database *db, const char *name, const char *description, const char *category,
+                double cost_price, double selling_price, int stock_quantity, int reorder_level) {
+    MetricScope scope;
+    metric_begin(&scope, db->connection);
+    int result = add_product_unmetered(db, 0, name, description, category, cost_price, selling_price,
+                                       stock_quantity, reorder_level);
+    return metric_end(&scope, METRIC_ADD_PRODUCT, db->connection, result, 0);
+}
+
+int add_product_with_id(Database *db, int product_id, const char *name, const char *description,
+                        const char *category, double cost_price, double selling_price, int stock_quantity,
+                        int reorder_level) {
+    MetricScope scope;
+    metric_begin(&scope, db->connection);
+    int result = add_product_unmetered(db, product_id, name, description, category, cost_price,
+                                       selling_price, stock_quantity, reorder_level);
+    return metric_end(&scope, METRIC_ADD_PRODUCT_WITH_ID, db->connection, result, 0);
+}
+
+int delete_product(Database *db, int product_id) {
+    MetricScope scope;
+    metric_begin(&scope, db->connection);
+    int result = delete_product_unmetered(db, product_id);
+    return metric_end(&scope, METRIC_DELETE_PRODUCT, db->connection, result, 0);
+}
+
+int update_stock_quantity(Database *db, int product_id, int new_quantity) {
+    MetricScope scope;
+    metric_begin(&scope, db->connection);
+    int result = update_stock_quantity_unmetered(db, product_id, new_quantity);
+    return metric_end(&scope, METRIC_UPDATE_STOCK_QUANTITY, db->connection, result, 0);
+}
+
+int get_product_by_id(Database *db, int product_id, Product *product) {
+    MetricScope scope;
+    metric_begin(&scope, db->connection);
+    int result = get_product_by_id_unmetered(db, product_id, product);
+    return metric_end(&scope, METRIC_GET_PRODUCT_BY_ID, db->connection, result, result == 0);
+}
+
+int list_all_products(Database *db) {
+    MetricScope scope;
+    metric_begin(&scope, db->connection);
+    int result = list_all_products_unmetered(db);
+    return metric_end(&scope, METRIC_LIST_ALL_PRODUCTS, db->connection, result, 0);
+}
+
+int add_supplier(Database *db, const char *name, const char *contact_info, const char *address) {
+    MetricScope scope;
+    metric_begin(&scope, db->connection);
+    int result = add_supplier_unmetered(db, name, contact_info, address);
+    return metric_end(&scope, METRIC_ADD_SUPPLIER, db->connection, result, 0);
+}
+
+int get_supplier_by_id(Database *db, int supplier_id, Supplier *supplier) {
+    MetricScope scope;
+    metric_begin(&scope, db->connection);
+    int result = get_supplier_by_id_unmetered(db, supplier_id, supplier);
+    return metric_end(&scope, METRIC_GET_SUPPLIER_BY_ID, db->connection, result, result == 0);
+}
+
+int list_all_suppliers(Database *db) {
+    MetricScope scope;
+    metric_begin(&scope, db->connection);
+    int result = list_all_suppliers_unmetered(db);
+    return metric_end(&scope, METRIC_LIST_ALL_SUPPLIERS, db->connection, result, 0);
+}
+
+int list_low_stock_products(Database *db) {
+    MetricScope scope;
+    metric_begin(&scope, db->connection);
+    int result = list_low_stock_products_unmetered(db);
+    return metric_end(&scope, METRIC_LIST_LOW_STOCK_PRODUCTS, db->connection, result, 0);
+}
+
+int add_transaction(Database *db, int product_id, const char *transaction_type, int quantity,
+                    const char *transaction_date, int customer_supplier_id) {
+    MetricScope scope;
+    metric_begin(&scope, db->connection);
+    int result = add_transaction_unmetered(db, product_id, transaction_type, quantity, transaction_date,
+                                           customer_supplier_id);
+    return metric_end(&scope, METRIC_ADD_TRANSACTION, db->connection, result, 0);
+}
+
+int list_transactions(Database *db, const char *transaction_type) {
+    MetricScope scope;
+    metric_begin(&scope, db->connection);
+    int result = list_transactions_unmetered(db, transaction_type);
+    return metric_end(&scope, METRIC_LIST_TRANSACTIONS, db->connection, result, 0);
+}
+
+int ingest_transactions(Database *db, FILE *input, int batch_size, BulkIngestStats *stats) {
+    MetricScope scope;
+    metric_begin(&scope, db->connection);
+    int result = ingest_transactions_unmetered(db, input, batch_size, stats);
+    return metric_end(&scope, METRIC_INGEST_TRANSACTIONS, db->connection, result, 0);
+}
+
+int generate_sales_report(Database *db, const char *start_date, const char *end_date) {
+    MetricScope scope;
+    metric_begin(&scope, db->connection);
+    int result = generate_sales_report_unmetered(db, start_date, end_date);
+    return metric_end(&scope, METRIC_GENERATE_SALES_REPORT, db->connection, result, 0);
+}
+
+int visit_products(Database *db, ProductVisitor visitor, void *context) {
+    MetricScope scope;
+    metric_begin(&scope, db->connection);
+    int result = visit_products_unmetered(db, visitor, context);
+    return metric_end(&scope, METRIC_VISIT_PRODUCTS, db->connection, result, result > 0 ? result : 0);
+}
+
+int visit_suppliers(Database *db, SupplierVisitor visitor, void *context) {
+    MetricScope scope;
+    metric_begin(&scope, db->connection);
+    int result = visit_suppliers_unmetered(db, visitor, context);
+    return metric_end(&scope, METRIC_VISIT_SUPPLIERS, db->connection, result, result > 0 ? result : 0);
+}
+
+int visit_transactions(Database *db, const char *transaction_type, TransactionVisitor visitor,
+                       void *context) {
+    MetricScope scope;
+    metric_begin(&scope, db->connection);
+    int result = visit_transactions_unmetered(db, transaction_type, visitor, context);
+    return metric_end(&scope, METRIC_VISIT_TRANSACTIONS, db->connection, result, result > 0 ? result : 0);
+}
+
+int visit_sales_report(Database *db, const char *start_date, const char *end_date, SalesReportVisitor visitor,
+                       void *context) {
+    MetricScope scope;
+    metric_begin(&scope, db->connection);
+    int result = visit_sales_report_unmetered(db, start_date, end_date, visitor, context);
+    return metric_end(&scope, METRIC_VISIT_SALES_REPORT, db->connection, result, result > 0 ? result : 0);
+}
+
+int visit_low_stock_products(Database *db, ProductVisitor visitor, void *context) {
+    MetricScope scope;
+    metric_begin(&scope, db->connection);
+    int result = visit_low_stock_products_unmetered(db, visitor, context);
+    return metric_end(&scope, METRIC_VISIT_LOW_STOCK_PRODUCTS, db->connection, result,
+                      result > 0 ? result : 0);
+}
+
+int write_products(Database *db, OutputSink *sink) {
+    MetricScope scope;
+    metric_begin(&scope, db->connection);
+    int result = write_products_unmetered(db, sink);
+    return metric_end(&scope, METRIC_WRITE_PRODUCTS, db->connection, result, result > 0 ? result : 0);
+}
+
+int write_suppliers(Database *db, OutputSink *sink) {
+    MetricScope scope;
+    metric_begin(&scope, db->connection);
+    int result = write_suppliers_unmetered(db, sink);
+    return metric_end(&scope, METRIC_WRITE_SUPPLIERS, db->connection, result, result > 0 ? result : 0);
+}
+
+int write_transactions(Database *db, const char *transaction_type, OutputSink *sink) {
+    MetricScope scope;
+    metric_begin(&scope, db->connection);
+    int result = write_transactions_unmetered(db, transaction_type, sink);
+    return metric_end(&scope, METRIC_WRITE_TRANSACTIONS, db->connection, result, result > 0 ? result : 0);
+}
+
+int write_sales_report(Database *db, const char *start_date, const char *end_date, OutputSink *sink) {
+    MetricScope scope;
+    metric_begin(&scope, db->connection);
+    int result = write_sales_report_unmetered(db, start_date, end_date, sink);
+    return metric_end(&scope, METRIC_WRITE_SALES_REPORT, db->connection, result, result > 0 ? result : 0);
+}
+
+int write_low_stock_products(Database *db, OutputSink *sink) {
+    MetricScope scope;
+    metric_begin(&scope, db->connection);
+    int result = write_low_stock_products_unmetered(db, sink);
+    return metric_end(&scope, METRIC_WRITE_LOW_STOCK_PRODUCTS, db->connection, result,
+                      result > 0 ? result : 0);
+}
+
+int list_products_page(Database *db, int page_size, int after_id, int *next_after_id) {
+    MetricScope scope;
+    metric_begin(&scope, db->connection);
+    int result = list_products_page_unmetered(db, page_size, after_id, next_after_id);
+    return metric_end(&scope, METRIC_LIST_PRODUCTS_PAGE, db->connection, result, 0);
+}
+
+int list_transactions_page(Database *db, const char *transaction_type, int page_size, int after_id,
+                           int *next_after_id) {
+    MetricScope scope;
+    metric_begin(&scope, db->connection);
+    int result = list_transactions_page_unmetered(db, transaction_type, page_size, after_id, next_after_id);
+    return metric_end(&scope, METRIC_LIST_TRANSACTIONS_PAGE, db->connection, result, 0);
+}
+
+int write_products_page(Database *db, int page_size, int after_id, OutputSink *sink, int *next_after_id) {
+    MetricScope scope;
+    metric_begin(&scope, db->connection);
+    int result = write_products_page_unmetered(db, page_size, after_id, sink, next_after_id);
+    return metric_end(&scope, METRIC_WRITE_PRODUCTS_PAGE, db->connection, result, result > 0 ? result : 0);
+}
+
+int write_transactions_page(Database *db, const char *transaction_type, int page_size, int after_id,
+                            OutputSink *sink, int *next_after_id) {
+    MetricScope scope;
+    metric_begin(&scope, db->connection);
+    int result = write_transactions_page_unmetered(db, transaction_type, page_size, after_id, sink,
+                                                   next_after_id);
+    return metric_end(&scope, METRIC_WRITE_TRANSACTIONS_PAGE, db->connection, result,
+                      result > 0 ? result : 0);
+}
+
+int visit_products_page(Database *db, int page_size, int after_id, ProductVisitor visitor, void *context,
+                        int *next_after_id) {
+    MetricScope scope;
+    metric_begin(&scope, db->connection);
+    int result = visit_products_page_unmetered(db, page_size, after_id, visitor, context, next_after_id);
+    return metric_end(&scope, METRIC_VISIT_PRODUCTS_PAGE, db->connection, result, result > 0 ? result : 0);
+}
+
+int visit_transactions_page(Database *db, const char *transaction_type, int page_size, int after_id,
+                            TransactionVisitor visitor, void *context, int *next_after_id) {
+    MetricScope scope;
+    metric_begin(&scope, db->connection);
+    int result = visit_transactions_page_unmetered(db, transaction_type, page_size, after_id, visitor,
+                                                   context, next_after_id);
+    return metric_end(&scope, METRIC_VISIT_TRANSACTIONS_PAGE, db->connection, result,
+                      result > 0 ? result : 0);
+}
+
+int get_product_record(Database *db, int product_id, Arena *arena, Product **product) {
+    MetricScope scope;
+    metric_begin(&scope, db->connection);
+    int result = get_product_record_unmetered(db, product_id, arena, product);
+    return metric_end(&scope, METRIC_GET_PRODUCT_RECORD, db->connection, result, result == 0);
+}
+
+int get_supplier_record(Database *db, int supplier_id, Arena *arena, Supplier **supplier) {
+    MetricScope scope;
+    metric_begin(&scope, db->connection);
+    int result = get_supplier_record_unmetered(db, supplier_id, arena, supplier);
+    return metric_end(&scope, METRIC_GET_SUPPLIER_RECORD, db->connection, result, result == 0);
+}
+
+int get_products_page(Database *db, int page_size, int after_id, Arena *arena, Product **rows,
+                      int *next_after_id) {
+    MetricScope scope;
+    metric_begin(&scope, db->connection);
+    int result = get_products_page_unmetered(db, page_size, after_id, arena, rows, next_after_id);
+    return metric_end(&scope, METRIC_GET_PRODUCTS_PAGE, db->connection, result, result > 0 ? result : 0);
+}
+
+int get_transactions_page(Database *db, const char *transaction_type, int page_size, int after_id,
+                          Arena *arena, TransactionRecord **rows, int *next_after_id) {
+    MetricScope scope;
+    metric_begin(&scope, db->connection);
+    int result = get_transactions_page_unmetered(db, transaction_type, page_size, after_id, arena, rows,
+                                                 next_after_id);
+    return metric_end(&scope, METRIC_GET_TRANSACTIONS_PAGE, db->connection, result, result > 0 ? result : 0);
+}
+
+int get_sales_report(Database *db, const char *start_date, const char *end_date, Arena *arena,
+                     SalesReportRow **rows) {
+    MetricScope scope;
+    metric_begin(&scope, db->connection);
+    int result = get_sales_report_unmetered(db, start_date, end_date, arena, rows);
+    return metric_end(&scope, METRIC_GET_SALES_REPORT, db->connection, result, result > 0 ? result : 0);
+}
+
+int get_low_stock_products(Database *db, Arena *arena, Product **rows) {
+    MetricScope scope;
+    metric_begin(&scope, db->connection);
+    int result = get_low_stock_products_unmetered(db, arena, rows);
+    return metric_end(&scope, METRIC_GET_LOW_STOCK_PRODUCTS, db->connection, result, result > 0 ? result : 0);
+}
+
+int search_products(Database *db, const char *query, SearchField field, int limit) {
+    MetricScope scope;
+    metric_begin(&scope, db->connection);
+    int result = search_products_unmetered(db, query, field, limit);
+    return metric_end(&scope, METRIC_SEARCH_PRODUCTS, db->connection, result, 0);
+}
+
+int visit_product_search(Database *db, const char *query, SearchField field, int limit, ProductVisitor visitor,
+                         void *context) {
+    MetricScope scope;
+    metric_begin(&scope, db->connection);
+    int result = visit_product_search_unmetered(db, query, field, limit, visitor, context);
+    return metric_end(&scope, METRIC_VISIT_PRODUCT_SEARCH, db->connection, result, result > 0 ? result : 0);
+}
+
+int write_product_search(Database *db, const char *query, SearchField field, int limit, OutputSink *sink) {
+    MetricScope scope;
+    metric_begin(&scope, db->connection);
+    int result = write_product_search_unmetered(db, query, field, limit, sink);
+    return metric_end(&scope, METRIC_WRITE_PRODUCT_SEARCH, db->connection, result, result > 0 ? result : 0);
+}
+
+int create_stock_checkpoint(Database *db, int min_movements) {
+    MetricScope scope;
+    metric_begin(&scope, db->connection);
+    int result = create_stock_checkpoint_unmetered(db, min_movements);
+    return metric_end(&scope, METRIC_CREATE_STOCK_CHECKPOINT, db->connection, result, 0);
+}
+
+int get_stock_as_of(Database *db, int product_id, const char *as_of_date, int *stock_quantity) {
+    MetricScope scope;
+    metric_begin(&scope, db->connection);
+    int result = get_stock_as_of_unmetered(db, product_id, as_of_date, stock_quantity);
+    return metric_end(&scope, METRIC_GET_STOCK_AS_OF, db->connection, result, result == 0);
+}
+
+int visit_stock_as_of(Database *db, const char *as_of_date, StockLevelVisitor visitor, void *context) {
+    MetricScope scope;
+    metric_begin(&scope, db->connection);
+    int result = visit_stock_as_of_unmetered(db, as_of_date, visitor, context);
+    return metric_end(&scope, METRIC_VISIT_STOCK_AS_OF, db->connection, result, result > 0 ? result : 0);
+}
+
+int write_stock_as_of(Database *db, const char *as_of_date, OutputSink *sink) {
+    MetricScope scope;
+    metric_begin(&scope, db->connection);
+    int result = write_stock_as_of_unmetered(db, as_of_date, sink);
+    return metric_end(&scope, METRIC_WRITE_STOCK_AS_OF, db->connection, result, result > 0 ? result : 0);
+}
+
+int write_new_transactions(Database *db, const char *export_name, OutputSink *sink,
+                           sqlite3_int64 *last_transaction_id) {
+    MetricScope scope;
+    metric_begin(&scope, db->connection);
+    int result = write_new_transactions_unmetered(db, export_name, sink, last_transaction_id);
+    return metric_end(&scope, METRIC_WRITE_NEW_TRANSACTIONS, db->connection, result, result > 0 ? result : 0);
+}
+
+int mark_transactions_exported(Database *db, const char *export_name, sqlite3_int64 last_transaction_id) {
+    MetricScope scope;
+    metric_begin(&scope, db->connection);
+    int result = mark_transactions_exported_unmetered(db, export_name, last_transaction_id);
+    return metric_end(&scope, METRIC_MARK_TRANSACTIONS_EXPORTED, db->connection, result, 0);
+}
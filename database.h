@@ -1,16 +1,127 @@
 #ifndef DATABASE_H
 #define DATABASE_H
 
+#include <stdio.h>
 #include <sqlite3.h>
+#include "catalog.h"
+#include "output.h"
+#include "arena.h"
+
+// Cached prepared statements, prepared once in initialize_database
+typedef enum {
+    STMT_ADD_PRODUCT,
+    STMT_DELETE_PRODUCT,
+    STMT_LIST_PRODUCTS,
+    STMT_SALES_REPORT,
+    STMT_ADD_SUPPLIER,
+    STMT_LIST_SUPPLIERS,
+    STMT_ADD_TRANSACTION,
+    STMT_LIST_TRANSACTIONS,
+    STMT_LOW_STOCK,
+    STMT_UPDATE_STOCK,
+    STMT_ADJUST_STOCK,
+    STMT_SAVEPOINT,
+    STMT_RELEASE_SAVEPOINT,
+    STMT_ROLLBACK_SAVEPOINT,
+    STMT_PRODUCTS_PAGE,
+    STMT_TRANSACTIONS_PAGE,
+    STMT_ADD_DAILY_SALES,
+    STMT_GET_PRODUCT,
+    STMT_BEGIN,
+    STMT_COMMIT,
+    STMT_ROLLBACK,
+    STMT_GET_SUPPLIER,
+    STMT_SEARCH_PRODUCTS,
+    STMT_SET_CHECKPOINT,
+    STMT_CREATE_CHECKPOINT,
+    STMT_CHECKPOINT_MOVED,
+    STMT_SHIFT_CHECKPOINTS,
+    STMT_CHECKPOINT_BEFORE,
+    STMT_CHECKPOINT_AFTER,
+    STMT_STOCK_MOVEMENTS,
+    STMT_AS_OF_TIME,
+    STMT_EXPORT_RANGE,
+    STMT_EXPORT_TRANSACTIONS,
+    STMT_MARK_EXPORTED,
+    STMT_COUNT
+} StatementId;
+
+// Connection tuning applied by connect_to_database
+// String fields are PRAGMA values; NULL (or 0 for numbers) keeps SQLite's default.
+typedef struct {
+    const char *journal_mode;   // "WAL", "DELETE", "TRUNCATE", ...
+    const char *synchronous;    // "OFF", "NORMAL", "FULL"
+    int cache_size_kb;          // page cache size per connection, in KiB
+    long long mmap_size;        // bytes of the file to memory-map
+    const char *temp_store;     // "DEFAULT", "FILE", "MEMORY"
+    int busy_timeout_ms;        // how long to wait on a locked database
+    int read_only;              // open read-only; the schema must already be current
+
+    // Inventory rules
+    int reject_negative_stock;  // refuse OUT transactions that would drive stock below zero
+    int checkpoint_interval;    // transactions added between automatic stock checkpoints (0: none)
+} DatabaseConfig;
+
+// Predefined connection profiles
+typedef enum {
+    PROFILE_BALANCED,   // interactive use
+    PROFILE_REPORTING,  // long read-only reports next to running writers
+    PROFILE_INGEST      // bulk writes
+} ConnectionProfile;
+
+// Fill config with the settings for a profile
+void database_config_for_profile(DatabaseConfig *config, ConnectionProfile profile);
+
+// Parse a profile name ("balanced", "reporting", "ingest"); returns 0 on success
+int parse_connection_profile(const char *name, ConnectionProfile *profile);
+
+// Called when a stock change made through this handle moves a product across
+// its reorder level: below is 1 when stock drops under reorder_level and 0
+// when it is restored. Runs synchronously inside the call that changed the
+// stock; the product pointer is only valid for the duration of the call.
+typedef void (*LowStockCallback)(const Product *product, int below, void *context);
 
 // Structure for database connection
 typedef struct {
     sqlite3 *connection;
     char *db_name;
+    DatabaseConfig config;
+    sqlite3_stmt *statements[STMT_COUNT];
+    ProductCatalog catalog;  // in-memory copy of Products (last lookup only on read-only handles,
+                             // which have no low-stock heap and query Products instead)
+    LowStockCallback low_stock_callback;
+    void *low_stock_context;
+    sqlite3_int64 checkpoint_after_id;  // last transaction id covered by the periodic checkpoint
 } Database;
 
+// Supplier record; strings from get_supplier_by_id are owned by the caller and
+// released with free_supplier
+typedef struct {
+    int supplier_id;
+    char *supplier_name;
+    char *contact_info;
+    char *address;
+} Supplier;
+
+// Transactions listing row; transaction_date is rendered as text
+typedef struct {
+    int transaction_id;
+    char *product_name;
+    int quantity;
+    char *transaction_date;
+    int customer_supplier_id;
+} TransactionRecord;
+
+// Sales report row, in report order
+typedef struct {
+    char *product_name;
+    long long total_sold;
+    double total_sales;
+} SalesReportRow;
+
 // Initialize the database (create tables if they don't exist)
-int initialize_database(Database *db, const char *db_name);
+// A NULL config uses the PROFILE_BALANCED settings.
+int initialize_database(Database *db, const char *db_name, const DatabaseConfig *config);
 
 // Connect to the database
 int connect_to_database(Database *db);
@@ -18,27 +129,228 @@ int connect_to_database(Database *db);
 // Close the database connection
 void close_database(Database *db);
 
+// Explicit transactions grouping several operations into one commit
+// rollback_transaction also reloads the catalog from the rolled-back state.
+int begin_transaction(Database *db);
+int commit_transaction(Database *db);
+int rollback_transaction(Database *db);
+
+// Reload the catalog after another connection has written to the same file
+int refresh_catalog(Database *db);
+
 // Products Table Operations
 int add_product(Database *db, const char *name, const char *description, const char *category,
                 double cost_price, double selling_price, int stock_quantity, int reorder_level);
+// Same with the caller choosing product_id (a sharded store allocates ids
+// across files); fails if the id is taken. A product_id below 1 behaves like add_product.
+int add_product_with_id(Database *db, int product_id, const char *name, const char *description,
+                        const char *category, double cost_price, double selling_price, int stock_quantity,
+                        int reorder_level);
 int delete_product(Database *db, int product_id);
 int update_stock_quantity(Database *db, int product_id, int new_quantity);
-int get_product_by_id(Database *db, int product_id);
+// Served from the in-memory catalog; the copied strings stay valid until the
+// product is next modified or deleted. Read-only handles query SQL instead and
+// their strings stay valid until the next lookup. Returns -1 if there is no such product.
+int get_product_by_id(Database *db, int product_id, Product *product);
 int list_all_products(Database *db);
 
 // Suppliers Table Operations
 int add_supplier(Database *db, const char *name, const char *contact_info, const char *address);
-int get_supplier_by_id(Database *db, int supplier_id);
+int get_supplier_by_id(Database *db, int supplier_id, Supplier *supplier);
+void free_supplier(Supplier *supplier);
 int list_all_suppliers(Database *db);
 
 int list_low_stock_products(Database *db);  // Add this if it's missing
 
+// Subscribe to reorder-level crossings on this handle (NULL unsubscribes).
+// Catalog reloads (rollback_transaction, refresh_catalog) do not fire it.
+void set_low_stock_callback(Database *db, LowStockCallback callback, void *context);
+
 // Transactions Table Operations
+// Type codes as stored in Transactions.transaction_type; the values are on disk, do not renumber
+typedef enum {
+    TRANSACTION_IN = 1,
+    TRANSACTION_OUT = 2
+} TransactionType;
+
+// Map "IN" / "OUT" to its code; returns 0 for anything else
+TransactionType parse_transaction_type(const char *name);
+
+// Dates are passed and returned as text ("YYYY-MM-DD" or "YYYY-MM-DD HH:MM:SS")
+// and stored as unix seconds; add_transaction rejects dates SQLite cannot parse.
+// add_transaction records an IN or OUT movement and adjusts Products.stock_quantity
+// in the same atomic SQL transaction. The quantity must be positive; the type
+// gives the direction.
 int add_transaction(Database *db, int product_id, const char *transaction_type,
                     int quantity, const char *transaction_date, int customer_supplier_id);
 int list_transactions(Database *db, const char *transaction_type);
 
+// Bulk transaction ingest
+// Rows are read as "product_id,transaction_type,quantity,transaction_date,customer_supplier_id".
+// Blank lines, '#' comments and a leading "product_id,..." header are skipped.
+// A batch_size below 1 falls back to one add_transaction call (and one commit) per row.
+typedef struct {
+    long rows_read;
+    long rows_inserted;
+    long rows_rejected;
+    long batches_committed;
+    double elapsed_seconds;
+} BulkIngestStats;
+
+int ingest_transactions(Database *db, FILE *input, int batch_size, BulkIngestStats *stats);
+
+// Stock checkpoints
+// StockCheckpoints holds the stock of a product at points in time, counting
+// every transaction dated up to that time. add_product and
+// update_stock_quantity record one (a manual count is not a transaction), a
+// backdated add_transaction corrects the checkpoints after its date, and
+// create_stock_checkpoint records one for every product with at least
+// min_movements transactions since its last checkpoint (0: every product).
+// Handles with a checkpoint_interval do the same with
+// STOCK_CHECKPOINT_MIN_MOVEMENTS every checkpoint_interval transactions, for
+// the products those transactions touched.
+// Returns the number of checkpoints written or -1.
+#define STOCK_CHECKPOINT_MIN_MOVEMENTS 64
+
+int create_stock_checkpoint(Database *db, int min_movements);
+
+// Stock as of a date ("YYYY-MM-DD" means the end of that day, NULL means now):
+// the latest checkpoint at or before it plus the transactions in between, or
+// before the first checkpoint, that checkpoint minus the transactions after
+// the date. Returns 0, or -1 for an unknown product or an invalid date.
+typedef struct {
+    int product_id;
+    const char *product_name;
+    int stock_quantity;
+    double cost_price;
+} StockLevel;
+
+typedef int (*StockLevelVisitor)(const StockLevel *level, void *context);
+
+int get_stock_as_of(Database *db, int product_id, const char *as_of_date, int *stock_quantity);
+// Every product in table order, valued at its current cost_price
+int visit_stock_as_of(Database *db, const char *as_of_date, StockLevelVisitor visitor, void *context);
+int write_stock_as_of(Database *db, const char *as_of_date, OutputSink *sink);
+
+// Incremental transaction export
+// ExportState remembers, per export name, the last transaction_id an export
+// delivered. write_new_transactions streams the transactions appended since,
+// in transaction_id order and in the row format ingest_transactions reads (so
+// a CSV export replays onto a restored backup), and sets *last_transaction_id
+// to the newest one it covered. Once the output is safely stored,
+// mark_transactions_exported records that position and the next export
+// starts after it; an export that is never marked is simply repeated.
+// write_new_transactions returns the number of rows written or -1.
+int write_new_transactions(Database *db, const char *export_name, OutputSink *sink,
+                           sqlite3_int64 *last_transaction_id);
+int mark_transactions_exported(Database *db, const char *export_name, sqlite3_int64 last_transaction_id);
+
 // Sales Report
 int generate_sales_report(Database *db, const char *start_date, const char *end_date);
 
+// Product search
+// Products are indexed by name, category and description in a full-text
+// index that triggers keep in step with the Products table. Every word of the
+// query must match the start of a word in the searched field(s), so "hex bo"
+// finds "Hex Bolt M8"; case and accents are ignored. Matches in the name rank
+// above category matches, which rank above description matches. At most limit
+// rows are returned (limit < 1: all matches); a query without any letters or
+// digits matches nothing.
+typedef enum {
+    SEARCH_ALL,
+    SEARCH_NAME,
+    SEARCH_CATEGORY,
+    SEARCH_DESCRIPTION
+} SearchField;
+
+// Parse a field name ("all", "name", "category", "description"); returns 0 on success
+int parse_search_field(const char *name, SearchField *field);
+
+int search_products(Database *db, const char *query, SearchField field, int limit);
+
+// Row visitors
+// The visit_* functions run a query and pass each row to visitor in the
+// order the matching write_* function prints it. The row and its strings are
+// only valid during the call; copy what must outlive it, or use the
+// arena-backed get_* functions below. A visitor returns 0 to continue or
+// nonzero to stop early. The functions return the number of rows visited or -1.
+typedef int (*ProductVisitor)(const Product *product, void *context);
+typedef int (*SupplierVisitor)(const Supplier *supplier, void *context);
+typedef int (*TransactionVisitor)(const TransactionRecord *transaction, void *context);
+typedef int (*SalesReportVisitor)(const SalesReportRow *row, void *context);
+
+int visit_products(Database *db, ProductVisitor visitor, void *context);
+int visit_suppliers(Database *db, SupplierVisitor visitor, void *context);
+int visit_transactions(Database *db, const char *transaction_type, TransactionVisitor visitor, void *context);
+int visit_sales_report(Database *db, const char *start_date, const char *end_date, SalesReportVisitor visitor,
+                       void *context);
+int visit_low_stock_products(Database *db, ProductVisitor visitor, void *context);
+int visit_product_search(Database *db, const char *query, SearchField field, int limit, ProductVisitor visitor,
+                         void *context);
+
+// Streaming output
+// The write_* functions stream rows to an OutputSink in its format and return
+// the number of rows written, or -1 on error; they are visitors over visit_*.
+// The list_* functions, search_products and generate_sales_report are
+// table-format wrappers writing to stdout.
+int write_products(Database *db, OutputSink *sink);
+int write_suppliers(Database *db, OutputSink *sink);
+int write_transactions(Database *db, const char *transaction_type, OutputSink *sink);
+int write_sales_report(Database *db, const char *start_date, const char *end_date, OutputSink *sink);
+int write_low_stock_products(Database *db, OutputSink *sink);
+int write_product_search(Database *db, const char *query, SearchField field, int limit, OutputSink *sink);
+
+// Row layouts
+// begin_*_rows starts a row stream in the layout of the matching write_*
+// function, and the write_*_row visitors append one row to the OutputSink
+// passed as context, for callers that assemble rows themselves (merged
+// shards, single-record replies).
+void begin_product_rows(OutputSink *sink);
+void begin_supplier_rows(OutputSink *sink);
+void begin_sales_report_rows(OutputSink *sink);
+void begin_low_stock_rows(OutputSink *sink);
+int write_product_row(const Product *product, void *context);
+int write_supplier_row(const Supplier *supplier, void *context);
+int write_sales_report_row(const SalesReportRow *row, void *context);
+int write_low_stock_row(const Product *product, void *context);
+
+// Keyset pagination
+// Pages hold at most page_size rows with an id greater than after_id (0 for the
+// first page). *next_after_id receives the continuation token for the next
+// page, or 0 when there are no more rows; a visitor that stops early ends the
+// page without one.
+int list_products_page(Database *db, int page_size, int after_id, int *next_after_id);
+int list_transactions_page(Database *db, const char *transaction_type, int page_size, int after_id,
+                           int *next_after_id);
+int write_products_page(Database *db, int page_size, int after_id, OutputSink *sink, int *next_after_id);
+int write_transactions_page(Database *db, const char *transaction_type, int page_size, int after_id,
+                            OutputSink *sink, int *next_after_id);
+int visit_products_page(Database *db, int page_size, int after_id, ProductVisitor visitor, void *context,
+                        int *next_after_id);
+int visit_transactions_page(Database *db, const char *transaction_type, int page_size, int after_id,
+                            TransactionVisitor visitor, void *context, int *next_after_id);
+
+// Record-returning queries
+// Records, the arrays holding them and every string they point to are
+// allocated from the caller's arena and stay valid until it is reset, so one
+// arena_reset releases everything a request produced. Lookups return 0 or -1
+// (missing or failed); the list functions return the row count or -1.
+
+int get_product_record(Database *db, int product_id, Arena *arena, Product **product);
+int get_supplier_record(Database *db, int supplier_id, Arena *arena, Supplier **supplier);
+int get_products_page(Database *db, int page_size, int after_id, Arena *arena, Product **rows,
+                      int *next_after_id);
+int get_transactions_page(Database *db, const char *transaction_type, int page_size, int after_id,
+                          Arena *arena, TransactionRecord **rows, int *next_after_id);
+int get_sales_report(Database *db, const char *start_date, const char *end_date, Arena *arena,
+                     SalesReportRow **rows);
+int get_low_stock_products(Database *db, Arena *arena, Product **rows);
+
+// Metrics report: the per-operation metrics of metrics.h, then for this
+// connection one row per cached statement that has run (sqlite3_stmt_status:
+// runs, VM steps, full scan steps, sorts, automatic indexes, reprepares,
+// memory) and its page cache and memory counters (sqlite3_db_status).
+// A NULL db writes the operation metrics only. Returns the rows written.
+int write_metrics(Database *db, OutputSink *sink);
+
 #endif // DATABASE_H
@@ -0,0 +1,511 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include "forecast.h"
+
+#define FORECAST_BLOCK 4096  // products per claimed block; its four accumulators stay in L2
+#define FORECAST_LANES 8     // floats per vector operation (one AVX register, two SSE registers)
+#define FORECAST_ALIGN (FORECAST_LANES * sizeof(float))
+#define NO_COVER -1.0f       // days of cover without any forecast demand
+
+// Generic vector of FORECAST_LANES floats; GCC maps it onto whatever SIMD the target has
+typedef float Lanes __attribute__((vector_size(FORECAST_LANES * sizeof(float))));
+
+static const OutputColumn forecast_columns[] = {
+    {"ID", "product_id", 6},
+    {"Name", "product_name", 20},
+    {"Stock", "stock_quantity", 8},
+    {"Avg/Day", "moving_average", 9},
+    {"Forecast/Day", "forecast", 12},
+    {"Days Cover", "days_of_cover", 10},
+    {"Reorder Level", "reorder_level", 13},
+    {"Suggested Level", "suggested_reorder_level", 15},
+    {"Order Qty", "order_quantity", 10},
+};
+#define FORECAST_COLUMN_COUNT ((int)(sizeof(forecast_columns) / sizeof(forecast_columns[0])))
+
+void forecast_default_options(ForecastOptions *options) {
+    options->as_of_date = NULL;
+    options->history_days = 56;
+    options->window_days = 28;
+    options->alpha = 0.3;
+    options->lead_time_days = 7;
+    options->review_days = 7;
+    options->service_z = 1.65;
+    options->thread_count = 0;
+    options->include_all = 0;
+}
+
+// Dense per-product columns, indexed by position in Products order
+typedef struct {
+    int count;
+    int capacity;
+    int *product_ids;
+    int *stock;
+    int *reorder_levels;
+} ProductColumns;
+
+// One entry of the product_id -> column index, kept sorted by product_id
+typedef struct {
+    int product_id;
+    int column;
+} ColumnIndex;
+
+typedef struct {
+    Database *db;
+    const ForecastOptions *options;
+    ProductColumns products;
+    ColumnIndex *index;   // products.count entries, see find_column
+    int first_day;        // day number (days since 1970-01-01) of demand row 0
+    int day_count;
+    int window_days;
+    int stride;           // products.count rounded up to whole lanes
+    float *demand;        // demand[day * stride + column], zero in the padding
+
+    // Results by column
+    float *averages;
+    float *forecasts;
+    float *days_of_cover;
+    int *suggested_levels;
+    int *order_quantities;
+
+    int thread_count;
+    int block_count;
+    atomic_int next_block;
+} ForecastJob;
+
+typedef struct {
+    ForecastJob *job;
+    int first_day;  // load phase: day span [first_day, last_day)
+    int last_day;
+    float *scratch; // plan phase: FORECAST_BLOCK floats for each running sum
+    int status;
+} ForecastWorker;
+
+// Float array aligned for Lanes access
+static float *alloc_lanes(size_t count) {
+    size_t size = (count * sizeof(float) + FORECAST_ALIGN - 1) / FORECAST_ALIGN * FORECAST_ALIGN;
+    return aligned_alloc(FORECAST_ALIGN, size > 0 ? size : FORECAST_ALIGN);
+}
+
+static int collect_product_column(const Product *product, void *context) {
+    ProductColumns *columns = context;
+    if (columns->count == columns->capacity) {
+        int grown = columns->capacity ? columns->capacity * 2 : 1024;
+        int *ids = realloc(columns->product_ids, sizeof(int) * grown);
+        if (ids) {
+            columns->product_ids = ids;
+        }
+        int *stock = realloc(columns->stock, sizeof(int) * grown);
+        if (stock) {
+            columns->stock = stock;
+        }
+        int *levels = realloc(columns->reorder_levels, sizeof(int) * grown);
+        if (levels) {
+            columns->reorder_levels = levels;
+        }
+        if (!ids || !stock || !levels) {
+            return 1;
+        }
+        columns->capacity = grown;
+    }
+    columns->product_ids[columns->count] = product->product_id;
+    columns->stock[columns->count] = product->stock_quantity;
+    columns->reorder_levels[columns->count] = product->reorder_level;
+    columns->count++;
+    return 0;
+}
+
+static int compare_column_ids(const void *a, const void *b) {
+    const ColumnIndex *ca = a, *cb = b;
+    return (ca->product_id > cb->product_id) - (ca->product_id < cb->product_id);
+}
+
+// Column of a product, or -1 if it was not collected
+static int find_column(const ForecastJob *job, int product_id) {
+    int low = 0;
+    int high = job->products.count;
+    while (low < high) {
+        int middle = low + (high - low) / 2;
+        if (job->index[middle].product_id < product_id) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low < job->products.count && job->index[low].product_id == product_id ? job->index[low].column : -1;
+}
+
+// Replace a product's current stock with its stock on the as-of date
+static int apply_stock_level(const StockLevel *level, void *context) {
+    ForecastJob *job = context;
+    int column = find_column(job, level->product_id);
+    if (column >= 0) {
+        job->products.stock[column] = level->stock_quantity;
+    }
+    return 0;
+}
+
+// Day number of the last day of history, never later than today, and of today
+static int find_as_of_day(Database *db, const char *as_of_date, int *day, int *today) {
+    sqlite3_stmt *stmt;
+    int status = -1;
+
+    if (sqlite3_prepare_v2(db->connection,
+                           "SELECT min(unixepoch(coalesce(?1, 'now'), 'start of day'), "
+                           "unixepoch('now', 'start of day')) / 86400, "
+                           "unixepoch('now', 'start of day') / 86400;",
+                           -1, &stmt, NULL) != SQLITE_OK) {
+        fprintf(stderr, "Failed to prepare statement: %s\n", sqlite3_errmsg(db->connection));
+        return -1;
+    }
+    sqlite3_bind_text(stmt, 1, as_of_date, -1, SQLITE_STATIC);
+    if (sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_type(stmt, 0) == SQLITE_INTEGER) {
+        *day = sqlite3_column_int(stmt, 0);
+        *today = sqlite3_column_int(stmt, 1);
+        status = 0;
+    } else {
+        fprintf(stderr, "Invalid forecast date: %s\n", as_of_date ? as_of_date : "(now)");
+    }
+    sqlite3_finalize(stmt);
+    return status;
+}
+
+// Load phase: scatter one span of days from DailySales into the demand matrix.
+// Spans are disjoint, so workers never write the same cell.
+static void *load_worker_main(void *arg) {
+    ForecastWorker *worker = arg;
+    ForecastJob *job = worker->job;
+    DatabaseConfig config = job->db->config;
+    Database db;
+    sqlite3_stmt *stmt = NULL;
+    int rc;
+
+    worker->status = -1;
+    if (worker->first_day >= worker->last_day) {
+        worker->status = 0;
+        return NULL;
+    }
+    config.read_only = 1;
+    if (initialize_database(&db, job->db->db_name, &config) != 0) {
+        return NULL;
+    }
+    if (sqlite3_prepare_v2(db.connection,
+                           "SELECT sale_day, product_id, quantity FROM DailySales "
+                           "WHERE sale_day >= ?1 AND sale_day < ?2;",
+                           -1, &stmt, NULL) != SQLITE_OK) {
+        fprintf(stderr, "Failed to prepare forecast query: %s\n", sqlite3_errmsg(db.connection));
+        close_database(&db);
+        return NULL;
+    }
+
+    sqlite3_bind_int(stmt, 1, worker->first_day);
+    sqlite3_bind_int(stmt, 2, worker->last_day);
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        int day = sqlite3_column_int(stmt, 0) - job->first_day;
+        int column = find_column(job, sqlite3_column_int(stmt, 1));
+        // Sales of products deleted since are not planned
+        if (column < 0) {
+            continue;
+        }
+        job->demand[(size_t)day * job->stride + column] += (float)sqlite3_column_int(stmt, 2);
+    }
+    if (rc == SQLITE_DONE) {
+        worker->status = 0;
+    } else {
+        fprintf(stderr, "Failed to load demand history: %s\n", sqlite3_errmsg(db.connection));
+    }
+
+    sqlite3_finalize(stmt);
+    close_database(&db);
+    return NULL;
+}
+
+// Plan phase: every statistic is a pass over the days, each adding one row
+// of the matrix into block-sized accumulators, FORECAST_LANES products per
+// vector operation. Rows are padded to whole lanes.
+static void plan_block(ForecastJob *job, int block, float *scratch) {
+    const ForecastOptions *options = job->options;
+    int first = block * FORECAST_BLOCK;
+    int count = job->products.count - first < FORECAST_BLOCK ? job->products.count - first : FORECAST_BLOCK;
+    int vectors = (count + FORECAST_LANES - 1) / FORECAST_LANES;
+    int window_start = job->day_count - job->window_days;
+    Lanes *total = (Lanes *)scratch;
+    Lanes *sum = total + FORECAST_BLOCK / FORECAST_LANES;
+    Lanes *squares = sum + FORECAST_BLOCK / FORECAST_LANES;
+    Lanes *level = squares + FORECAST_BLOCK / FORECAST_LANES;
+    float alpha = (float)options->alpha;
+
+    memset(scratch, 0, sizeof(float) * 3 * FORECAST_BLOCK);
+    for (int day = 0; day < job->day_count; day++) {
+        const Lanes *row = (const Lanes *)(job->demand + (size_t)day * job->stride + first);
+        for (int v = 0; v < vectors; v++) {
+            total[v] += row[v];
+        }
+        if (day >= window_start) {
+            for (int v = 0; v < vectors; v++) {
+                sum[v] += row[v];
+                squares[v] += row[v] * row[v];
+            }
+        }
+    }
+
+    // Simple exponential smoothing, started from the mean of the history
+    float inverse_days = 1.0f / (float)job->day_count;
+    for (int v = 0; v < vectors; v++) {
+        level[v] = total[v] * inverse_days;
+    }
+    for (int day = 0; day < job->day_count; day++) {
+        const Lanes *row = (const Lanes *)(job->demand + (size_t)day * job->stride + first);
+        for (int v = 0; v < vectors; v++) {
+            level[v] += alpha * (row[v] - level[v]);
+        }
+    }
+
+    double lead_time = options->lead_time_days;
+    double cycle = options->lead_time_days + options->review_days;
+    double safety_factor = options->service_z * sqrt(lead_time > 0 ? lead_time : 0);
+    float inverse_window = 1.0f / (float)job->window_days;
+    const float *sums = (const float *)sum;
+    const float *square_sums = (const float *)squares;
+    const float *levels = (const float *)level;
+    for (int p = 0; p < count; p++) {
+        int column = first + p;
+        float average = sums[p] * inverse_window;
+        float variance = square_sums[p] * inverse_window - average * average;
+        double safety_stock = safety_factor * sqrt(variance > 0 ? variance : 0);
+        double reorder_level = levels[p] * lead_time + safety_stock;
+        int stock = job->products.stock[column];
+
+        job->averages[column] = average;
+        job->forecasts[column] = levels[p];
+        job->days_of_cover[column] = levels[p] > 0 ? (stock > 0 ? stock : 0) / levels[p] : NO_COVER;
+        job->suggested_levels[column] = (int)ceil(reorder_level);
+        job->order_quantities[column] = 0;
+        if (levels[p] > 0 && stock <= reorder_level) {
+            double target = levels[p] * cycle + safety_stock;
+            job->order_quantities[column] = target > stock ? (int)ceil(target - stock) : 0;
+        }
+    }
+}
+
+static void *plan_worker_main(void *arg) {
+    ForecastWorker *worker = arg;
+    ForecastJob *job = worker->job;
+    int block;
+
+    while ((block = atomic_fetch_add(&job->next_block, 1)) < job->block_count) {
+        plan_block(job, block, worker->scratch);
+    }
+    worker->status = 0;
+    return NULL;
+}
+
+// Run one phase on every worker; the calling thread runs the first one
+static int run_phase(ForecastJob *job, ForecastWorker *workers, void *(*phase)(void *)) {
+    pthread_t *threads = calloc(job->thread_count, sizeof(pthread_t));
+    int *threaded = calloc(job->thread_count, sizeof(int));
+    int status = 0;
+
+    if (!threads || !threaded) {
+        fprintf(stderr, "Out of memory starting forecast\n");
+        free(threads);
+        free(threaded);
+        return -1;
+    }
+    for (int i = 1; i < job->thread_count; i++) {
+        threaded[i] = pthread_create(&threads[i], NULL, phase, &workers[i]) == 0;
+    }
+    phase(&workers[0]);
+    for (int i = 1; i < job->thread_count; i++) {
+        if (threaded[i]) {
+            pthread_join(threads[i], NULL);
+        } else {
+            phase(&workers[i]);
+        }
+    }
+    for (int i = 0; i < job->thread_count; i++) {
+        if (workers[i].status != 0) {
+            status = -1;
+        }
+    }
+    free(threads);
+    free(threaded);
+    return status;
+}
+
+// Output order key of one product
+typedef struct {
+    int column;
+    int product_id;
+    int reorder;  // 1 if there is something to order
+    float days_of_cover;
+} PlanKey;
+
+// Products to reorder first, then the fewest days of cover, then by id
+static int compare_plans(const void *a, const void *b) {
+    const PlanKey *ka = a, *kb = b;
+    if (ka->reorder != kb->reorder) {
+        return kb->reorder - ka->reorder;
+    }
+    if (ka->days_of_cover != kb->days_of_cover) {
+        if (ka->days_of_cover == NO_COVER || kb->days_of_cover == NO_COVER) {
+            return ka->days_of_cover == NO_COVER ? 1 : -1;
+        }
+        return ka->days_of_cover < kb->days_of_cover ? -1 : 1;
+    }
+    return (ka->product_id > kb->product_id) - (ka->product_id < kb->product_id);
+}
+
+static int write_plans(ForecastJob *job, OutputSink *sink) {
+    PlanKey *keys = malloc(sizeof(PlanKey) * (job->products.count > 0 ? job->products.count : 1));
+    int row_count = 0;
+
+    if (!keys) {
+        fprintf(stderr, "Out of memory writing forecast\n");
+        return -1;
+    }
+    for (int column = 0; column < job->products.count; column++) {
+        if (job->options->include_all || job->order_quantities[column] > 0) {
+            keys[row_count++] = (PlanKey){
+                .column = column,
+                .product_id = job->products.product_ids[column],
+                .reorder = job->order_quantities[column] > 0,
+                .days_of_cover = job->days_of_cover[column],
+            };
+        }
+    }
+    qsort(keys, row_count, sizeof(PlanKey), compare_plans);
+
+    output_begin(sink, forecast_columns, FORECAST_COLUMN_COUNT);
+    for (int i = 0; i < row_count; i++) {
+        int column = keys[i].column;
+        Product product;
+        int found = get_product_by_id(job->db, keys[i].product_id, &product) == 0;
+        output_int(sink, keys[i].product_id);
+        output_text(sink, found ? product.product_name : NULL);
+        output_int(sink, job->products.stock[column]);
+        output_decimal(sink, job->averages[column], 2);
+        output_decimal(sink, job->forecasts[column], 2);
+        if (job->days_of_cover[column] == NO_COVER) {
+            output_text(sink, NULL);
+        } else {
+            output_decimal(sink, job->days_of_cover[column], 1);
+        }
+        output_int(sink, job->products.reorder_levels[column]);
+        output_int(sink, job->suggested_levels[column]);
+        output_int(sink, job->order_quantities[column]);
+        output_end_row(sink);
+    }
+    free(keys);
+    return row_count;
+}
+
+static void free_job(ForecastJob *job) {
+    free(job->products.product_ids);
+    free(job->products.stock);
+    free(job->products.reorder_levels);
+    free(job->index);
+    free(job->demand);
+    free(job->averages);
+    free(job->forecasts);
+    free(job->days_of_cover);
+    free(job->suggested_levels);
+    free(job->order_quantities);
+}
+
+int write_demand_forecast(Database *db, const ForecastOptions *options, OutputSink *sink) {
+    ForecastOptions defaults;
+    if (!options) {
+        forecast_default_options(&defaults);
+        options = &defaults;
+    }
+    if (options->history_days < 1 || options->window_days < 1 || options->alpha <= 0 || options->alpha > 1) {
+        fprintf(stderr, "Forecast needs at least one day of history and 0 < alpha <= 1\n");
+        return -1;
+    }
+
+    ForecastJob job = {.db = db, .options = options};
+    int as_of_day;
+    int today;
+    if (find_as_of_day(db, options->as_of_date, &as_of_day, &today) != 0) {
+        return -1;
+    }
+    job.day_count = options->history_days;
+    job.first_day = as_of_day - job.day_count + 1;
+    job.window_days = options->window_days < job.day_count ? options->window_days : job.day_count;
+
+    if (visit_products(db, collect_product_column, &job.products) != job.products.count) {
+        fprintf(stderr, "Failed to collect products for the forecast\n");
+        free_job(&job);
+        return -1;
+    }
+
+    size_t count = job.products.count > 0 ? (size_t)job.products.count : 1;
+    job.stride = (job.products.count + FORECAST_LANES - 1) / FORECAST_LANES * FORECAST_LANES;
+    job.index = malloc(sizeof(ColumnIndex) * count);
+    job.demand = alloc_lanes((size_t)job.day_count * job.stride);
+    job.averages = malloc(sizeof(float) * count);
+    job.forecasts = malloc(sizeof(float) * count);
+    job.days_of_cover = malloc(sizeof(float) * count);
+    job.suggested_levels = malloc(sizeof(int) * count);
+    job.order_quantities = malloc(sizeof(int) * count);
+    if (!job.index || !job.demand || !job.averages || !job.forecasts || !job.days_of_cover ||
+        !job.suggested_levels || !job.order_quantities) {
+        fprintf(stderr, "Out of memory for %d products x %d days of demand\n", job.products.count,
+                job.day_count);
+        free_job(&job);
+        return -1;
+    }
+    memset(job.demand, 0, sizeof(float) * job.day_count * job.stride);
+    for (int i = 0; i < job.products.count; i++) {
+        job.index[i] = (ColumnIndex){job.products.product_ids[i], i};
+    }
+    qsort(job.index, job.products.count, sizeof(ColumnIndex), compare_column_ids);
+
+    // Plan against the stock on hand at the end of a past as-of day, not today's
+    if (as_of_day < today && visit_stock_as_of(db, options->as_of_date, apply_stock_level, &job) < 0) {
+        fprintf(stderr, "Failed to read stock as of %s for the forecast\n", options->as_of_date);
+        free_job(&job);
+        return -1;
+    }
+
+    job.thread_count = options->thread_count;
+    if (job.thread_count < 1) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        job.thread_count = cpus > 0 ? (int)cpus : 1;
+    }
+    job.block_count = (job.products.count + FORECAST_BLOCK - 1) / FORECAST_BLOCK;
+    atomic_init(&job.next_block, 0);
+
+    ForecastWorker *workers = calloc(job.thread_count, sizeof(ForecastWorker));
+    float *scratch = alloc_lanes((size_t)4 * FORECAST_BLOCK * job.thread_count);
+    int status = 0;
+    if (!workers || !scratch) {
+        fprintf(stderr, "Out of memory starting forecast\n");
+        status = -1;
+    }
+    for (int i = 0; status == 0 && i < job.thread_count; i++) {
+        workers[i].job = &job;
+        workers[i].first_day = job.first_day + (int)((long long)job.day_count * i / job.thread_count);
+        workers[i].last_day = job.first_day + (int)((long long)job.day_count * (i + 1) / job.thread_count);
+        workers[i].scratch = scratch + (size_t)4 * FORECAST_BLOCK * i;
+    }
+
+    if (status == 0) {
+        status = run_phase(&job, workers, load_worker_main);
+    }
+    if (status == 0) {
+        status = run_phase(&job, workers, plan_worker_main);
+    }
+    int rows = status == 0 ? write_plans(&job, sink) : -1;
+
+    free(workers);
+    free(scratch);
+    free_job(&job);
+    return rows;
+}
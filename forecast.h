@@ -0,0 +1,46 @@
+#ifndef FORECAST_H
+#define FORECAST_H
+
+#include "database.h"
+
+// Demand forecast and reorder suggestions
+// Daily OUT quantities for the history_days days ending on the as-of date
+// are loaded from the DailySales rollup into one dense float matrix, one
+// row per day and one column per product, by worker threads that each read
+// a span of days through their own read-only connection. Worker threads then
+// claim blocks of products and run every statistic as a pass over the days
+// whose inner loop walks contiguous product columns in GCC vector types, a
+// few products per SIMD instruction:
+//   moving average   mean daily demand over the last window_days days
+//   forecast         exponential smoothing (alpha) of daily demand over the
+//                    whole history, started from its mean
+//   days of cover    stock_quantity / forecast (none without forecast demand)
+//   reorder level    forecast * lead_time_days plus safety stock of
+//                    service_z standard deviations of daily demand over the
+//                    window, scaled by sqrt(lead_time_days)
+//   order quantity   when stock is at or below that level, enough to reach
+//                    forecast * (lead_time_days + review_days) plus safety stock
+// Days without sales count as zero demand, and stock is the stock on hand
+// at the end of the as-of date.
+
+typedef struct {
+    const char *as_of_date;  // last day of history ("YYYY-MM-DD"); NULL or later than today means today
+    int history_days;        // days loaded and smoothed
+    int window_days;         // days in the moving average and the deviation
+    double alpha;            // smoothing factor, 0 < alpha <= 1
+    double lead_time_days;   // days between ordering and receiving stock
+    double review_days;      // days between planning runs
+    double service_z;        // safety stock in standard deviations (1.65: about 95% service)
+    int thread_count;        // 0 = one per online CPU
+    int include_all;         // write every product, not only those to reorder
+} ForecastOptions;
+
+// Fill options with defaults (56 days of history, 28-day window, alpha 0.3,
+// 7-day lead time and review period, z = 1.65, only products to reorder)
+void forecast_default_options(ForecastOptions *options);
+
+// Plan every product and stream the result to sink, products to reorder
+// first and the fewest days of cover first. Returns the rows written or -1.
+int write_demand_forecast(Database *db, const ForecastOptions *options, OutputSink *sink);
+
+#endif // FORECAST_H
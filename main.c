@@ -1,7 +1,17 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include "database.h"
+#include "server.h"
+#include "snapshot.h"
+#include "report.h"
+#include "csv_import.h"
+#include "metrics.h"
+#include "shard.h"
+#include "backup.h"
+#include "forecast.h"
 
 // Function prototypes for menu operations
 void display_menu();
@@ -13,25 +23,285 @@ void handle_add_supplier(Database *db);
 void handle_list_transactions(Database *db);
 void handle_list_suppliers(Database *db);
 void handle_add_transaction(Database *db);
-void handle_exit(Database *db);
+void handle_exit(Database *db, const char *metrics_path, OutputFormat format);
 void handle_exit_to_main_menu();
-void handle_low_stock_products();
+void handle_low_stock_products(Database *db);
+void handle_find_product(Database *db);
+void handle_find_supplier(Database *db);
+void handle_list_products_paged(Database *db);
+void handle_list_transactions_paged(Database *db);
+void handle_show_metrics(Database *db);
+void handle_search_products(Database *db);
+void handle_stock_as_of(Database *db);
+void handle_backup(Database *db);
+void handle_reorder_suggestions(Database *db);
+int prompt_next_page(void);
+void print_low_stock_alert(const Product *product, int below, void *context);
+void print_usage(const char *program);
+int save_metrics(Database *db, const char *path, OutputFormat format);
+int finish_run(Database *db, int status, const char *metrics_path, OutputFormat format);
+int run_ingest_mode(Database *db, const char *path, int batch_size);
+int run_import_mode(Database *db, const char *products_path, const char *suppliers_path, int batch_size);
+void print_bulk_stats(const BulkIngestStats *stats, int batch_size);
+int run_dump_mode(Database *db, const char *what, OutputFormat format, const char *output_path,
+                  const char *transaction_type, const char *start_date, const char *end_date,
+                  const char *snapshot_path, ReportBreakdown breakdown, int thread_count,
+                  const ForecastOptions *forecast_options);
+int run_backup_mode(Database *db, const char *path, int pages_per_step);
+int run_export_new_mode(Database *db, const char *path, OutputFormat format);
+void print_backup_progress(int pages_done, int page_count, void *context);
+int run_sharded_mode(ShardSet *set, const char *ingest_path, int batch_size, const char *dump_what,
+                     OutputFormat format, const char *output_path, const char *start_date,
+                     const char *end_date);
 
-int main() {
+#define DEFAULT_INGEST_BATCH_SIZE 1000
+
+// ExportState entry shared by --backup and --export-new, so each export
+// picks up where the last full backup or export left off
+#define BACKUP_EXPORT_NAME "backup"
+
+int main(int argc, char *argv[]) {
     Database db;
     const char *db_name = "inventory.db";
+    const char *ingest_path = NULL;
+    const char *import_products_path = NULL;
+    const char *import_suppliers_path = NULL;
+    int batch_size = DEFAULT_INGEST_BATCH_SIZE;
+    const char *profile_name = NULL;
+    int reject_negative_stock = 0;
+    const char *dump_what = NULL;
+    const char *output_path = NULL;
+    const char *transaction_type = "OUT";
+    const char *start_date = "0000-01-01";
+    const char *end_date = "9999-12-31 23:59:59";
+    OutputFormat format = OUTPUT_TABLE;
+    const char *socket_path = NULL;
+    int worker_count = 0;
+    const char *export_snapshot_path = NULL;
+    const char *snapshot_path = NULL;
+    ReportBreakdown breakdown = BREAKDOWN_PRODUCT;
+    int thread_count = 0;
+    const char *metrics_path = NULL;
+    int take_checkpoint = 0;
+    int shard_count = 1;
+    int split_shards = 0;
+    const char *backup_path = NULL;
+    int backup_step = 0;
+    const char *export_new_path = NULL;
+    double lead_time_days = 0;
+
+    // Parse command line options
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--db") == 0 && i + 1 < argc) {
+            db_name = argv[++i];
+        } else if (strcmp(argv[i], "--ingest") == 0 && i + 1 < argc) {
+            ingest_path = argv[++i];
+        } else if (strcmp(argv[i], "--import-products") == 0 && i + 1 < argc) {
+            import_products_path = argv[++i];
+        } else if (strcmp(argv[i], "--import-suppliers") == 0 && i + 1 < argc) {
+            import_suppliers_path = argv[++i];
+        } else if (strcmp(argv[i], "--batch-size") == 0 && i + 1 < argc) {
+            batch_size = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--profile") == 0 && i + 1 < argc) {
+            profile_name = argv[++i];
+        } else if (strcmp(argv[i], "--no-negative-stock") == 0) {
+            reject_negative_stock = 1;
+        } else if (strcmp(argv[i], "--dump") == 0 && i + 1 < argc) {
+            dump_what = argv[++i];
+        } else if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+            if (parse_output_format(argv[++i], &format) != 0) {
+                print_usage(argv[0]);
+                return -1;
+            }
+        } else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            output_path = argv[++i];
+        } else if (strcmp(argv[i], "--type") == 0 && i + 1 < argc) {
+            transaction_type = argv[++i];
+        } else if (strcmp(argv[i], "--from") == 0 && i + 1 < argc) {
+            start_date = argv[++i];
+        } else if (strcmp(argv[i], "--to") == 0 && i + 1 < argc) {
+            end_date = argv[++i];
+        } else if (strcmp(argv[i], "--serve") == 0 && i + 1 < argc) {
+            socket_path = argv[++i];
+        } else if (strcmp(argv[i], "--workers") == 0 && i + 1 < argc) {
+            worker_count = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--export-snapshot") == 0 && i + 1 < argc) {
+            export_snapshot_path = argv[++i];
+        } else if (strcmp(argv[i], "--snapshot") == 0 && i + 1 < argc) {
+            snapshot_path = argv[++i];
+        } else if (strcmp(argv[i], "--by") == 0 && i + 1 < argc) {
+            if (parse_report_breakdown(argv[++i], &breakdown) != 0) {
+                print_usage(argv[0]);
+                return -1;
+            }
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            thread_count = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--metrics") == 0 && i + 1 < argc) {
+            metrics_path = argv[++i];
+        } else if (strcmp(argv[i], "--checkpoint") == 0) {
+            take_checkpoint = 1;
+        } else if (strcmp(argv[i], "--shards") == 0 && i + 1 < argc) {
+            shard_count = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--split") == 0) {
+            split_shards = 1;
+        } else if (strcmp(argv[i], "--backup") == 0 && i + 1 < argc) {
+            backup_path = argv[++i];
+        } else if (strcmp(argv[i], "--backup-step") == 0 && i + 1 < argc) {
+            backup_step = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--export-new") == 0 && i + 1 < argc) {
+            export_new_path = argv[++i];
+        } else if (strcmp(argv[i], "--lead-time") == 0 && i + 1 < argc) {
+            lead_time_days = atof(argv[++i]);
+        } else {
+            print_usage(argv[0]);
+            return -1;
+        }
+    }
+
+    // Pick the connection profile; bulk loads and dumps default to their own
+    int bulk_load = ingest_path || import_products_path || import_suppliers_path;
+    ConnectionProfile profile = bulk_load ? PROFILE_INGEST
+                              : dump_what || export_snapshot_path ? PROFILE_REPORTING : PROFILE_BALANCED;
+    if (profile_name && parse_connection_profile(profile_name, &profile) != 0) {
+        print_usage(argv[0]);
+        return -1;
+    }
+    DatabaseConfig config;
+    database_config_for_profile(&config, profile);
+    config.reject_negative_stock = reject_negative_stock;
+
+    // Everything but the sharded paths reads db_name as one whole database
+    if (shard_count == 1 && shard_check_single_file(db_name) != 0) {
+        return -1;
+    }
+
+    // Sharded sets support the bulk paths that scale with the shard count
+    if (shard_count != 1) {
+        if (socket_path || import_products_path || import_suppliers_path || export_snapshot_path ||
+            backup_path || export_new_path || take_checkpoint) {
+            fprintf(stderr, "--shards does not support --serve, --import-products, --import-suppliers, "
+                            "--export-snapshot, --backup, --export-new or --checkpoint\n");
+            return -1;
+        }
+        if (split_shards) {
+            int status = shard_split_database(db_name, shard_count, &config);
+            if (status == 0) {
+                fprintf(stderr, "%s split into %d shards\n", db_name, shard_count);
+            }
+            return status;
+        }
+        if (!ingest_path && !dump_what) {
+            fprintf(stderr, "--shards needs --split, --ingest or --dump\n");
+            return -1;
+        }
+        ShardSet set;
+        if (shard_set_open(&set, db_name, shard_count, &config) != 0) {
+            return -1;
+        }
+        int status = run_sharded_mode(&set, ingest_path, batch_size, dump_what, format, output_path,
+                                      start_date, end_date);
+        if (metrics_path && save_metrics(NULL, metrics_path, format) != 0) {
+            status = -1;
+        }
+        shard_set_close(&set);
+        return status;
+    }
+
+    // Daemon mode opens its own connections
+    if (socket_path) {
+        ServerOptions options;
+        server_default_options(&options);
+        options.config = config;
+        if (worker_count > 0) {
+            options.worker_count = worker_count;
+        }
+        int status = run_server(db_name, socket_path, &options) == 0 ? 0 : -1;
+        if (metrics_path) {
+            save_metrics(NULL, metrics_path, format);
+        }
+        return status;
+    }
 
     // Initialize the database
-    if (initialize_database(&db, db_name) != 0) {
+    if (initialize_database(&db, db_name, &config) != 0) {
         return -1;
     }
 
+    // Non-interactive bulk ingest
+    if (ingest_path) {
+        int status = run_ingest_mode(&db, ingest_path, batch_size);
+        return finish_run(&db, status, metrics_path, format);
+    }
+
+    // Non-interactive catalog import
+    if (import_products_path || import_suppliers_path) {
+        int status = run_import_mode(&db, import_products_path, import_suppliers_path, batch_size);
+        return finish_run(&db, status, metrics_path, format);
+    }
+
+    // Columnar snapshot for the analytics reports
+    if (export_snapshot_path) {
+        int status = snapshot_export(&db, export_snapshot_path);
+        if (status == 0) {
+            fprintf(stderr, "Snapshot written to %s\n", export_snapshot_path);
+        }
+        return finish_run(&db, status, metrics_path, format);
+    }
+
+    // Online backup while other processes keep trading
+    if (backup_path) {
+        int status = run_backup_mode(&db, backup_path, backup_step);
+        return finish_run(&db, status, metrics_path, format);
+    }
+
+    // Transactions appended since the last backup or export
+    if (export_new_path) {
+        int status = run_export_new_mode(&db, export_new_path, format);
+        return finish_run(&db, status, metrics_path, format);
+    }
+
+    // Stock checkpoint of every product that moved since its last one (e.g. nightly from cron)
+    if (take_checkpoint) {
+        int written = create_stock_checkpoint(&db, 1);
+        if (written >= 0) {
+            fprintf(stderr, "Stock checkpoint written for %d products\n", written);
+        }
+        return finish_run(&db, written >= 0 ? 0 : -1, metrics_path, format);
+    }
+
+    // Non-interactive export
+    if (dump_what) {
+        ForecastOptions forecast_options;
+        forecast_default_options(&forecast_options);
+        forecast_options.as_of_date = end_date;
+        forecast_options.thread_count = thread_count;
+        if (lead_time_days > 0) {
+            forecast_options.lead_time_days = lead_time_days;
+        }
+        int status = run_dump_mode(&db, dump_what, format, output_path,
+                                   transaction_type, start_date, end_date, snapshot_path,
+                                   breakdown, thread_count, &forecast_options);
+        return finish_run(&db, status, metrics_path, format);
+    }
+
+    // Tell the operator as soon as a change pushes a product under its reorder level
+    set_low_stock_callback(&db, print_low_stock_alert, NULL);
+
     int choice;
     while (1) {
         // Display the menu
         display_menu();
         printf("Enter your choice: ");
-        if (scanf("%d", &choice) != 1) {
+        int scanned = scanf("%d", &choice);
+        if (scanned == EOF) {
+            handle_exit(&db, metrics_path, format);
+            return 0;
+        }
+        if (scanned != 1) {
+            // Discard the rest of the line so the next prompt starts clean
+            int c;
+            while ((c = getchar()) != EOF && c != '\n') {
+            }
             fprintf(stderr, "Invalid input\n");
             continue;
         }
@@ -63,11 +333,38 @@ int main() {
                 handle_list_suppliers(&db);
                 break;
             case 9:
-                handle_exit(&db);
+                handle_exit(&db, metrics_path, format);
                 return 0;
             case 10: // New case
                 handle_low_stock_products(&db);
                 break;
+            case 11:
+                handle_find_product(&db);
+                break;
+            case 12:
+                handle_find_supplier(&db);
+                break;
+            case 13:
+                handle_list_products_paged(&db);
+                break;
+            case 14:
+                handle_list_transactions_paged(&db);
+                break;
+            case 15:
+                handle_show_metrics(&db);
+                break;
+            case 16:
+                handle_search_products(&db);
+                break;
+            case 17:
+                handle_stock_as_of(&db);
+                break;
+            case 18:
+                handle_backup(&db);
+                break;
+            case 19:
+                handle_reorder_suggestions(&db);
+                break;
             default:
                 printf("Invalid choice. Please try again.\n");
         }
@@ -88,6 +385,15 @@ void display_menu() {
     printf("8. List Suppliers\n");
     printf("9. Exit\n");
     printf("10.List Low Stock Products\n");
+    printf("11.Find Product by ID\n");
+    printf("12.Find Supplier by ID\n");
+    printf("13.Browse Products (paged)\n");
+    printf("14.Browse Transactions (paged)\n");
+    printf("15.Performance Metrics\n");
+    printf("16.Search Products\n");
+    printf("17.Stock As Of Date\n");
+    printf("18.Online Backup\n");
+    printf("19.Reorder Suggestions\n");
 }
 
 void handle_add_product(Database *db) {
@@ -248,9 +554,218 @@ void handle_low_stock_products(Database *db) {
     handle_exit_to_main_menu();
 }
 
-void handle_exit(Database *db) {
-    // Close the database and exit the program
-    close_database(db);
+void handle_find_product(Database *db) {
+    int product_id;
+    Product product;
+
+    printf("Enter product ID: ");
+    scanf("%d", &product_id);
+
+    // Served from the in-memory catalog
+    if (get_product_by_id(db, product_id, &product) == 0) {
+        printf("ID: %d\nName: %s\nDescription: %s\nCategory: %s\n",
+               product.product_id, product.product_name, product.description, product.category);
+        printf("Cost: %.2f\nSelling: %.2f\nStock: %d\nReorder Level: %d\n",
+               product.cost_price, product.selling_price, product.stock_quantity, product.reorder_level);
+    } else {
+        printf("Product %d not found.\n", product_id);
+    }
+
+    handle_exit_to_main_menu();
+}
+
+void handle_find_supplier(Database *db) {
+    int supplier_id;
+    Supplier supplier;
+
+    printf("Enter supplier ID: ");
+    scanf("%d", &supplier_id);
+
+    if (get_supplier_by_id(db, supplier_id, &supplier) == 0) {
+        printf("ID: %d\nName: %s\nContact Info: %s\nAddress: %s\n",
+               supplier.supplier_id, supplier.supplier_name, supplier.contact_info, supplier.address);
+        free_supplier(&supplier);
+    } else {
+        printf("Supplier %d not found.\n", supplier_id);
+    }
+
+    handle_exit_to_main_menu();
+}
+
+void handle_list_products_paged(Database *db) {
+    int page_size;
+    int after_id = 0;
+
+    printf("Enter page size: ");
+    scanf("%d", &page_size);
+    if (page_size < 1) {
+        printf("Page size must be positive.\n");
+        handle_exit_to_main_menu();
+        return;
+    }
+
+    // Each page is a bounded keyset query resuming after the last id shown
+    do {
+        if (list_products_page(db, page_size, after_id, &after_id) != 0) {
+            printf("Failed to retrieve products.\n");
+            break;
+        }
+    } while (after_id != 0 && prompt_next_page());
+
+    handle_exit_to_main_menu();
+}
+
+void handle_list_transactions_paged(Database *db) {
+    char transaction_type[10];
+    int page_size;
+    int after_id = 0;
+
+    printf("Enter transaction type (IN/OUT): ");
+    scanf("%9s", transaction_type);
+    printf("Enter page size: ");
+    scanf("%d", &page_size);
+    if (page_size < 1) {
+        printf("Page size must be positive.\n");
+        handle_exit_to_main_menu();
+        return;
+    }
+
+    do {
+        if (list_transactions_page(db, transaction_type, page_size, after_id, &after_id) != 0) {
+            printf("Failed to list transactions.\n");
+            break;
+        }
+    } while (after_id != 0 && prompt_next_page());
+
+    handle_exit_to_main_menu();
+}
+
+int prompt_next_page(void) {
+    char answer[8];
+    printf("Show next page? (y/n): ");
+    if (scanf("%7s", answer) != 1) {
+        return 0;
+    }
+    return answer[0] == 'y' || answer[0] == 'Y';
+}
+
+void handle_show_metrics(Database *db) {
+    OutputSink sink;
+    char path[256];
+
+    fflush(stdout);
+    if (output_open(&sink, STDOUT_FILENO, OUTPUT_TABLE) == 0) {
+        write_metrics(db, &sink);
+        output_close(&sink);
+    }
+
+    // Optionally keep a copy for comparing runs
+    int c;
+    while ((c = getchar()) != EOF && c != '\n') {
+    }
+    printf("Save to file (blank to skip): ");
+    if (fgets(path, sizeof(path), stdin) && path[0] != '\n') {
+        path[strcspn(path, "\n")] = '\0';
+        if (save_metrics(db, path, OUTPUT_CSV) == 0) {
+            printf("Metrics saved to %s\n", path);
+        }
+    }
+}
+
+void handle_search_products(Database *db) {
+    char query[256], field_name[16];
+    SearchField field;
+    int limit;
+
+    printf("Search for: ");
+    scanf(" %255[^\n]", query);
+    printf("Search in (all/name/category/description): ");
+    scanf("%15s", field_name);
+    if (parse_search_field(field_name, &field) != 0) {
+        printf("Unknown field, searching all fields.\n");
+        field = SEARCH_ALL;
+    }
+    printf("Maximum results: ");
+    scanf("%d", &limit);
+
+    // Best matches first, straight from the full-text index
+    if (search_products(db, query, field, limit) != 0) {
+        printf("Failed to search products.\n");
+    }
+
+    handle_exit_to_main_menu();
+}
+
+void handle_stock_as_of(Database *db) {
+    int product_id, stock_quantity;
+    char as_of_date[20];
+
+    printf("Enter product ID (0 for all products): ");
+    scanf("%d", &product_id);
+    printf("Enter date (YYYY-MM-DD): ");
+    scanf("%19s", as_of_date);
+
+    if (product_id == 0) {
+        OutputSink sink;
+        fflush(stdout);
+        if (output_open(&sink, STDOUT_FILENO, OUTPUT_TABLE) == 0) {
+            int rows = write_stock_as_of(db, as_of_date, &sink);
+            if (output_close(&sink) != 0 || rows < 0) {
+                printf("Failed to compute stock levels.\n");
+            }
+        }
+    } else if (get_stock_as_of(db, product_id, as_of_date, &stock_quantity) == 0) {
+        printf("Stock of product %d at the end of %s: %d\n", product_id, as_of_date, stock_quantity);
+    } else {
+        printf("Failed to compute stock for product %d.\n", product_id);
+    }
+
+    handle_exit_to_main_menu();
+}
+
+void handle_backup(Database *db) {
+    char path[256];
+
+    printf("Enter backup file: ");
+    scanf(" %255[^\n]", path);
+
+    // The menu's own writes reach the copy without restarting it
+    if (run_backup_mode(db, path, 0) == 0) {
+        printf("Backup written to %s\n", path);
+    } else {
+        printf("Backup failed.\n");
+    }
+
+    handle_exit_to_main_menu();
+}
+
+void handle_reorder_suggestions(Database *db) {
+    ForecastOptions options;
+    double lead_time_days;
+
+    forecast_default_options(&options);
+    printf("Enter supplier lead time in days: ");
+    if (scanf("%lf", &lead_time_days) == 1 && lead_time_days > 0) {
+        options.lead_time_days = lead_time_days;
+    }
+
+    OutputSink sink;
+    fflush(stdout);
+    if (output_open(&sink, STDOUT_FILENO, OUTPUT_TABLE) == 0) {
+        int rows = write_demand_forecast(db, &options, &sink);
+        if (output_close(&sink) != 0 || rows < 0) {
+            printf("Failed to compute reorder suggestions.\n");
+        } else if (rows == 0) {
+            printf("Nothing needs reordering.\n");
+        }
+    }
+
+    handle_exit_to_main_menu();
+}
+
+void handle_exit(Database *db, const char *metrics_path, OutputFormat format) {
+    // Save metrics if asked, close the database and exit the program
+    finish_run(db, 0, metrics_path, format);
     printf("Exiting program.\n");
 }
 
@@ -258,4 +773,363 @@ void handle_exit_to_main_menu() {
     // Just print a message to let the user know they will return to the main menu
     printf("Returning to main menu...\n");
 }
-~  
+
+void print_low_stock_alert(const Product *product, int below, void *context) {
+    (void)context;
+    if (below) {
+        printf("Low stock alert: %s (ID %d) is at %d, reorder level %d\n",
+               product->product_name, product->product_id, product->stock_quantity, product->reorder_level);
+    } else {
+        printf("Stock restored: %s (ID %d) is back at %d\n",
+               product->product_name, product->product_id, product->stock_quantity);
+    }
+}
+
+void print_usage(const char *program) {
+    fprintf(stderr, "Usage: %s [--db FILE] [--profile NAME] [--no-negative-stock]\n"
+                    "       [--ingest FILE|- [--batch-size N]]\n"
+                    "       [--import-products FILE|-] [--import-suppliers FILE|-]\n"
+                    "       [--dump WHAT [--format FMT] [--output FILE] [--type T] [--from D] [--to D]]\n"
+                    "       [--by B [--threads N]] [--lead-time DAYS]\n"
+                    "       [--serve SOCKET [--workers N]] [--export-snapshot FILE]\n"
+                    "       [--metrics FILE] [--checkpoint] [--shards N [--split]]\n"
+                    "       [--backup FILE [--backup-step N]] [--export-new FILE|-]\n",
+            program);
+    fprintf(stderr, "  --db FILE             database file (default: inventory.db)\n");
+    fprintf(stderr, "  --profile NAME        connection profile: balanced, reporting or ingest\n");
+    fprintf(stderr, "  --no-negative-stock   reject OUT transactions larger than the stock on hand\n");
+    fprintf(stderr, "  --ingest FILE|-       load transaction rows from FILE or stdin and exit\n");
+    fprintf(stderr, "  --import-products FILE|-   upsert products from CSV (as written by --dump products)\n");
+    fprintf(stderr, "  --import-suppliers FILE|-  upsert suppliers from CSV (as written by --dump suppliers)\n");
+    fprintf(stderr, "  --batch-size N        rows per commit when ingesting (default: %d, 0 = per-row)\n",
+            DEFAULT_INGEST_BATCH_SIZE);
+    fprintf(stderr, "  --dump WHAT           write products, suppliers, transactions, sales, low-stock or report and exit\n");
+    fprintf(stderr, "                        (product-sales and category-sales read the --snapshot file)\n");
+    fprintf(stderr, "                        (report aggregates on parallel threads, see --by)\n");
+    fprintf(stderr, "                        (stock writes stock levels and their value as of --to)\n");
+    fprintf(stderr, "                        (forecast suggests reorders from the 56 days up to --to)\n");
+    fprintf(stderr, "  --format FMT          dump format: table, csv or jsonl (default: table)\n");
+    fprintf(stderr, "  --output FILE         dump destination (default: stdout)\n");
+    fprintf(stderr, "  --type T              transaction type for --dump transactions (default: OUT)\n");
+    fprintf(stderr, "  --from D, --to D      date range for --dump sales and report (default: everything)\n");
+    fprintf(stderr, "  --by B                breakdown for --dump report: product, category or supplier\n");
+    fprintf(stderr, "  --threads N           threads for --dump report and forecast (default: one per CPU)\n");
+    fprintf(stderr, "  --lead-time DAYS      supplier lead time for --dump forecast (default: 7)\n");
+    fprintf(stderr, "  --serve SOCKET        serve requests on a Unix socket until interrupted\n");
+    fprintf(stderr, "  --workers N           reader threads for --serve (default: one per CPU)\n");
+    fprintf(stderr, "  --export-snapshot FILE  write or refresh the columnar sales snapshot and exit\n");
+    fprintf(stderr, "  --metrics FILE        write operation and SQLite metrics to FILE on exit (in --format)\n");
+    fprintf(stderr, "  --checkpoint          checkpoint the stock of every product that moved since its last one\n");
+    fprintf(stderr, "  --snapshot FILE       snapshot used by --dump product-sales / category-sales\n");
+    fprintf(stderr, "  --backup FILE         copy the database to FILE while it stays in use\n");
+    fprintf(stderr, "  --backup-step N       pages copied per backup step (default: 256)\n");
+    fprintf(stderr, "  --export-new FILE|-   write the transactions added since the last --backup or export\n");
+    fprintf(stderr, "  --shards N            spread products over N files (FILE, FILE.1.db, ...) for --ingest\n");
+    fprintf(stderr, "                        and --dump products, suppliers, sales or low-stock\n");
+    fprintf(stderr, "  --split               move a single-file database's products into --shards N files\n");
+}
+
+// Write the metrics report to path; db may be NULL to skip connection statistics
+int save_metrics(Database *db, const char *path, OutputFormat format) {
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        perror(path);
+        return -1;
+    }
+
+    OutputSink sink;
+    int status = -1;
+    if (output_open(&sink, fd, format) == 0) {
+        write_metrics(db, &sink);
+        status = output_close(&sink);
+    }
+    if (close(fd) != 0) {
+        perror(path);
+        status = -1;
+    }
+    return status;
+}
+
+// Save metrics if asked, then close the database; returns status
+int finish_run(Database *db, int status, const char *metrics_path, OutputFormat format) {
+    if (metrics_path && save_metrics(db, metrics_path, format) != 0) {
+        status = -1;
+    }
+    close_database(db);
+    return status;
+}
+
+int run_ingest_mode(Database *db, const char *path, int batch_size) {
+    FILE *input = stdin;
+    if (strcmp(path, "-") != 0) {
+        input = fopen(path, "r");
+        if (!input) {
+            perror(path);
+            return -1;
+        }
+    }
+
+    BulkIngestStats stats;
+    int status = ingest_transactions(db, input, batch_size, &stats);
+
+    if (input != stdin) {
+        fclose(input);
+    }
+
+    print_bulk_stats(&stats, batch_size);
+    return status == 0 ? 0 : -1;
+}
+
+void print_backup_progress(int pages_done, int page_count, void *context) {
+    (void)context;
+    int percent = page_count > 0 ? (int)(100LL * pages_done / page_count) : 100;
+    fprintf(stderr, "\rBackup: %3d%% (%d of %d pages)", percent, pages_done, page_count);
+}
+
+// Back up the database, then start the incremental export from the copy's newest transaction
+int run_backup_mode(Database *db, const char *path, int pages_per_step) {
+    BackupOptions options;
+    BackupStats stats;
+
+    backup_default_options(&options);
+    if (pages_per_step > 0) {
+        options.pages_per_step = pages_per_step;
+    }
+    options.progress = print_backup_progress;
+
+    int status = backup_database(db, path, &options, &stats);
+    fprintf(stderr, "\n");
+    if (status != 0) {
+        return -1;
+    }
+    fprintf(stderr, "Backup of %d pages written to %s in %.3f s (%d steps, %d restarts)\n", stats.page_count,
+            path, stats.elapsed_seconds, stats.steps, stats.restarts);
+    return mark_transactions_exported(db, BACKUP_EXPORT_NAME, stats.last_transaction_id);
+}
+
+// Export new transactions; the position only moves once the file is complete
+// and renamed into place, so a failed export is repeated in full next time
+int run_export_new_mode(Database *db, const char *path, OutputFormat format) {
+    int to_stdout = strcmp(path, "-") == 0;
+    char temp_path[4096];
+    int fd = STDOUT_FILENO;
+
+    if (!to_stdout) {
+        if (snprintf(temp_path, sizeof(temp_path), "%s.tmp", path) >= (int)sizeof(temp_path)) {
+            fprintf(stderr, "Export file name too long: %s\n", path);
+            return -1;
+        }
+        fd = open(temp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            perror(temp_path);
+            return -1;
+        }
+    }
+
+    OutputSink sink;
+    sqlite3_int64 last_transaction_id = 0;
+    int rows = -1;
+    if (output_open(&sink, fd, format) == 0) {
+        rows = write_new_transactions(db, BACKUP_EXPORT_NAME, &sink, &last_transaction_id);
+        if (output_close(&sink) != 0) {
+            rows = -1;
+        }
+    }
+    if (!to_stdout) {
+        if (rows >= 0 && fsync(fd) != 0) {
+            perror(temp_path);
+            rows = -1;
+        }
+        if (close(fd) != 0) {
+            perror(temp_path);
+            rows = -1;
+        }
+        if (rows >= 0 && rename(temp_path, path) != 0) {
+            perror(path);
+            rows = -1;
+        }
+        if (rows < 0) {
+            unlink(temp_path);
+        }
+    }
+
+    if (rows < 0 || mark_transactions_exported(db, BACKUP_EXPORT_NAME, last_transaction_id) != 0) {
+        return -1;
+    }
+    fprintf(stderr, "%d transactions exported, up to transaction %lld\n", rows,
+            (long long)last_transaction_id);
+    return 0;
+}
+
+int run_import_mode(Database *db, const char *products_path, const char *suppliers_path, int batch_size) {
+    BulkIngestStats stats;
+    int status = 0;
+
+    // Suppliers first, so a single run can load both halves of a catalog
+    if (suppliers_path) {
+        status = import_suppliers_csv(db, suppliers_path, batch_size, &stats);
+        printf("Suppliers: ");
+        print_bulk_stats(&stats, batch_size);
+    }
+    if (status == 0 && products_path) {
+        status = import_products_csv(db, products_path, batch_size, &stats);
+        printf("Products: ");
+        print_bulk_stats(&stats, batch_size);
+    }
+    return status == 0 ? 0 : -1;
+}
+
+// Throughput report
+void print_bulk_stats(const BulkIngestStats *stats, int batch_size) {
+    double rate = stats->elapsed_seconds > 0 ? stats->rows_inserted / stats->elapsed_seconds : 0.0;
+    printf("Rows read: %ld, inserted: %ld, rejected: %ld, commits: %ld\n",
+           stats->rows_read, stats->rows_inserted, stats->rows_rejected, stats->batches_committed);
+    printf("Elapsed: %.3f s, throughput: %.0f rows/sec (%s)\n", stats->elapsed_seconds, rate,
+           batch_size < 1 ? "per-row" : "batched");
+}
+
+int run_dump_mode(Database *db, const char *what, OutputFormat format, const char *output_path,
+                  const char *transaction_type, const char *start_date, const char *end_date,
+                  const char *snapshot_path, ReportBreakdown breakdown, int thread_count,
+                  const ForecastOptions *forecast_options) {
+    // Snapshot reports never touch SQLite
+    Snapshot snapshot;
+    int use_snapshot = strcmp(what, "product-sales") == 0 || strcmp(what, "category-sales") == 0;
+    if (use_snapshot) {
+        if (!snapshot_path) {
+            fprintf(stderr, "--dump %s needs --snapshot FILE\n", what);
+            return -1;
+        }
+        if (snapshot_open(&snapshot, snapshot_path) != 0) {
+            return -1;
+        }
+    }
+
+    int fd = STDOUT_FILENO;
+    if (output_path) {
+        fd = open(output_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            perror(output_path);
+            if (use_snapshot) {
+                snapshot_close(&snapshot);
+            }
+            return -1;
+        }
+    }
+
+    OutputSink sink;
+    if (output_open(&sink, fd, format) != 0) {
+        if (fd != STDOUT_FILENO) {
+            close(fd);
+        }
+        if (use_snapshot) {
+            snapshot_close(&snapshot);
+        }
+        return -1;
+    }
+
+    int rows;
+    if (strcmp(what, "product-sales") == 0) {
+        rows = snapshot_write_product_sales(&snapshot, start_date, end_date, &sink);
+    } else if (strcmp(what, "category-sales") == 0) {
+        rows = snapshot_write_category_sales(&snapshot, start_date, end_date, &sink);
+    } else if (strcmp(what, "products") == 0) {
+        rows = write_products(db, &sink);
+    } else if (strcmp(what, "suppliers") == 0) {
+        rows = write_suppliers(db, &sink);
+    } else if (strcmp(what, "transactions") == 0) {
+        rows = write_transactions(db, transaction_type, &sink);
+    } else if (strcmp(what, "sales") == 0) {
+        rows = write_sales_report(db, start_date, end_date, &sink);
+    } else if (strcmp(what, "low-stock") == 0) {
+        rows = write_low_stock_products(db, &sink);
+    } else if (strcmp(what, "stock") == 0) {
+        rows = write_stock_as_of(db, end_date, &sink);
+    } else if (strcmp(what, "report") == 0) {
+        rows = write_parallel_report(db, breakdown, start_date, end_date, thread_count, &sink);
+    } else if (strcmp(what, "forecast") == 0) {
+        rows = write_demand_forecast(db, forecast_options, &sink);
+    } else {
+        fprintf(stderr, "Unknown dump target: %s\n", what);
+        rows = -1;
+    }
+
+    int status = output_close(&sink) == 0 && rows >= 0 ? 0 : -1;
+    if (use_snapshot) {
+        snapshot_close(&snapshot);
+    }
+    if (fd != STDOUT_FILENO && close(fd) != 0) {
+        perror(output_path);
+        status = -1;
+    }
+    if (status == 0) {
+        fprintf(stderr, "%d rows written\n", rows);
+    }
+    return status;
+}
+
+// Bulk ingest or dump against a sharded set
+int run_sharded_mode(ShardSet *set, const char *ingest_path, int batch_size, const char *dump_what,
+                     OutputFormat format, const char *output_path, const char *start_date,
+                     const char *end_date) {
+    if (ingest_path) {
+        FILE *input = stdin;
+        if (strcmp(ingest_path, "-") != 0) {
+            input = fopen(ingest_path, "r");
+            if (!input) {
+                perror(ingest_path);
+                return -1;
+            }
+        }
+
+        BulkIngestStats stats;
+        int status = shard_ingest_transactions(set, input, batch_size, &stats);
+        if (input != stdin) {
+            fclose(input);
+        }
+        printf("Shards: %d, ", set->shard_count);
+        print_bulk_stats(&stats, batch_size);
+        return status == 0 ? 0 : -1;
+    }
+
+    int fd = STDOUT_FILENO;
+    if (output_path) {
+        fd = open(output_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            perror(output_path);
+            return -1;
+        }
+    }
+
+    OutputSink sink;
+    if (output_open(&sink, fd, format) != 0) {
+        if (fd != STDOUT_FILENO) {
+            close(fd);
+        }
+        return -1;
+    }
+
+    int rows;
+    if (strcmp(dump_what, "products") == 0) {
+        rows = shard_write_products(set, &sink);
+    } else if (strcmp(dump_what, "suppliers") == 0) {
+        rows = write_suppliers(shard_for_suppliers(set), &sink);
+    } else if (strcmp(dump_what, "sales") == 0) {
+        rows = shard_write_sales_report(set, start_date, end_date, &sink);
+    } else if (strcmp(dump_what, "low-stock") == 0) {
+        rows = shard_write_low_stock_products(set, &sink);
+    } else {
+        fprintf(stderr, "Dump target not supported with --shards: %s\n", dump_what);
+        rows = -1;
+    }
+
+    int status = output_close(&sink) == 0 && rows >= 0 ? 0 : -1;
+    if (fd != STDOUT_FILENO && close(fd) != 0) {
+        perror(output_path);
+        status = -1;
+    }
+    if (status == 0) {
+        fprintf(stderr, "%d rows written\n", rows);
+    }
+    return status;
+}
@@ -0,0 +1,211 @@
+#include <string.h>
+#include <time.h>
+#include <stdatomic.h>
+#include "metrics.h"
+
+typedef struct {
+    _Atomic uint64_t calls;
+    _Atomic uint64_t errors;
+    _Atomic uint64_t rows;
+    _Atomic uint64_t total_ns;
+    _Atomic uint64_t max_ns;
+    _Atomic uint64_t buckets[METRICS_BUCKET_COUNT];
+} MetricCounters;
+
+static MetricCounters counters[METRIC_COUNT];
+
+static const char *metric_names[METRIC_COUNT] = {
+    [METRIC_INITIALIZE_DATABASE] = "initialize_database",
+    [METRIC_CONNECT_TO_DATABASE] = "connect_to_database",
+    [METRIC_CLOSE_DATABASE] = "close_database",
+    [METRIC_BEGIN_TRANSACTION] = "begin_transaction",
+    [METRIC_COMMIT_TRANSACTION] = "commit_transaction",
+    [METRIC_ROLLBACK_TRANSACTION] = "rollback_transaction",
+    [METRIC_REFRESH_CATALOG] = "refresh_catalog",
+    [METRIC_ADD_PRODUCT] = "add_product",
+    [METRIC_DELETE_PRODUCT] = "delete_product",
+    [METRIC_UPDATE_STOCK_QUANTITY] = "update_stock_quantity",
+    [METRIC_GET_PRODUCT_BY_ID] = "get_product_by_id",
+    [METRIC_LIST_ALL_PRODUCTS] = "list_all_products",
+    [METRIC_ADD_SUPPLIER] = "add_supplier",
+    [METRIC_GET_SUPPLIER_BY_ID] = "get_supplier_by_id",
+    [METRIC_LIST_ALL_SUPPLIERS] = "list_all_suppliers",
+    [METRIC_LIST_LOW_STOCK_PRODUCTS] = "list_low_stock_products",
+    [METRIC_ADD_TRANSACTION] = "add_transaction",
+    [METRIC_LIST_TRANSACTIONS] = "list_transactions",
+    [METRIC_INGEST_TRANSACTIONS] = "ingest_transactions",
+    [METRIC_GENERATE_SALES_REPORT] = "generate_sales_report",
+    [METRIC_VISIT_PRODUCTS] = "visit_products",
+    [METRIC_VISIT_SUPPLIERS] = "visit_suppliers",
+    [METRIC_VISIT_TRANSACTIONS] = "visit_transactions",
+    [METRIC_VISIT_SALES_REPORT] = "visit_sales_report",
+    [METRIC_VISIT_LOW_STOCK_PRODUCTS] = "visit_low_stock_products",
+    [METRIC_WRITE_PRODUCTS] = "write_products",
+    [METRIC_WRITE_SUPPLIERS] = "write_suppliers",
+    [METRIC_WRITE_TRANSACTIONS] = "write_transactions",
+    [METRIC_WRITE_SALES_REPORT] = "write_sales_report",
+    [METRIC_WRITE_LOW_STOCK_PRODUCTS] = "write_low_stock_products",
+    [METRIC_LIST_PRODUCTS_PAGE] = "list_products_page",
+    [METRIC_LIST_TRANSACTIONS_PAGE] = "list_transactions_page",
+    [METRIC_WRITE_PRODUCTS_PAGE] = "write_products_page",
+    [METRIC_WRITE_TRANSACTIONS_PAGE] = "write_transactions_page",
+    [METRIC_VISIT_PRODUCTS_PAGE] = "visit_products_page",
+    [METRIC_VISIT_TRANSACTIONS_PAGE] = "visit_transactions_page",
+    [METRIC_GET_PRODUCT_RECORD] = "get_product_record",
+    [METRIC_GET_SUPPLIER_RECORD] = "get_supplier_record",
+    [METRIC_GET_PRODUCTS_PAGE] = "get_products_page",
+    [METRIC_GET_TRANSACTIONS_PAGE] = "get_transactions_page",
+    [METRIC_GET_SALES_REPORT] = "get_sales_report",
+    [METRIC_GET_LOW_STOCK_PRODUCTS] = "get_low_stock_products",
+    [METRIC_SEARCH_PRODUCTS] = "search_products",
+    [METRIC_VISIT_PRODUCT_SEARCH] = "visit_product_search",
+    [METRIC_WRITE_PRODUCT_SEARCH] = "write_product_search",
+    [METRIC_CREATE_STOCK_CHECKPOINT] = "create_stock_checkpoint",
+    [METRIC_GET_STOCK_AS_OF] = "get_stock_as_of",
+    [METRIC_VISIT_STOCK_AS_OF] = "visit_stock_as_of",
+    [METRIC_WRITE_STOCK_AS_OF] = "write_stock_as_of",
+    [METRIC_ADD_PRODUCT_WITH_ID] = "add_product_with_id",
+    [METRIC_WRITE_NEW_TRANSACTIONS] = "write_new_transactions",
+    [METRIC_MARK_TRANSACTIONS_EXPORTED] = "mark_transactions_exported",
+};
+
+static const OutputColumn metric_columns[] = {
+    {"Function", "function", 26},
+    {"Calls", "calls", 10},
+    {"Errors", "errors", 8},
+    {"Rows", "rows", 12},
+    {"Mean us", "mean_us", 10},
+    {"p50 us", "p50_us", 10},
+    {"p90 us", "p90_us", 10},
+    {"p99 us", "p99_us", 10},
+    {"Max us", "max_us", 10},
+};
+#define METRIC_COLUMN_COUNT ((int)(sizeof(metric_columns) / sizeof(metric_columns[0])))
+
+const char *metric_name(MetricId id) {
+    return id >= 0 && id < METRIC_COUNT ? metric_names[id] : "unknown";
+}
+
+uint64_t metrics_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+double metrics_now_seconds(void) {
+    return metrics_now_ns() / 1e9;
+}
+
+static int bucket_index(uint64_t value) {
+    if (value < METRICS_SUB_BUCKETS) {
+        return (int)value;
+    }
+    int top_bit = 63 - __builtin_clzll(value);
+    if (top_bit >= METRICS_MAX_BITS) {
+        return METRICS_BUCKET_COUNT - 1;
+    }
+    int shift = top_bit - METRICS_SUB_BUCKET_BITS;
+    return (shift + 1) * METRICS_SUB_BUCKETS + (int)((value >> shift) & (METRICS_SUB_BUCKETS - 1));
+}
+
+// Largest value that maps to a bucket
+static uint64_t bucket_limit(int index) {
+    if (index < METRICS_SUB_BUCKETS) {
+        return (uint64_t)index;
+    }
+    int shift = index / METRICS_SUB_BUCKETS - 1;
+    uint64_t low = (uint64_t)(METRICS_SUB_BUCKETS + index % METRICS_SUB_BUCKETS) << shift;
+    return low + ((uint64_t)1 << shift) - 1;
+}
+
+void metrics_record(MetricId id, uint64_t elapsed_ns, int failed, uint64_t rows) {
+    MetricCounters *metric = &counters[id];
+
+    atomic_fetch_add_explicit(&metric->calls, 1, memory_order_relaxed);
+    if (failed) {
+        atomic_fetch_add_explicit(&metric->errors, 1, memory_order_relaxed);
+    }
+    if (rows) {
+        atomic_fetch_add_explicit(&metric->rows, rows, memory_order_relaxed);
+    }
+    atomic_fetch_add_explicit(&metric->total_ns, elapsed_ns, memory_order_relaxed);
+    atomic_fetch_add_explicit(&metric->buckets[bucket_index(elapsed_ns)], 1, memory_order_relaxed);
+
+    uint64_t max = atomic_load_explicit(&metric->max_ns, memory_order_relaxed);
+    while (elapsed_ns > max &&
+           !atomic_compare_exchange_weak_explicit(&metric->max_ns, &max, elapsed_ns,
+                                                  memory_order_relaxed, memory_order_relaxed)) {
+    }
+}
+
+void metrics_summarize(MetricId id, MetricSummary *summary) {
+    MetricCounters *metric = &counters[id];
+    uint64_t buckets[METRICS_BUCKET_COUNT];
+    uint64_t count = 0;
+
+    memset(summary, 0, sizeof(*summary));
+    summary->calls = atomic_load_explicit(&metric->calls, memory_order_relaxed);
+    summary->errors = atomic_load_explicit(&metric->errors, memory_order_relaxed);
+    summary->rows = atomic_load_explicit(&metric->rows, memory_order_relaxed);
+    summary->total_ns = atomic_load_explicit(&metric->total_ns, memory_order_relaxed);
+    summary->max_ns = atomic_load_explicit(&metric->max_ns, memory_order_relaxed);
+    for (int i = 0; i < METRICS_BUCKET_COUNT; i++) {
+        buckets[i] = atomic_load_explicit(&metric->buckets[i], memory_order_relaxed);
+        count += buckets[i];
+    }
+    if (count == 0) {
+        return;
+    }
+
+    // Walk the cumulative distribution once for all three percentiles
+    uint64_t *targets[] = {&summary->p50_ns, &summary->p90_ns, &summary->p99_ns};
+    const double quantiles[] = {0.50, 0.90, 0.99};
+    uint64_t seen = 0;
+    int next = 0;
+    for (int i = 0; i < METRICS_BUCKET_COUNT && next < 3; i++) {
+        seen += buckets[i];
+        while (next < 3 && seen >= (uint64_t)(quantiles[next] * count + 0.5) && seen > 0) {
+            uint64_t limit = bucket_limit(i);
+            *targets[next++] = limit < summary->max_ns ? limit : summary->max_ns;
+        }
+    }
+}
+
+void metrics_reset(void) {
+    for (int id = 0; id < METRIC_COUNT; id++) {
+        MetricCounters *metric = &counters[id];
+        atomic_store_explicit(&metric->calls, 0, memory_order_relaxed);
+        atomic_store_explicit(&metric->errors, 0, memory_order_relaxed);
+        atomic_store_explicit(&metric->rows, 0, memory_order_relaxed);
+        atomic_store_explicit(&metric->total_ns, 0, memory_order_relaxed);
+        atomic_store_explicit(&metric->max_ns, 0, memory_order_relaxed);
+        for (int i = 0; i < METRICS_BUCKET_COUNT; i++) {
+            atomic_store_explicit(&metric->buckets[i], 0, memory_order_relaxed);
+        }
+    }
+}
+
+int metrics_write(OutputSink *sink) {
+    int row_count = 0;
+
+    output_begin(sink, metric_columns, METRIC_COLUMN_COUNT);
+    for (int id = 0; id < METRIC_COUNT; id++) {
+        MetricSummary summary;
+        metrics_summarize((MetricId)id, &summary);
+        if (summary.calls == 0) {
+            continue;
+        }
+        row_count++;
+        output_text(sink, metric_names[id]);
+        output_int(sink, (long long)summary.calls);
+        output_int(sink, (long long)summary.errors);
+        output_int(sink, (long long)summary.rows);
+        output_decimal(sink, summary.total_ns / 1000.0 / summary.calls, 1);
+        output_decimal(sink, summary.p50_ns / 1000.0, 1);
+        output_decimal(sink, summary.p90_ns / 1000.0, 1);
+        output_decimal(sink, summary.p99_ns / 1000.0, 1);
+        output_decimal(sink, summary.max_ns / 1000.0, 1);
+        output_end_row(sink);
+    }
+    return row_count;
+}
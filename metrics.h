@@ -0,0 +1,111 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+#include "output.h"
+
+// Per-operation metrics
+// Every public database.h operation records its call count, failures
+// (a -1 return, which includes lookups of ids that do not exist), rows
+// touched (rows returned plus rows changed on the connection) and its
+// latency in an HDR-style histogram. Counters are process-wide atomics, so
+// threads with their own connections share one set. Latency is inclusive:
+// list_all_products also counts the write_products and visit_products it calls.
+
+typedef enum {
+    METRIC_INITIALIZE_DATABASE,
+    METRIC_CONNECT_TO_DATABASE,
+    METRIC_CLOSE_DATABASE,
+    METRIC_BEGIN_TRANSACTION,
+    METRIC_COMMIT_TRANSACTION,
+    METRIC_ROLLBACK_TRANSACTION,
+    METRIC_REFRESH_CATALOG,
+    METRIC_ADD_PRODUCT,
+    METRIC_DELETE_PRODUCT,
+    METRIC_UPDATE_STOCK_QUANTITY,
+    METRIC_GET_PRODUCT_BY_ID,
+    METRIC_LIST_ALL_PRODUCTS,
+    METRIC_ADD_SUPPLIER,
+    METRIC_GET_SUPPLIER_BY_ID,
+    METRIC_LIST_ALL_SUPPLIERS,
+    METRIC_LIST_LOW_STOCK_PRODUCTS,
+    METRIC_ADD_TRANSACTION,
+    METRIC_LIST_TRANSACTIONS,
+    METRIC_INGEST_TRANSACTIONS,
+    METRIC_GENERATE_SALES_REPORT,
+    METRIC_VISIT_PRODUCTS,
+    METRIC_VISIT_SUPPLIERS,
+    METRIC_VISIT_TRANSACTIONS,
+    METRIC_VISIT_SALES_REPORT,
+    METRIC_VISIT_LOW_STOCK_PRODUCTS,
+    METRIC_WRITE_PRODUCTS,
+    METRIC_WRITE_SUPPLIERS,
+    METRIC_WRITE_TRANSACTIONS,
+    METRIC_WRITE_SALES_REPORT,
+    METRIC_WRITE_LOW_STOCK_PRODUCTS,
+    METRIC_LIST_PRODUCTS_PAGE,
+    METRIC_LIST_TRANSACTIONS_PAGE,
+    METRIC_WRITE_PRODUCTS_PAGE,
+    METRIC_WRITE_TRANSACTIONS_PAGE,
+    METRIC_VISIT_PRODUCTS_PAGE,
+    METRIC_VISIT_TRANSACTIONS_PAGE,
+    METRIC_GET_PRODUCT_RECORD,
+    METRIC_GET_SUPPLIER_RECORD,
+    METRIC_GET_PRODUCTS_PAGE,
+    METRIC_GET_TRANSACTIONS_PAGE,
+    METRIC_GET_SALES_REPORT,
+    METRIC_GET_LOW_STOCK_PRODUCTS,
+    METRIC_SEARCH_PRODUCTS,
+    METRIC_VISIT_PRODUCT_SEARCH,
+    METRIC_WRITE_PRODUCT_SEARCH,
+    METRIC_CREATE_STOCK_CHECKPOINT,
+    METRIC_GET_STOCK_AS_OF,
+    METRIC_VISIT_STOCK_AS_OF,
+    METRIC_WRITE_STOCK_AS_OF,
+    METRIC_ADD_PRODUCT_WITH_ID,
+    METRIC_WRITE_NEW_TRANSACTIONS,
+    METRIC_MARK_TRANSACTIONS_EXPORTED,
+    METRIC_COUNT
+} MetricId;
+
+// Latency histogram layout: values below 16 ns get a bucket each, above that
+// every power of two is split into 16 linear sub-buckets (about 6% relative
+// error). Values of 2^44 ns (about 4.9 hours) and more land in the last bucket.
+#define METRICS_SUB_BUCKET_BITS 4
+#define METRICS_SUB_BUCKETS (1 << METRICS_SUB_BUCKET_BITS)
+#define METRICS_MAX_BITS 44
+#define METRICS_BUCKET_COUNT ((METRICS_MAX_BITS - METRICS_SUB_BUCKET_BITS + 1) * METRICS_SUB_BUCKETS)
+
+// A consistent-enough copy of one operation's counters (each field is read
+// atomically, the set is not)
+typedef struct {
+    uint64_t calls;
+    uint64_t errors;
+    uint64_t rows;
+    uint64_t total_ns;
+    uint64_t max_ns;
+    uint64_t p50_ns;
+    uint64_t p90_ns;
+    uint64_t p99_ns;
+} MetricSummary;
+
+const char *metric_name(MetricId id);
+
+// Monotonic clock in nanoseconds
+uint64_t metrics_now_ns(void);
+
+// The same clock in seconds, for the elapsed times of bulk runs
+double metrics_now_seconds(void);
+
+// Record one completed call; lock-free and safe from any thread
+void metrics_record(MetricId id, uint64_t elapsed_ns, int failed, uint64_t rows);
+
+void metrics_summarize(MetricId id, MetricSummary *summary);
+
+// Zero every counter (calls running concurrently may be partly lost)
+void metrics_reset(void);
+
+// Stream one row per operation that has been called; returns the row count
+int metrics_write(OutputSink *sink);
+
+#endif // METRICS_H
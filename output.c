@@ -0,0 +1,299 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include <errno.h>
+#include <unistd.h>
+#include "output.h"
+
+#define OUTPUT_BUFFER_SIZE (256 * 1024)
+
+static const long long powers_of_ten[] = {
+    1LL, 10LL, 100LL, 1000LL, 10000LL, 100000LL, 1000000LL
+};
+#define MAX_DECIMAL_PLACES ((int)(sizeof(powers_of_ten) / sizeof(powers_of_ten[0])) - 1)
+
+int parse_output_format(const char *name, OutputFormat *format) {
+    if (strcmp(name, "table") == 0) {
+        *format = OUTPUT_TABLE;
+    } else if (strcmp(name, "csv") == 0) {
+        *format = OUTPUT_CSV;
+    } else if (strcmp(name, "jsonl") == 0) {
+        *format = OUTPUT_JSONL;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+int output_open(OutputSink *sink, int fd, OutputFormat format) {
+    memset(sink, 0, sizeof(*sink));
+    sink->buffer = malloc(OUTPUT_BUFFER_SIZE);
+    if (!sink->buffer) {
+        fprintf(stderr, "Out of memory allocating output buffer\n");
+        return -1;
+    }
+    sink->fd = fd;
+    sink->format = format;
+    sink->capacity = OUTPUT_BUFFER_SIZE;
+    return 0;
+}
+
+int output_close(OutputSink *sink) {
+    output_flush(sink);
+    free(sink->buffer);
+    sink->buffer = NULL;
+    return sink->error ? -1 : 0;
+}
+
+void output_reset(OutputSink *sink, int fd, OutputFormat format) {
+    sink->fd = fd;
+    sink->format = format;
+    sink->length = 0;
+    sink->column = 0;
+    sink->error = 0;
+}
+
+int output_flush(OutputSink *sink) {
+    size_t written = 0;
+    while (written < sink->length && !sink->error) {
+        ssize_t n = write(sink->fd, sink->buffer + written, sink->length - written);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            fprintf(stderr, "Failed to write output: %s\n", strerror(errno));
+            sink->error = 1;
+            break;
+        }
+        written += (size_t)n;
+    }
+    sink->length = 0;
+    return sink->error ? -1 : 0;
+}
+
+// Append raw bytes, flushing whenever the buffer fills
+static void append(OutputSink *sink, const char *data, size_t size) {
+    while (size > 0) {
+        if (sink->length == sink->capacity) {
+            output_flush(sink);
+        }
+        size_t chunk = sink->capacity - sink->length;
+        if (chunk > size) {
+            chunk = size;
+        }
+        memcpy(sink->buffer + sink->length, data, chunk);
+        sink->length += chunk;
+        data += chunk;
+        size -= chunk;
+    }
+}
+
+static void append_char(OutputSink *sink, char c) {
+    if (sink->length == sink->capacity) {
+        output_flush(sink);
+    }
+    sink->buffer[sink->length++] = c;
+}
+
+static void append_padding(OutputSink *sink, int count) {
+    for (int i = 0; i < count; i++) {
+        append_char(sink, ' ');
+    }
+}
+
+// Format an unsigned value right to left; returns the number of digits
+static int format_digits(char *end, unsigned long long value) {
+    int count = 0;
+    do {
+        *--end = (char)('0' + value % 10);
+        value /= 10;
+        count++;
+    } while (value);
+    return count;
+}
+
+// Emit the separator (and JSON key) that precedes the next field
+static void begin_field(OutputSink *sink) {
+    const OutputColumn *column = &sink->columns[sink->column];
+
+    switch (sink->format) {
+        case OUTPUT_TABLE:
+            if (sink->column > 0) {
+                append_char(sink, ' ');
+            }
+            break;
+        case OUTPUT_CSV:
+            if (sink->column > 0) {
+                append_char(sink, ',');
+            }
+            break;
+        case OUTPUT_JSONL:
+            append_char(sink, sink->column > 0 ? ',' : '{');
+            append_char(sink, '"');
+            append(sink, column->key, strlen(column->key));
+            append(sink, "\":", 2);
+            break;
+    }
+}
+
+// Pad a table field to its column width
+static void end_field(OutputSink *sink, size_t field_length) {
+    if (sink->format == OUTPUT_TABLE && sink->column < sink->column_count - 1) {
+        int width = sink->columns[sink->column].width;
+        if ((int)field_length < width) {
+            append_padding(sink, width - (int)field_length);
+        }
+    }
+    sink->column++;
+}
+
+void output_begin(OutputSink *sink, const OutputColumn *columns, int column_count) {
+    sink->columns = columns;
+    sink->column_count = column_count;
+    sink->column = 0;
+
+    if (sink->format == OUTPUT_JSONL) {
+        return;
+    }
+    for (int i = 0; i < column_count; i++) {
+        const char *label = sink->format == OUTPUT_TABLE ? columns[i].title : columns[i].key;
+        begin_field(sink);
+        append(sink, label, strlen(label));
+        end_field(sink, strlen(label));
+    }
+    append_char(sink, '\n');
+    sink->column = 0;
+}
+
+void output_text(OutputSink *sink, const char *value) {
+    begin_field(sink);
+
+    size_t length = value ? strlen(value) : 0;
+    switch (sink->format) {
+        case OUTPUT_TABLE:
+            append(sink, value, length);
+            break;
+        case OUTPUT_CSV:
+            if (value && strpbrk(value, ",\"\r\n")) {
+                append_char(sink, '"');
+                for (const char *p = value; *p; p++) {
+                    if (*p == '"') {
+                        append_char(sink, '"');
+                    }
+                    append_char(sink, *p);
+                }
+                append_char(sink, '"');
+            } else {
+                append(sink, value, length);
+            }
+            break;
+        case OUTPUT_JSONL:
+            if (!value) {
+                append(sink, "null", 4);
+                break;
+            }
+            append_char(sink, '"');
+            for (const unsigned char *p = (const unsigned char *)value; *p; p++) {
+                switch (*p) {
+                    case '"':  append(sink, "\\\"", 2); break;
+                    case '\\': append(sink, "\\\\", 2); break;
+                    case '\n': append(sink, "\\n", 2); break;
+                    case '\r': append(sink, "\\r", 2); break;
+                    case '\t': append(sink, "\\t", 2); break;
+                    default:
+                        if (*p < 0x20) {
+                            char escape[7];
+                            snprintf(escape, sizeof(escape), "\\u%04x", *p);
+                            append(sink, escape, 6);
+                        } else {
+                            append_char(sink, (char)*p);
+                        }
+                }
+            }
+            append_char(sink, '"');
+            break;
+    }
+
+    end_field(sink, length);
+}
+
+void output_int(OutputSink *sink, long long value) {
+    char digits[24];
+    char *end = digits + sizeof(digits);
+    unsigned long long magnitude = value < 0 ? 0ULL - (unsigned long long)value : (unsigned long long)value;
+    int count = format_digits(end, magnitude);
+    if (value < 0) {
+        end[-++count] = '-';
+    }
+
+    begin_field(sink);
+    append(sink, end - count, (size_t)count);
+    end_field(sink, (size_t)count);
+}
+
+void output_decimal(OutputSink *sink, double value, int places) {
+    // Room for the integer digits of DBL_MAX, a sign, the point and the places
+    char digits[DBL_MAX_10_EXP + 32];
+    int count;
+
+    if (!isfinite(value)) {
+        // No number to write: empty like a missing text field, null in JSON
+        output_text(sink, NULL);
+        return;
+    }
+    if (places > MAX_DECIMAL_PLACES) {
+        places = MAX_DECIMAL_PLACES;
+    }
+    double scaled = value * powers_of_ten[places];
+
+    if (!isfinite(scaled) || fabs(scaled) >= 9e18) {
+        // Out of integer range: let the C library handle it
+        count = snprintf(digits, sizeof(digits), "%.*f", places, value);
+        begin_field(sink);
+        append(sink, digits, (size_t)count);
+        end_field(sink, (size_t)count);
+        return;
+    }
+
+    long long rounded = llround(scaled);
+    unsigned long long magnitude = rounded < 0 ? 0ULL - (unsigned long long)rounded : (unsigned long long)rounded;
+    unsigned long long whole = magnitude / (unsigned long long)powers_of_ten[places];
+    unsigned long long fraction = magnitude % (unsigned long long)powers_of_ten[places];
+    char *end = digits + sizeof(digits);
+
+    count = 0;
+    if (places > 0) {
+        for (int i = 0; i < places; i++) {
+            *--end = (char)('0' + fraction % 10);
+            fraction /= 10;
+        }
+        *--end = '.';
+        count = places + 1;
+    }
+    int whole_digits = format_digits(end, whole);
+    end -= whole_digits;
+    count += whole_digits;
+    if (rounded < 0) {
+        *--end = '-';
+        count++;
+    }
+
+    begin_field(sink);
+    append(sink, end, (size_t)count);
+    end_field(sink, (size_t)count);
+}
+
+void output_end_row(OutputSink *sink) {
+    if (sink->format == OUTPUT_JSONL) {
+        append_char(sink, '}');
+    }
+    append_char(sink, '\n');
+    sink->column = 0;
+}
+
+void output_line(OutputSink *sink, const char *text) {
+    append(sink, text, strlen(text));
+    append_char(sink, '\n');
+}
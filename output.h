@@ -0,0 +1,65 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <stddef.h>
+
+// Output formats understood by the sink
+typedef enum {
+    OUTPUT_TABLE,   // space-padded columns with a header line
+    OUTPUT_CSV,     // RFC 4180 quoting, header line of column keys
+    OUTPUT_JSONL    // one JSON object per line
+} OutputFormat;
+
+// Column description for a row stream
+typedef struct {
+    const char *title;  // table header
+    const char *key;    // CSV header and JSON field name
+    int width;          // minimum table column width
+} OutputColumn;
+
+// Buffered row writer for a file descriptor
+// Rows are formatted into one reusable buffer that is written out with
+// write(2) whenever it fills up, so no stdio formatting happens per row.
+typedef struct {
+    int fd;
+    OutputFormat format;
+    char *buffer;
+    size_t length;
+    size_t capacity;
+    const OutputColumn *columns;
+    int column_count;
+    int column;  // index of the next field in the current row
+    int error;
+} OutputSink;
+
+// Parse a format name ("table", "csv", "jsonl"); returns 0 on success
+int parse_output_format(const char *name, OutputFormat *format);
+
+// Open a sink on fd with its own buffer
+int output_open(OutputSink *sink, int fd, OutputFormat format);
+
+// Flush pending output and release the buffer; returns -1 if any write failed
+int output_close(OutputSink *sink);
+
+// Write buffered bytes to the file descriptor
+int output_flush(OutputSink *sink);
+
+// Point the sink at another file descriptor, dropping unwritten bytes and any
+// earlier write error, so one buffer can serve many connections in turn
+void output_reset(OutputSink *sink, int fd, OutputFormat format);
+
+// Start a row stream with the given columns (writes the header for table and CSV)
+void output_begin(OutputSink *sink, const OutputColumn *columns, int column_count);
+
+// Append fields to the current row, in column order
+void output_text(OutputSink *sink, const char *value);  // NULL is written as empty / null
+void output_int(OutputSink *sink, long long value);
+void output_decimal(OutputSink *sink, double value, int places);  // NaN and infinity as NULL text
+
+// Finish the current row
+void output_end_row(OutputSink *sink);
+
+// Append a line of raw text outside any row stream (status lines, titles)
+void output_line(OutputSink *sink, const char *text);
+
+#endif // OUTPUT_H
@@ -0,0 +1,425 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include "report.h"
+
+#define CHUNKS_PER_THREAD 4
+#define SUM_MAP_INITIAL_SLOTS 1024
+
+static const OutputColumn product_report_columns[] = {
+    {"ID", "product_id", 6},
+    {"Product", "product_name", 20},
+    {"Category", "category", 15},
+    {"Total Sold", "total_sold", 12},
+    {"Total Sales", "total_sales", 14},
+};
+
+static const OutputColumn category_report_columns[] = {
+    {"Category", "category", 20},
+    {"Total Sold", "total_sold", 12},
+    {"Total Sales", "total_sales", 14},
+};
+
+static const OutputColumn supplier_report_columns[] = {
+    {"ID", "supplier_id", 6},
+    {"Supplier", "supplier_name", 20},
+    {"Units Received", "units_received", 15},
+    {"Purchase Cost", "purchase_cost", 14},
+};
+
+// Per-chunk queries; ?1 and ?2 bound the chunk's [from, to) span in unix seconds
+static const char *sales_chunk_sql =
+    "SELECT product_id, quantity, 0.0 FROM Transactions "
+    "WHERE transaction_type = 2 AND transaction_date >= ?1 AND transaction_date < ?2;";
+static const char *purchases_chunk_sql =
+    "SELECT t.customer_supplier_id, t.quantity, t.quantity * p.cost_price "
+    "FROM Transactions t JOIN Products p ON p.product_id = t.product_id "
+    "WHERE t.transaction_type = 1 AND t.transaction_date >= ?1 AND t.transaction_date < ?2;";
+
+int parse_report_breakdown(const char *name, ReportBreakdown *breakdown) {
+    if (strcmp(name, "product") == 0) {
+        *breakdown = BREAKDOWN_PRODUCT;
+    } else if (strcmp(name, "category") == 0) {
+        *breakdown = BREAKDOWN_CATEGORY;
+    } else if (strcmp(name, "supplier") == 0) {
+        *breakdown = BREAKDOWN_SUPPLIER;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+// Thread-local aggregation: open addressing over integer keys, linear probing
+
+typedef struct {
+    int key;
+    int used;
+    long long units;
+    double amount;
+} SumEntry;
+
+typedef struct {
+    SumEntry *entries;
+    int slot_count;  // power of two
+    int count;
+} SumMap;
+
+static int sum_map_init(SumMap *map, int slot_count) {
+    map->entries = calloc(slot_count, sizeof(SumEntry));
+    map->slot_count = slot_count;
+    map->count = 0;
+    return map->entries ? 0 : -1;
+}
+
+static SumEntry *sum_map_slot(SumMap *map, int key) {
+    int mask = map->slot_count - 1;
+    int slot = (int)(((unsigned int)key * 2654435769u) & (unsigned int)mask);
+    while (map->entries[slot].used && map->entries[slot].key != key) {
+        slot = (slot + 1) & mask;
+    }
+    return &map->entries[slot];
+}
+
+static int sum_map_add(SumMap *map, int key, long long units, double amount) {
+    // Keep the load factor at or below one half
+    if ((map->count + 1) * 2 > map->slot_count) {
+        SumMap grown;
+        if (sum_map_init(&grown, map->slot_count * 2) != 0) {
+            return -1;
+        }
+        for (int i = 0; i < map->slot_count; i++) {
+            if (map->entries[i].used) {
+                *sum_map_slot(&grown, map->entries[i].key) = map->entries[i];
+                grown.count++;
+            }
+        }
+        free(map->entries);
+        *map = grown;
+    }
+
+    SumEntry *entry = sum_map_slot(map, key);
+    if (!entry->used) {
+        entry->used = 1;
+        entry->key = key;
+        map->count++;
+    }
+    entry->units += units;
+    entry->amount += amount;
+    return 0;
+}
+
+// Work shared by the workers
+
+typedef struct {
+    Database *db;
+    ReportBreakdown breakdown;
+    long long first;       // earliest matching transaction_date
+    long long span;        // seconds covered, last one included
+    int chunk_count;
+    atomic_int next_chunk;
+} ReportJob;
+
+typedef struct {
+    ReportJob *job;
+    SumMap sums;
+    int status;
+} ReportWorker;
+
+static int aggregate_chunk(sqlite3 *connection, sqlite3_stmt *stmt, const ReportJob *job, int chunk,
+                           SumMap *sums) {
+    long long from = job->first + job->span * chunk / job->chunk_count;
+    long long to = job->first + job->span * (chunk + 1) / job->chunk_count;
+    int rc;
+
+    sqlite3_bind_int64(stmt, 1, from);
+    sqlite3_bind_int64(stmt, 2, to);
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        if (sum_map_add(sums, sqlite3_column_int(stmt, 0), sqlite3_column_int64(stmt, 1),
+                        sqlite3_column_double(stmt, 2)) != 0) {
+            fprintf(stderr, "Out of memory aggregating report\n");
+            sqlite3_reset(stmt);
+            return -1;
+        }
+    }
+    sqlite3_reset(stmt);
+    if (rc != SQLITE_DONE) {
+        fprintf(stderr, "Failed to aggregate report chunk: %s\n", sqlite3_errmsg(connection));
+        return -1;
+    }
+    return 0;
+}
+
+static void *report_worker_main(void *arg) {
+    ReportWorker *worker = arg;
+    ReportJob *job = worker->job;
+    DatabaseConfig config = job->db->config;
+    Database db;
+    sqlite3_stmt *stmt = NULL;
+
+    worker->status = -1;
+    config.read_only = 1;
+    if (initialize_database(&db, job->db->db_name, &config) != 0) {
+        return NULL;
+    }
+    const char *sql = job->breakdown == BREAKDOWN_SUPPLIER ? purchases_chunk_sql : sales_chunk_sql;
+    if (sqlite3_prepare_v2(db.connection, sql, -1, &stmt, NULL) != SQLITE_OK) {
+        fprintf(stderr, "Failed to prepare report query: %s\n", sqlite3_errmsg(db.connection));
+        close_database(&db);
+        return NULL;
+    }
+
+    worker->status = 0;
+    int chunk;
+    while (worker->status == 0 && (chunk = atomic_fetch_add(&job->next_chunk, 1)) < job->chunk_count) {
+        worker->status = aggregate_chunk(db.connection, stmt, job, chunk, &worker->sums);
+    }
+
+    sqlite3_finalize(stmt);
+    close_database(&db);
+    return NULL;
+}
+
+// Find the date span of matching rows so chunks cover only real data
+static int find_date_span(Database *db, ReportBreakdown breakdown, const char *start_date,
+                          const char *end_date, long long *first, long long *last) {
+    sqlite3_stmt *stmt;
+    int type = breakdown == BREAKDOWN_SUPPLIER ? TRANSACTION_IN : TRANSACTION_OUT;
+    int status = -1;
+
+    if (sqlite3_prepare_v2(db->connection,
+                           "SELECT "
+                           "(SELECT min(transaction_date) FROM Transactions WHERE transaction_type = ?1 "
+                           "AND transaction_date BETWEEN unixepoch(?2) AND unixepoch(?3)), "
+                           "(SELECT max(transaction_date) FROM Transactions WHERE transaction_type = ?1 "
+                           "AND transaction_date BETWEEN unixepoch(?2) AND unixepoch(?3));",
+                           -1, &stmt, NULL) != SQLITE_OK) {
+        fprintf(stderr, "Failed to prepare report query: %s\n", sqlite3_errmsg(db->connection));
+        return -1;
+    }
+    sqlite3_bind_int(stmt, 1, type);
+    sqlite3_bind_text(stmt, 2, start_date, -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 3, end_date, -1, SQLITE_STATIC);
+
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        status = 1;  // no matching rows
+        if (sqlite3_column_type(stmt, 0) == SQLITE_INTEGER) {
+            *first = sqlite3_column_int64(stmt, 0);
+            *last = sqlite3_column_int64(stmt, 1);
+            status = 0;
+        }
+    } else {
+        fprintf(stderr, "Failed to execute statement: %s\n", sqlite3_errmsg(db->connection));
+    }
+    sqlite3_finalize(stmt);
+    return status;
+}
+
+// Merged output rows
+
+typedef struct {
+    int key;
+    const char *label;  // category name for BREAKDOWN_CATEGORY
+    long long units;
+    double amount;
+} ReportRow;
+
+static int compare_report_rows(const void *a, const void *b) {
+    const ReportRow *ra = a, *rb = b;
+    if (ra->amount != rb->amount) {
+        return ra->amount > rb->amount ? -1 : 1;
+    }
+    if (ra->units != rb->units) {
+        return ra->units > rb->units ? -1 : 1;
+    }
+    if (ra->label && rb->label) {
+        return strcmp(ra->label, rb->label);
+    }
+    return (ra->key > rb->key) - (ra->key < rb->key);
+}
+
+static int compare_labels(const void *a, const void *b) {
+    return strcmp(((const ReportRow *)a)->label, ((const ReportRow *)b)->label);
+}
+
+// Fill in sales values from current selling prices and drop products deleted
+// since, then fold by category if asked
+static int price_sales_rows(Database *db, ReportBreakdown breakdown, Arena *arena, ReportRow *rows,
+                            int *row_count) {
+    int count = 0;
+
+    for (int i = 0; i < *row_count; i++) {
+        Product product;
+        if (get_product_by_id(db, rows[i].key, &product) != 0) {
+            continue;
+        }
+        rows[count] = rows[i];
+        rows[count].amount = rows[i].units * product.selling_price;
+        rows[count].label = NULL;
+        if (breakdown == BREAKDOWN_CATEGORY) {
+            rows[count].label = arena_strdup(arena, product.category ? product.category : "");
+            if (!rows[count].label) {
+                *row_count = count;
+                return -1;
+            }
+        }
+        count++;
+    }
+    *row_count = count;
+    if (breakdown != BREAKDOWN_CATEGORY) {
+        return 0;
+    }
+
+    qsort(rows, count, sizeof(ReportRow), compare_labels);
+    int folded = 0;
+    for (int i = 0; i < count; i++) {
+        if (folded > 0 && strcmp(rows[folded - 1].label, rows[i].label) == 0) {
+            rows[folded - 1].units += rows[i].units;
+            rows[folded - 1].amount += rows[i].amount;
+        } else {
+            rows[folded++] = rows[i];
+        }
+    }
+    *row_count = folded;
+    return 0;
+}
+
+static void write_report_rows(Database *db, ReportBreakdown breakdown, const ReportRow *rows, int count,
+                              OutputSink *sink) {
+    switch (breakdown) {
+        case BREAKDOWN_PRODUCT:
+            output_begin(sink, product_report_columns, 5);
+            for (int i = 0; i < count; i++) {
+                Product product;
+                int found = get_product_by_id(db, rows[i].key, &product) == 0;
+                output_int(sink, rows[i].key);
+                output_text(sink, found ? product.product_name : NULL);
+                output_text(sink, found ? product.category : NULL);
+                output_int(sink, rows[i].units);
+                output_decimal(sink, rows[i].amount, 2);
+                output_end_row(sink);
+            }
+            break;
+        case BREAKDOWN_CATEGORY:
+            output_begin(sink, category_report_columns, 3);
+            for (int i = 0; i < count; i++) {
+                output_text(sink, rows[i].label);
+                output_int(sink, rows[i].units);
+                output_decimal(sink, rows[i].amount, 2);
+                output_end_row(sink);
+            }
+            break;
+        case BREAKDOWN_SUPPLIER:
+            output_begin(sink, supplier_report_columns, 4);
+            for (int i = 0; i < count; i++) {
+                Supplier supplier;
+                int found = get_supplier_by_id(db, rows[i].key, &supplier) == 0;
+                output_int(sink, rows[i].key);
+                output_text(sink, found ? supplier.supplier_name : NULL);
+                output_int(sink, rows[i].units);
+                output_decimal(sink, rows[i].amount, 2);
+                output_end_row(sink);
+                if (found) {
+                    free_supplier(&supplier);
+                }
+            }
+            break;
+    }
+}
+
+int write_parallel_report(Database *db, ReportBreakdown breakdown, const char *start_date,
+                          const char *end_date, int thread_count, OutputSink *sink) {
+    long long first = 0, last = 0;
+    int span_status = find_date_span(db, breakdown, start_date, end_date, &first, &last);
+    if (span_status < 0) {
+        return -1;
+    }
+
+    if (thread_count < 1) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        thread_count = cpus > 0 ? (int)cpus : 1;
+    }
+    ReportJob job = {
+        .db = db,
+        .breakdown = breakdown,
+        .first = first,
+        .span = last - first + 1,
+        .chunk_count = span_status == 0 ? thread_count * CHUNKS_PER_THREAD : 0,
+    };
+    atomic_init(&job.next_chunk, 0);
+
+    ReportWorker *workers = calloc(thread_count, sizeof(ReportWorker));
+    pthread_t *threads = calloc(thread_count, sizeof(pthread_t));
+    SumMap merged;
+    if (!workers || !threads || sum_map_init(&merged, SUM_MAP_INITIAL_SLOTS) != 0) {
+        fprintf(stderr, "Out of memory starting report\n");
+        free(workers);
+        free(threads);
+        return -1;
+    }
+
+    int started = 0;
+    int status = 0;
+    if (job.chunk_count > 0) {
+        for (; started < thread_count; started++) {
+            workers[started].job = &job;
+            if (sum_map_init(&workers[started].sums, SUM_MAP_INITIAL_SLOTS) != 0 ||
+                pthread_create(&threads[started], NULL, report_worker_main, &workers[started]) != 0) {
+                free(workers[started].sums.entries);
+                status = -1;
+                break;
+            }
+        }
+    }
+
+    // Merge the thread-local maps
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+        if (workers[i].status != 0) {
+            status = -1;
+        }
+        for (int j = 0; status == 0 && j < workers[i].sums.slot_count; j++) {
+            const SumEntry *entry = &workers[i].sums.entries[j];
+            if (entry->used && sum_map_add(&merged, entry->key, entry->units, entry->amount) != 0) {
+                status = -1;
+            }
+        }
+        free(workers[i].sums.entries);
+    }
+    free(workers);
+    free(threads);
+
+    // Result rows and category labels live until the report is written
+    Arena arena;
+    arena_init(&arena, 0);
+    ReportRow *rows = NULL;
+    int row_count = 0;
+    if (status == 0) {
+        rows = arena_alloc(&arena, sizeof(ReportRow) * merged.count);
+        if (!rows) {
+            status = -1;
+        }
+    }
+    for (int j = 0; status == 0 && j < merged.slot_count; j++) {
+        const SumEntry *entry = &merged.entries[j];
+        if (entry->used) {
+            rows[row_count++] = (ReportRow){.key = entry->key, .units = entry->units, .amount = entry->amount};
+        }
+    }
+    free(merged.entries);
+
+    if (status == 0 && breakdown != BREAKDOWN_SUPPLIER &&
+        price_sales_rows(db, breakdown, &arena, rows, &row_count) != 0) {
+        fprintf(stderr, "Out of memory pricing report\n");
+        status = -1;
+    }
+    if (status == 0) {
+        qsort(rows, row_count, sizeof(ReportRow), compare_report_rows);
+        write_report_rows(db, breakdown, rows, row_count, sink);
+    }
+
+    arena_free(&arena);
+    return status == 0 ? row_count : -1;
+}
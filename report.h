@@ -0,0 +1,30 @@
+#ifndef REPORT_H
+#define REPORT_H
+
+#include "database.h"
+
+// Parallel partitioned reports
+// The matching transactions' date span is cut into chunks that worker
+// threads claim one at a time. Each worker has its own read-only connection
+// and aggregates into a private hash map; the maps are merged once every
+// chunk is done, and the merged totals are joined with product and supplier
+// attributes through the calling handle. Workers each read in their own
+// transaction, so a report that runs alongside writers may see a different
+// state in different chunks.
+
+typedef enum {
+    BREAKDOWN_PRODUCT,   // OUT units and sales value per product
+    BREAKDOWN_CATEGORY,  // OUT units and sales value per product category
+    BREAKDOWN_SUPPLIER   // IN units and purchase cost per supplier (customer_supplier_id)
+} ReportBreakdown;
+
+// Parse "product", "category" or "supplier"; returns 0 on success
+int parse_report_breakdown(const char *name, ReportBreakdown *breakdown);
+
+// Aggregate transactions dated start_date .. end_date on thread_count threads
+// (0 = one per online CPU) and stream the breakdown to sink, largest value
+// first; returns the number of rows written or -1
+int write_parallel_report(Database *db, ReportBreakdown breakdown, const char *start_date,
+                          const char *end_date, int thread_count, OutputSink *sink);
+
+#endif // REPORT_H
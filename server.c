@@ -0,0 +1,832 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <poll.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "server.h"
+#include "commit_queue.h"
+#include "csv_import.h"
+
+#define SESSION_BUFFER_SIZE (64 * 1024)
+#define MAX_FIELDS 10
+#define POLL_INTERVAL_MS 500
+#define MAX_CLIENTS 1024
+
+// Write operations accepted by the writer thread
+typedef enum {
+    WRITE_ADD_PRODUCT,
+    WRITE_DELETE_PRODUCT,
+    WRITE_UPDATE_STOCK,
+    WRITE_ADD_SUPPLIER,
+    WRITE_ADD_TRANSACTION
+} WriteKind;
+
+// A queued write; fields point into the requesting session's buffer, which
+// stays untouched while the session waits for the result. Numeric fields are
+// parsed before the write is queued, in field order.
+typedef struct {
+    WriteKind kind;
+    char **fields;
+    int integers[3];
+    double reals[2];
+} WriteRequest;
+
+// Products below their reorder level as the writer's catalog last had them.
+// The committer publishes a new list after every group; workers hold a
+// reference while they write one out.
+typedef struct {
+    int references;  // guarded by Server.low_stock_lock
+    int count;
+    Product *products;
+    Arena arena;     // products and their names
+} LowStockList;
+
+// A client connection. Between requests it belongs to the polling thread;
+// once it has input it is queued for the workers, and the worker that reads
+// it hands it back when done.
+typedef struct Client {
+    int fd;
+    OutputFormat format;
+    char *buffer;  // input not yet handled, at most one partial line between reads
+    size_t used;
+    int closed;    // set by the worker when the client hung up or failed
+    struct Client *next;
+} Client;
+
+typedef struct {
+    const char *db_name;
+    ServerOptions options;
+
+    // Clients with input waiting for a worker, and clients workers have
+    // handed back to the polling thread
+    pthread_mutex_t client_lock;
+    pthread_cond_t client_ready;
+    Client *ready_head;
+    Client *ready_tail;
+    Client *returned;
+    int stopping;
+    int wake_pipe[2];
+
+    // Workers that have tried to open their connection, and those that did;
+    // run_server waits on workers_changed until every started worker reported
+    pthread_cond_t workers_changed;
+    int workers_reported;
+    int workers_ready;  // a worker writes a byte here after handing a client back
+
+    // Group commit of every write on the single writer connection
+    CommitQueue writes;
+
+    // Latest low-stock list from the writer; NULL when it could not be built
+    pthread_mutex_t low_stock_lock;
+    LowStockList *low_stock;
+} Server;
+
+// Per-worker state; client is the connection whose requests are being served
+typedef struct {
+    Server *server;
+    Database *db;
+    Client *client;
+    OutputSink sink;
+    Arena arena;  // records built for the current request
+} Session;
+
+static volatile sig_atomic_t server_running = 1;
+
+static void handle_shutdown_signal(int signal_number) {
+    (void)signal_number;
+    server_running = 0;
+}
+
+void server_default_options(ServerOptions *options) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    options->worker_count = cpus > 0 ? (int)cpus : 4;
+    options->max_batch = 512;
+    options->flush_interval_ms = 2;
+    database_config_for_profile(&options->config, PROFILE_BALANCED);
+}
+
+// Writes, applied on the commit queue's connection
+
+static int execute_write(Database *db, void *arg) {
+    const WriteRequest *request = arg;
+    char **f = request->fields;
+    const int *n = request->integers;
+    const double *r = request->reals;
+
+    switch (request->kind) {
+        case WRITE_ADD_PRODUCT:
+            return add_product(db, f[1], f[2], f[3], r[0], r[1], n[0], n[1]);
+        case WRITE_DELETE_PRODUCT:
+            return delete_product(db, n[0]);
+        case WRITE_UPDATE_STOCK:
+            return update_stock_quantity(db, n[0], n[1]);
+        case WRITE_ADD_SUPPLIER:
+            return add_supplier(db, f[1], f[2], f[3]);
+        case WRITE_ADD_TRANSACTION:
+            return add_transaction(db, n[0], f[2], n[1], f[4], n[2]);
+    }
+    return -1;
+}
+
+// Parse an int field no smaller than min; returns 0 or -1
+static int parse_int_field(const char *text, int min, int *value) {
+    long long number;
+    if (parse_strict_integer(text, strlen(text), &number) != 0 || number < min || number > INT_MAX) {
+        return -1;
+    }
+    *value = (int)number;
+    return 0;
+}
+
+// Parse a non-negative decimal field; returns 0 or -1
+static int parse_price_field(const char *text, double *value) {
+    return parse_strict_real(text, strlen(text), value) == 0 && *value >= 0 ? 0 : -1;
+}
+
+// Parse the numeric fields of a write; returns NULL or the name of the first invalid field
+static const char *parse_write(WriteRequest *request) {
+    char **f = request->fields;
+    int *n = request->integers;
+    double *r = request->reals;
+
+    switch (request->kind) {
+        case WRITE_ADD_PRODUCT:
+            if (parse_price_field(f[4], &r[0]) != 0) {
+                return "cost_price";
+            }
+            if (parse_price_field(f[5], &r[1]) != 0) {
+                return "selling_price";
+            }
+            if (parse_int_field(f[6], 0, &n[0]) != 0) {
+                return "stock_quantity";
+            }
+            if (parse_int_field(f[7], 0, &n[1]) != 0) {
+                return "reorder_level";
+            }
+            break;
+        case WRITE_DELETE_PRODUCT:
+            if (parse_int_field(f[1], 1, &n[0]) != 0) {
+                return "product_id";
+            }
+            break;
+        case WRITE_UPDATE_STOCK:
+            if (parse_int_field(f[1], 1, &n[0]) != 0) {
+                return "product_id";
+            }
+            if (parse_int_field(f[2], 0, &n[1]) != 0) {
+                return "stock_quantity";
+            }
+            break;
+        case WRITE_ADD_SUPPLIER:
+            break;
+        case WRITE_ADD_TRANSACTION:
+            if (parse_int_field(f[1], 1, &n[0]) != 0) {
+                return "product_id";
+            }
+            if (parse_int_field(f[3], 1, &n[1]) != 0) {
+                return "quantity";
+            }
+            if (parse_int_field(f[5], INT_MIN, &n[2]) != 0) {
+                return "customer_supplier_id";
+            }
+            break;
+    }
+    return NULL;
+}
+
+// Low-stock lists
+
+static void release_low_stock(Server *server, LowStockList *list) {
+    if (!list) {
+        return;
+    }
+    pthread_mutex_lock(&server->low_stock_lock);
+    int references = --list->references;
+    pthread_mutex_unlock(&server->low_stock_lock);
+    if (references == 0) {
+        arena_free(&list->arena);
+        free(list);
+    }
+}
+
+static LowStockList *acquire_low_stock(Server *server) {
+    pthread_mutex_lock(&server->low_stock_lock);
+    LowStockList *list = server->low_stock;
+    if (list) {
+        list->references++;
+    }
+    pthread_mutex_unlock(&server->low_stock_lock);
+    return list;
+}
+
+static int copy_low_stock_product(const Product *product, void *context) {
+    LowStockList *list = context;
+    Product *copy = &list->products[list->count];
+    *copy = (Product){
+        .product_id = product->product_id,
+        .product_name = arena_strdup(&list->arena, product->product_name),
+        .stock_quantity = product->stock_quantity,
+        .reorder_level = product->reorder_level,
+    };
+    if (product->product_name && !copy->product_name) {
+        return 1;
+    }
+    list->count++;
+    return 0;
+}
+
+// Group hook: copy the writer catalog's low-stock heap for the workers, whose
+// read-only connections would otherwise scan Products for every LOW_STOCK
+static void publish_low_stock(Database *db, void *context) {
+    Server *server = context;
+    int count = catalog_low_stock_count(&db->catalog);
+    LowStockList *list = malloc(sizeof(LowStockList));
+
+    if (list) {
+        list->references = 1;
+        list->count = 0;
+        arena_init(&list->arena, 0);
+        list->products = arena_alloc(&list->arena, sizeof(Product) * (count ? count : 1));
+        if (!list->products || visit_low_stock_products(db, copy_low_stock_product, list) != count ||
+            list->count != count) {
+            arena_free(&list->arena);
+            free(list);
+            list = NULL;
+        }
+    }
+    if (!list) {
+        fprintf(stderr, "Out of memory publishing low-stock products; LOW_STOCK will query\n");
+    }
+
+    pthread_mutex_lock(&server->low_stock_lock);
+    LowStockList *previous = server->low_stock;
+    server->low_stock = list;
+    pthread_mutex_unlock(&server->low_stock_lock);
+    release_low_stock(server, previous);
+}
+
+// Queue a parsed write and block until its group has been committed
+static int submit_write(Server *server, WriteRequest *request) {
+    CommitTicket ticket;
+
+    commit_ticket_init(&ticket);
+    int status = commit_queue_submit(&server->writes, execute_write, request,
+                                     commit_ticket_complete, &ticket);
+    if (status == 0) {
+        status = commit_ticket_wait(&ticket);
+    }
+    commit_ticket_destroy(&ticket);
+    return status;
+}
+
+// Request handling
+
+static void reply_status(Session *session, int rows) {
+    char line[64];
+    if (rows < 0) {
+        output_line(&session->sink, "ERR request failed");
+    } else {
+        snprintf(line, sizeof(line), "OK %d", rows);
+        output_line(&session->sink, line);
+    }
+}
+
+static void reply_page(Session *session, int rows, int next_after_id) {
+    char line[64];
+    if (rows < 0) {
+        output_line(&session->sink, "ERR request failed");
+    } else {
+        snprintf(line, sizeof(line), "OK %d %d", rows, next_after_id);
+        output_line(&session->sink, line);
+    }
+}
+
+static void reply_product(Session *session, int product_id) {
+    Product *product;
+    if (get_product_record(session->db, product_id, &session->arena, &product) != 0) {
+        output_line(&session->sink, "ERR product not found");
+        return;
+    }
+    begin_product_rows(&session->sink);
+    write_product_row(product, &session->sink);
+    reply_status(session, 1);
+}
+
+static void reply_supplier(Session *session, int supplier_id) {
+    Supplier *supplier;
+    if (get_supplier_record(session->db, supplier_id, &session->arena, &supplier) != 0) {
+        output_line(&session->sink, "ERR supplier not found");
+        return;
+    }
+    begin_supplier_rows(&session->sink);
+    write_supplier_row(supplier, &session->sink);
+    reply_status(session, 1);
+}
+
+static void reply_low_stock(Session *session) {
+    LowStockList *list = acquire_low_stock(session->server);
+    if (!list) {
+        reply_status(session, write_low_stock_products(session->db, &session->sink));
+        return;
+    }
+    begin_low_stock_rows(&session->sink);
+    for (int i = 0; i < list->count; i++) {
+        write_low_stock_row(&list->products[i], &session->sink);
+    }
+    reply_status(session, list->count);
+    release_low_stock(session->server, list);
+}
+
+static void reply_write(Session *session, WriteKind kind, char **fields) {
+    WriteRequest request = {.kind = kind, .fields = fields};
+    const char *invalid = parse_write(&request);
+    char line[64];
+
+    if (invalid) {
+        snprintf(line, sizeof(line), "ERR invalid %s", invalid);
+        output_line(&session->sink, line);
+    } else if (submit_write(session->server, &request) == 0) {
+        output_line(&session->sink, "OK 0");
+    } else {
+        output_line(&session->sink, "ERR write rejected");
+    }
+}
+
+// Split a request line in place on '|'; returns the number of fields
+static int split_fields(char *line, char **fields) {
+    int count = 0;
+    fields[count++] = line;
+    for (char *p = line; *p && count < MAX_FIELDS; p++) {
+        if (*p == '|') {
+            *p = '\0';
+            fields[count++] = p + 1;
+        }
+    }
+    return count;
+}
+
+static void handle_request(Session *session, char *line) {
+    char *fields[MAX_FIELDS];
+    int count = split_fields(line, fields);
+    const char *command = fields[0];
+    OutputSink *sink = &session->sink;
+    int next_after_id;
+
+    // Row streams share the session's sink and the client's format
+    sink->format = session->client->format;
+
+    if (strcmp(command, "PING") == 0) {
+        reply_status(session, 0);
+    } else if (strcmp(command, "FORMAT") == 0 && count == 2) {
+        if (parse_output_format(fields[1], &session->client->format) == 0) {
+            reply_status(session, 0);
+        } else {
+            output_line(sink, "ERR unknown format");
+        }
+    } else if (strcmp(command, "PRODUCTS") == 0) {
+        reply_status(session, write_products(session->db, sink));
+    } else if (strcmp(command, "PRODUCTS_PAGE") == 0 && count == 3) {
+        int rows = write_products_page(session->db, atoi(fields[1]), atoi(fields[2]), sink, &next_after_id);
+        reply_page(session, rows, next_after_id);
+    } else if (strcmp(command, "PRODUCT") == 0 && count == 2) {
+        reply_product(session, atoi(fields[1]));
+    } else if (strcmp(command, "SUPPLIERS") == 0) {
+        reply_status(session, write_suppliers(session->db, sink));
+    } else if (strcmp(command, "SUPPLIER") == 0 && count == 2) {
+        reply_supplier(session, atoi(fields[1]));
+    } else if (strcmp(command, "TRANSACTIONS") == 0 && count == 2) {
+        reply_status(session, write_transactions(session->db, fields[1], sink));
+    } else if (strcmp(command, "TRANSACTIONS_PAGE") == 0 && count == 4) {
+        int rows = write_transactions_page(session->db, fields[1], atoi(fields[2]), atoi(fields[3]),
+                                           sink, &next_after_id);
+        reply_page(session, rows, next_after_id);
+    } else if (strcmp(command, "SALES") == 0 && count == 3) {
+        reply_status(session, write_sales_report(session->db, fields[1], fields[2], sink));
+    } else if (strcmp(command, "SEARCH") == 0 && (count == 3 || count == 4)) {
+        SearchField field = SEARCH_ALL;
+        if (count == 4 && parse_search_field(fields[3], &field) != 0) {
+            output_line(sink, "ERR unknown search field");
+        } else {
+            reply_status(session, write_product_search(session->db, fields[1], field, atoi(fields[2]), sink));
+        }
+    } else if (strcmp(command, "LOW_STOCK") == 0) {
+        reply_low_stock(session);
+    } else if (strcmp(command, "METRICS") == 0) {
+        reply_status(session, write_metrics(session->db, sink));
+    } else if (strcmp(command, "ADD_PRODUCT") == 0 && count == 8) {
+        reply_write(session, WRITE_ADD_PRODUCT, fields);
+    } else if (strcmp(command, "DELETE_PRODUCT") == 0 && count == 2) {
+        reply_write(session, WRITE_DELETE_PRODUCT, fields);
+    } else if (strcmp(command, "UPDATE_STOCK") == 0 && count == 3) {
+        reply_write(session, WRITE_UPDATE_STOCK, fields);
+    } else if (strcmp(command, "ADD_SUPPLIER") == 0 && count == 4) {
+        reply_write(session, WRITE_ADD_SUPPLIER, fields);
+    } else if (strcmp(command, "ADD_TRANSACTION") == 0 && count == 6) {
+        reply_write(session, WRITE_ADD_TRANSACTION, fields);
+    } else {
+        output_line(sink, "ERR unknown command or wrong number of fields");
+    }
+}
+
+// Read what a client has sent and answer every complete request in it
+static void serve_client(Session *session, Client *client) {
+    ssize_t n = read(client->fd, client->buffer + client->used, SESSION_BUFFER_SIZE - client->used);
+    if (n < 0 && (errno == EINTR || errno == EAGAIN)) {
+        return;
+    }
+    if (n <= 0) {
+        client->closed = 1;
+        return;
+    }
+    client->used += (size_t)n;
+    session->client = client;
+    output_reset(&session->sink, client->fd, client->format);
+
+    // Handle every complete line in the buffer
+    char *start = client->buffer;
+    char *newline;
+    while ((newline = memchr(start, '\n', client->used - (size_t)(start - client->buffer))) != NULL) {
+        *newline = '\0';
+        if (newline > start && newline[-1] == '\r') {
+            newline[-1] = '\0';
+        }
+        if (*start) {
+            handle_request(session, start);
+            arena_reset(&session->arena);
+        }
+        start = newline + 1;
+    }
+
+    client->used -= (size_t)(start - client->buffer);
+    memmove(client->buffer, start, client->used);
+    if (client->used == SESSION_BUFFER_SIZE) {
+        output_line(&session->sink, "ERR request too long");
+        client->closed = 1;
+    }
+    if (output_flush(&session->sink) != 0) {
+        client->closed = 1;
+    }
+}
+
+// Worker thread: owns one read-only connection and serves clients with input
+static void *worker_main(void *arg) {
+    Server *server = arg;
+    Database db;
+    DatabaseConfig config = server->options.config;
+    config.read_only = 1;
+    Session session = {.server = server, .db = &db};
+
+    int ready = 0;
+    if (initialize_database(&db, server->db_name, &config) != 0) {
+        fprintf(stderr, "Worker failed to open %s\n", server->db_name);
+    } else if (output_open(&session.sink, -1, OUTPUT_CSV) != 0) {
+        close_database(&db);
+    } else {
+        ready = 1;
+    }
+
+    pthread_mutex_lock(&server->client_lock);
+    server->workers_reported++;
+    server->workers_ready += ready;
+    pthread_cond_broadcast(&server->workers_changed);
+    pthread_mutex_unlock(&server->client_lock);
+    if (!ready) {
+        return NULL;
+    }
+    arena_init(&session.arena, 0);
+
+    for (;;) {
+        pthread_mutex_lock(&server->client_lock);
+        while (!server->ready_head && !server->stopping) {
+            pthread_cond_wait(&server->client_ready, &server->client_lock);
+        }
+        if (server->stopping) {
+            pthread_mutex_unlock(&server->client_lock);
+            break;
+        }
+        Client *client = server->ready_head;
+        server->ready_head = client->next;
+        if (!server->ready_head) {
+            server->ready_tail = NULL;
+        }
+        pthread_mutex_unlock(&server->client_lock);
+
+        serve_client(&session, client);
+
+        // Hand the client back to the polling thread and wake it
+        pthread_mutex_lock(&server->client_lock);
+        client->next = server->returned;
+        server->returned = client;
+        pthread_mutex_unlock(&server->client_lock);
+        char wake = 1;
+        while (write(server->wake_pipe[1], &wake, 1) < 0 && errno == EINTR) {
+        }
+    }
+
+    output_close(&session.sink);
+    arena_free(&session.arena);
+    close_database(&db);
+    return NULL;
+}
+
+static Client *create_client(int fd) {
+    Client *client = calloc(1, sizeof(Client));
+    if (!client || !(client->buffer = malloc(SESSION_BUFFER_SIZE))) {
+        free(client);
+        return NULL;
+    }
+    client->fd = fd;
+    client->format = OUTPUT_CSV;
+    return client;
+}
+
+static void destroy_clients(Client *client) {
+    while (client) {
+        Client *next = client->next;
+        close(client->fd);
+        free(client->buffer);
+        free(client);
+        client = next;
+    }
+}
+
+// Queue a client with input for the workers
+static void enqueue_client(Server *server, Client *client) {
+    client->next = NULL;
+    pthread_mutex_lock(&server->client_lock);
+    if (server->ready_tail) {
+        server->ready_tail->next = client;
+    } else {
+        server->ready_head = client;
+    }
+    server->ready_tail = client;
+    pthread_cond_signal(&server->client_ready);
+    pthread_mutex_unlock(&server->client_lock);
+}
+
+// Polling thread: waits on the listener and every idle client at once and
+// passes only clients with a request (or a hangup) to the workers, so idle
+// connections hold no worker. Returns when the server is told to stop.
+static int poll_clients(Server *server, int listener) {
+    Client **idle = malloc(sizeof(Client *) * MAX_CLIENTS);
+    struct pollfd *pfds = malloc(sizeof(struct pollfd) * (MAX_CLIENTS + 2));
+    int idle_count = 0;
+    int client_count = 0;  // idle, queued and being served
+    int status = 0;
+
+    if (!idle || !pfds) {
+        fprintf(stderr, "Out of memory starting the server\n");
+        free(idle);
+        free(pfds);
+        return -1;
+    }
+
+    while (server_running) {
+        pfds[0] = (struct pollfd){.fd = server->wake_pipe[0], .events = POLLIN};
+        pfds[1] = (struct pollfd){.fd = listener, .events = POLLIN};
+        for (int i = 0; i < idle_count; i++) {
+            pfds[i + 2] = (struct pollfd){.fd = idle[i]->fd, .events = POLLIN};
+        }
+        // The timeout only bounds how late a shutdown signal is noticed
+        int ready = poll(pfds, (nfds_t)idle_count + 2, POLL_INTERVAL_MS);
+        if (ready < 0 && errno != EINTR) {
+            perror("poll");
+            status = -1;
+            break;
+        }
+        if (ready <= 0) {
+            continue;
+        }
+
+        int kept = 0;
+        for (int i = 0; i < idle_count; i++) {
+            if (pfds[i + 2].revents) {
+                enqueue_client(server, idle[i]);
+            } else {
+                idle[kept++] = idle[i];
+            }
+        }
+        idle_count = kept;
+
+        if (pfds[0].revents & POLLIN) {
+            char drain[64];
+            while (read(server->wake_pipe[0], drain, sizeof(drain)) == (ssize_t)sizeof(drain)) {
+            }
+            pthread_mutex_lock(&server->client_lock);
+            Client *client = server->returned;
+            server->returned = NULL;
+            pthread_mutex_unlock(&server->client_lock);
+            while (client) {
+                Client *next = client->next;
+                client->next = NULL;
+                if (client->closed) {
+                    destroy_clients(client);
+                    client_count--;
+                } else {
+                    idle[idle_count++] = client;
+                }
+                client = next;
+            }
+        }
+
+        if (pfds[1].revents & POLLIN) {
+            int fd = accept(listener, NULL, NULL);
+            if (fd < 0) {
+                if (errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK) {
+                    perror("accept");
+                }
+            } else if (client_count == MAX_CLIENTS) {
+                fprintf(stderr, "Too many clients, dropping connection\n");
+                close(fd);
+            } else {
+                Client *client = create_client(fd);
+                if (client) {
+                    idle[idle_count++] = client;
+                    client_count++;
+                } else {
+                    fprintf(stderr, "Out of memory accepting a client\n");
+                    close(fd);
+                }
+            }
+        }
+    }
+
+    for (int i = 0; i < idle_count; i++) {
+        destroy_clients(idle[i]);
+    }
+    free(idle);
+    free(pfds);
+    return status;
+}
+
+static int set_nonblocking(int fd) {
+    int flags = fcntl(fd, F_GETFL);
+    return flags < 0 ? -1 : fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+// Wakeups from workers must never block either end
+static int open_wake_pipe(int fds[2]) {
+    if (pipe(fds) != 0) {
+        perror("pipe");
+        return -1;
+    }
+    if (set_nonblocking(fds[0]) != 0 || set_nonblocking(fds[1]) != 0) {
+        perror("fcntl");
+        close(fds[0]);
+        close(fds[1]);
+        return -1;
+    }
+    return 0;
+}
+
+static int open_listener(const char *socket_path) {
+    struct sockaddr_un address = {.sun_family = AF_UNIX};
+    if (strlen(socket_path) >= sizeof(address.sun_path)) {
+        fprintf(stderr, "Socket path too long: %s\n", socket_path);
+        return -1;
+    }
+    strcpy(address.sun_path, socket_path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        perror("socket");
+        return -1;
+    }
+    unlink(socket_path);
+    // Non-blocking, so an accept after poll never waits on a client that already left
+    if (bind(fd, (struct sockaddr *)&address, sizeof(address)) != 0 || listen(fd, 128) != 0 ||
+        set_nonblocking(fd) != 0) {
+        perror(socket_path);
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Drain and close the commit queue, then drop its last low-stock list
+static void close_writer(Server *server) {
+    commit_queue_close(&server->writes);
+    release_low_stock(server, server->low_stock);
+    pthread_mutex_destroy(&server->low_stock_lock);
+}
+
+int run_server(const char *db_name, const char *socket_path, const ServerOptions *options) {
+    Server server;
+    memset(&server, 0, sizeof(server));
+    server.db_name = db_name;
+    server.options = *options;
+    if (server.options.worker_count < 1) {
+        server.options.worker_count = 1;
+    }
+
+    // Block SIGINT/SIGTERM while threads start so only the polling thread takes them
+    sigset_t blocked, previous;
+    sigemptyset(&blocked);
+    sigaddset(&blocked, SIGINT);
+    sigaddset(&blocked, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &blocked, &previous);
+
+    // The writer opens first so the schema is current before readers attach,
+    // and publishes the first low-stock list before it returns
+    pthread_mutex_init(&server.low_stock_lock, NULL);
+    CommitQueueOptions write_options;
+    commit_queue_default_options(&write_options);
+    write_options.batch_size = server.options.max_batch;
+    write_options.flush_interval_ms = server.options.flush_interval_ms;
+    write_options.config = server.options.config;
+    write_options.group_hook = publish_low_stock;
+    write_options.group_context = &server;
+    if (commit_queue_open(&server.writes, db_name, &write_options) != 0) {
+        release_low_stock(&server, server.low_stock);
+        pthread_mutex_destroy(&server.low_stock_lock);
+        pthread_sigmask(SIG_SETMASK, &previous, NULL);
+        return -1;
+    }
+
+    int listener = open_listener(socket_path);
+    if (listener < 0) {
+        close_writer(&server);
+        pthread_sigmask(SIG_SETMASK, &previous, NULL);
+        return -1;
+    }
+
+    if (open_wake_pipe(server.wake_pipe) != 0) {
+        close(listener);
+        unlink(socket_path);
+        close_writer(&server);
+        pthread_sigmask(SIG_SETMASK, &previous, NULL);
+        return -1;
+    }
+
+    pthread_mutex_init(&server.client_lock, NULL);
+    pthread_cond_init(&server.client_ready, NULL);
+    pthread_cond_init(&server.workers_changed, NULL);
+
+    int started = 0;
+    pthread_t *workers = malloc(sizeof(pthread_t) * server.options.worker_count);
+    if (!workers) {
+        fprintf(stderr, "Out of memory starting workers\n");
+    }
+    while (workers && started < server.options.worker_count &&
+           pthread_create(&workers[started], NULL, worker_main, &server) == 0) {
+        started++;
+    }
+
+    // Serve only once the workers have their connections; clients queued with none would wait forever
+    pthread_mutex_lock(&server.client_lock);
+    while (server.workers_reported < started) {
+        pthread_cond_wait(&server.workers_changed, &server.client_lock);
+    }
+    int ready = server.workers_ready;
+    pthread_mutex_unlock(&server.client_lock);
+
+    struct sigaction action = {.sa_handler = handle_shutdown_signal};
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    signal(SIGPIPE, SIG_IGN);
+    server_running = 1;
+    pthread_sigmask(SIG_SETMASK, &previous, NULL);
+
+    int status = -1;
+    if (ready == 0) {
+        fprintf(stderr, "Failed to start any worker\n");
+    } else {
+        if (ready < server.options.worker_count) {
+            fprintf(stderr, "Started only %d of %d workers\n", ready, server.options.worker_count);
+        }
+        fprintf(stderr, "Serving %s on %s with %d workers\n", db_name, socket_path, ready);
+        status = poll_clients(&server, listener);
+    }
+
+    // Stop readers first, then let the commit queue drain what they queued
+    close(listener);
+    unlink(socket_path);
+    pthread_mutex_lock(&server.client_lock);
+    server.stopping = 1;
+    pthread_cond_broadcast(&server.client_ready);
+    pthread_mutex_unlock(&server.client_lock);
+    for (int i = 0; i < started; i++) {
+        pthread_join(workers[i], NULL);
+    }
+    destroy_clients(server.ready_head);
+    destroy_clients(server.returned);
+
+    close_writer(&server);
+
+    free(workers);
+    close(server.wake_pipe[0]);
+    close(server.wake_pipe[1]);
+    pthread_mutex_destroy(&server.client_lock);
+    pthread_cond_destroy(&server.client_ready);
+    pthread_cond_destroy(&server.workers_changed);
+    fprintf(stderr, "Server stopped\n");
+    return status;
+}
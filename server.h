@@ -0,0 +1,45 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include "database.h"
+
+// Daemon mode: serves the inventory over a local Unix socket.
+//
+// Requests are single lines of '|'-separated fields, e.g.
+//   SALES|2024-01-01|2024-01-31
+//   ADD_TRANSACTION|42|OUT|3|2024-01-15|7
+// Each reply is zero or more rows in the session's format (CSV unless changed
+// with FORMAT|table|csv|jsonl) followed by one status line, "OK <rows>" or
+// "ERR <message>". Paged listings add the continuation token: "OK <rows> <next>".
+// Writes with a malformed or out-of-range number are answered
+// "ERR invalid <field>" and never queued.
+// SEARCH|text|limit[|all|name|category|description] returns the best
+// matching products first (see search_products in database.h).
+// LOW_STOCK is answered from a copy of the writer's low-stock heap that the
+// committer publishes after every group, so it never scans Products; writes
+// made by other processes show up once the server restarts.
+// METRICS returns the process-wide operation metrics and the statistics of the
+// worker connection that served it.
+//
+// One thread polls the listening socket and every idle client; a client that
+// has sent a request is queued for the worker threads, whose first free one
+// answers every complete request it has read and hands the client back, so
+// idle connections hold no worker. Workers each own a read-only connection,
+// and at most 1024 clients are connected at a time. Writes go
+// through a CommitQueue (commit_queue.h): one writer thread commits them in
+// groups and each client is answered once its group is committed.
+
+typedef struct {
+    int worker_count;       // reader threads / pooled read-only connections
+    int max_batch;          // most queued writes folded into one commit
+    int flush_interval_ms;  // longest a write waits for its group to fill
+    DatabaseConfig config;  // writer settings; readers use the same with read_only set
+} ServerOptions;
+
+// Fill options with defaults (one worker per online CPU)
+void server_default_options(ServerOptions *options);
+
+// Serve until SIGINT or SIGTERM; returns 0 on a clean shutdown
+int run_server(const char *db_name, const char *socket_path, const ServerOptions *options);
+
+#endif // SERVER_H
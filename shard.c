@@ -0,0 +1,638 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "shard.h"
+#include "metrics.h"
+
+#define SHARD_NAME_MAX 4096
+
+int shard_file_name(const char *db_name, int shard, char *buffer, size_t size) {
+    int written;
+    size_t length = strlen(db_name);
+
+    if (shard == 0) {
+        written = snprintf(buffer, size, "%s", db_name);
+    } else if (length > 3 && strcmp(db_name + length - 3, ".db") == 0) {
+        written = snprintf(buffer, size, "%.*s.%d.db", (int)(length - 3), db_name, shard);
+    } else {
+        written = snprintf(buffer, size, "%s.%d", db_name, shard);
+    }
+    return written >= 0 && (size_t)written < size ? 0 : -1;
+}
+
+static int shard_index(const ShardSet *set, long long product_id) {
+    int shard = (int)(product_id % set->shard_count);
+    return shard < 0 ? shard + set->shard_count : shard;
+}
+
+// Place in a set recorded in a shard file; *shard_count is 0 when it records none
+static int read_membership(Database *db, int *shard, int *shard_count) {
+    sqlite3_stmt *stmt;
+    int rc;
+
+    *shard = 0;
+    *shard_count = 0;
+    if (sqlite3_prepare_v2(db->connection, "SELECT shard, shard_count FROM ShardInfo;", -1, &stmt, NULL) != SQLITE_OK) {
+        fprintf(stderr, "Failed to prepare statement: %s\n", sqlite3_errmsg(db->connection));
+        return -1;
+    }
+    rc = sqlite3_step(stmt);
+    if (rc == SQLITE_ROW) {
+        *shard = sqlite3_column_int(stmt, 0);
+        *shard_count = sqlite3_column_int(stmt, 1);
+    } else if (rc != SQLITE_DONE) {
+        fprintf(stderr, "Failed to execute statement: %s\n", sqlite3_errmsg(db->connection));
+    }
+    sqlite3_finalize(stmt);
+    return rc == SQLITE_ROW || rc == SQLITE_DONE ? 0 : -1;
+}
+
+// Refuse a file recorded as another place in a set; *recorded is set when it has one
+static int check_membership(Database *db, int shard, int shard_count, int *recorded) {
+    int file_shard, file_shard_count;
+
+    if (read_membership(db, &file_shard, &file_shard_count) != 0) {
+        return -1;
+    }
+    *recorded = file_shard_count != 0;
+    if (file_shard_count == 0 && shard_count == 1) {
+        return 0;
+    }
+    if (*recorded && (file_shard != shard || file_shard_count != shard_count)) {
+        fprintf(stderr, "%s is shard %d of %d, not shard %d of %d\n",
+                db->db_name, file_shard, file_shard_count, shard, shard_count);
+        return -1;
+    }
+    return 0;
+}
+
+// Record a file's place in a set of more than one shard
+static int record_membership(Database *db, int shard, int shard_count) {
+    sqlite3_stmt *stmt;
+
+    if (shard_count == 1) {
+        return 0;
+    }
+    if (sqlite3_prepare_v2(db->connection,
+                           "INSERT INTO ShardInfo (singleton, shard, shard_count) VALUES (1, ?1, ?2);",
+                           -1, &stmt, NULL) != SQLITE_OK) {
+        fprintf(stderr, "Failed to prepare statement: %s\n", sqlite3_errmsg(db->connection));
+        return -1;
+    }
+    sqlite3_bind_int(stmt, 1, shard);
+    sqlite3_bind_int(stmt, 2, shard_count);
+    int status = sqlite3_step(stmt) == SQLITE_DONE ? 0 : -1;
+    if (status != 0) {
+        fprintf(stderr, "Failed to record shard %d of %d in %s: %s\n", shard, shard_count, db->db_name,
+                sqlite3_errmsg(db->connection));
+    }
+    sqlite3_finalize(stmt);
+    return status;
+}
+
+// Refuse to use shard_count shards when the set has a file past the last of them
+static int check_no_extra_shard(const char *db_name, int shard_count) {
+    char path[SHARD_NAME_MAX];
+    if (shard_file_name(db_name, shard_count, path, sizeof(path)) != 0) {
+        fprintf(stderr, "Shard file name too long: %s\n", db_name);
+        return -1;
+    }
+    if (access(path, F_OK) == 0) {
+        fprintf(stderr, "%s exists: %s has more than %d shard%s\n", path, db_name, shard_count,
+                shard_count == 1 ? "" : "s");
+        return -1;
+    }
+    return 0;
+}
+
+int shard_check_single_file(const char *db_name) {
+    return check_no_extra_shard(db_name, 1);
+}
+
+// Refuse a file holding products another shard owns, and find the largest id handed out
+static int check_shard(ShardSet *set, int shard, int shard_count) {
+    Database *db = &set->shards[shard];
+    sqlite3_stmt *stmt;
+    int status = -1;
+
+    if (sqlite3_prepare_v2(db->connection,
+                           "SELECT "
+                           "(SELECT product_id FROM Products WHERE product_id % ?1 != ?2 LIMIT 1), "
+                           "max(coalesce((SELECT seq FROM sqlite_sequence WHERE name = 'Products'), 0), "
+                           "coalesce((SELECT max(product_id) FROM Products), 0));",
+                           -1, &stmt, NULL) != SQLITE_OK) {
+        fprintf(stderr, "Failed to prepare statement: %s\n", sqlite3_errmsg(db->connection));
+        return -1;
+    }
+    sqlite3_bind_int(stmt, 1, shard_count);
+    sqlite3_bind_int(stmt, 2, shard);
+
+    if (sqlite3_step(stmt) != SQLITE_ROW) {
+        fprintf(stderr, "Failed to execute statement: %s\n", sqlite3_errmsg(db->connection));
+    } else if (sqlite3_column_type(stmt, 0) != SQLITE_NULL) {
+        fprintf(stderr, "%s: product %d does not belong to shard %d of %d; "
+                        "was the set created with a different shard count?\n",
+                db->db_name, sqlite3_column_int(stmt, 0), shard, shard_count);
+    } else {
+        int last_id = sqlite3_column_int(stmt, 1);
+        if (last_id >= set->next_product_id) {
+            set->next_product_id = last_id + 1;
+        }
+        status = 0;
+    }
+    sqlite3_finalize(stmt);
+    return status;
+}
+
+int shard_set_open(ShardSet *set, const char *db_name, int shard_count, const DatabaseConfig *config) {
+    if (shard_count < 1 || shard_count > SHARD_MAX) {
+        fprintf(stderr, "Shard count must be between 1 and %d\n", SHARD_MAX);
+        return -1;
+    }
+    set->shard_count = 0;
+    set->next_product_id = 1;
+    if (check_no_extra_shard(db_name, shard_count) != 0) {
+        return -1;
+    }
+    set->shards = calloc(shard_count, sizeof(Database));
+    if (!set->shards) {
+        fprintf(stderr, "Out of memory opening shards\n");
+        return -1;
+    }
+
+    for (int i = 0; i < shard_count; i++) {
+        char path[SHARD_NAME_MAX];
+        if (shard_file_name(db_name, i, path, sizeof(path)) != 0) {
+            fprintf(stderr, "Shard file name too long: %s\n", db_name);
+            shard_set_close(set);
+            return -1;
+        }
+        if (initialize_database(&set->shards[i], path, config) != 0) {
+            shard_set_close(set);
+            return -1;
+        }
+        set->shard_count++;
+
+        // Files of a set record their place in it; one that does not yet (a
+        // new file, or a set older than the record) is given it once its
+        // products check out, unless this open cannot write
+        Database *shard = &set->shards[i];
+        int recorded;
+        if (check_membership(shard, i, shard_count, &recorded) != 0 || check_shard(set, i, shard_count) != 0 ||
+            (!recorded && !shard->config.read_only && record_membership(shard, i, shard_count) != 0)) {
+            shard_set_close(set);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void shard_set_close(ShardSet *set) {
+    for (int i = 0; i < set->shard_count; i++) {
+        close_database(&set->shards[i]);
+    }
+    free(set->shards);
+    set->shards = NULL;
+    set->shard_count = 0;
+}
+
+Database *shard_for_product(ShardSet *set, int product_id) {
+    return &set->shards[shard_index(set, product_id)];
+}
+
+Database *shard_for_suppliers(ShardSet *set) {
+    return &set->shards[0];
+}
+
+int shard_add_product(ShardSet *set, const char *name, const char *description, const char *category,
+                      double cost_price, double selling_price, int stock_quantity, int reorder_level,
+                      int *product_id) {
+    int id = set->next_product_id;
+    if (add_product_with_id(shard_for_product(set, id), id, name, description, category, cost_price,
+                            selling_price, stock_quantity, reorder_level) != 0) {
+        return -1;
+    }
+    set->next_product_id = id + 1;
+    *product_id = id;
+    return 0;
+}
+
+// Move the rows of one shard out of the base file; db_name's connection has it attached as "shard"
+static int move_shard_rows(Database *db, int shard, int shard_count) {
+    // Parents first on the way in, children first on the way out
+    static const char *tables[] = {"Products", "Transactions", "DailySales", "StockCheckpoints"};
+    int table_count = (int)(sizeof(tables) / sizeof(tables[0]));
+
+    if (begin_transaction(db) != 0) {
+        return -1;
+    }
+    for (int i = 0; i < 2 * table_count; i++) {
+        const char *table = i < table_count ? tables[i] : tables[2 * table_count - 1 - i];
+        char *sql = i < table_count
+            ? sqlite3_mprintf("INSERT OR IGNORE INTO shard.%s SELECT * FROM main.%s "
+                              "WHERE product_id %% %d = %d;", table, table, shard_count, shard)
+            : sqlite3_mprintf("DELETE FROM main.%s WHERE product_id %% %d = %d;", table, shard_count, shard);
+        char *error = NULL;
+        int rc = sql ? sqlite3_exec(db->connection, sql, NULL, NULL, &error) : SQLITE_NOMEM;
+        sqlite3_free(sql);
+        if (rc != SQLITE_OK) {
+            fprintf(stderr, "Failed to move %s to shard %d: %s\n", table, shard,
+                    error ? error : sqlite3_errstr(rc));
+            sqlite3_free(error);
+            rollback_transaction(db);
+            return -1;
+        }
+    }
+    return commit_transaction(db);
+}
+
+int shard_split_database(const char *db_name, int shard_count, const DatabaseConfig *config) {
+    if (shard_count < 2 || shard_count > SHARD_MAX) {
+        fprintf(stderr, "Shard count must be between 2 and %d\n", SHARD_MAX);
+        return -1;
+    }
+
+    if (check_no_extra_shard(db_name, shard_count) != 0) {
+        return -1;
+    }
+    Database db;
+    if (initialize_database(&db, db_name, config) != 0) {
+        return -1;
+    }
+    // The base file records the count first, so a rerun with another count is refused
+    int recorded;
+    int status = check_membership(&db, 0, shard_count, &recorded);
+    if (status == 0 && !recorded) {
+        status = record_membership(&db, 0, shard_count);
+    }
+    for (int i = 1; status == 0 && i < shard_count; i++) {
+        // Create the shard with the current schema, then fill it through the base connection
+        char path[SHARD_NAME_MAX];
+        Database shard;
+        if (shard_file_name(db_name, i, path, sizeof(path)) != 0 ||
+            initialize_database(&shard, path, config) != 0) {
+            fprintf(stderr, "Failed to create shard %d of %s\n", i, db_name);
+            status = -1;
+            break;
+        }
+        status = check_membership(&shard, i, shard_count, &recorded);
+        if (status == 0 && !recorded) {
+            status = record_membership(&shard, i, shard_count);
+        }
+        close_database(&shard);
+        if (status != 0) {
+            break;
+        }
+
+        char *attach = sqlite3_mprintf("ATTACH %Q AS shard;", path);
+        if (!attach || sqlite3_exec(db.connection, attach, NULL, NULL, NULL) != SQLITE_OK) {
+            fprintf(stderr, "Failed to attach %s: %s\n", path, sqlite3_errmsg(db.connection));
+            status = -1;
+        } else {
+            status = move_shard_rows(&db, i, shard_count);
+            sqlite3_exec(db.connection, "DETACH shard;", NULL, NULL, NULL);
+        }
+        sqlite3_free(attach);
+    }
+    close_database(&db);
+    return status;
+}
+
+// Parallel ingest: one writer thread per shard reads its share from a pipe
+
+typedef struct {
+    Database *db;
+    FILE *input;  // read end of the shard's pipe
+    int batch_size;
+    BulkIngestStats stats;
+    int status;
+} ShardIngest;
+
+static void *shard_ingest_main(void *arg) {
+    ShardIngest *ingest = arg;
+    char discard[4096];
+
+    ingest->status = ingest_transactions(ingest->db, ingest->input, ingest->batch_size, &ingest->stats);
+    // Keep reading after a failure so the router never blocks on a full pipe
+    while (fread(discard, 1, sizeof(discard), ingest->input) > 0) {
+    }
+    fclose(ingest->input);
+    return NULL;
+}
+
+// Shard for one raw input line; lines that do not start with a product_id
+// go to shard 0, which skips or rejects them
+static int route_line(const ShardSet *set, const char *line) {
+    char *end;
+    long long product_id = strtoll(line, &end, 10);
+    return end == line ? 0 : shard_index(set, product_id);
+}
+
+int shard_ingest_transactions(ShardSet *set, FILE *input, int batch_size, BulkIngestStats *stats) {
+    int count = set->shard_count;
+    ShardIngest *ingests = calloc(count, sizeof(ShardIngest));
+    pthread_t *threads = calloc(count, sizeof(pthread_t));
+    FILE **routes = calloc(count, sizeof(FILE *));
+    int started = 0;
+    int status = 0;
+
+    memset(stats, 0, sizeof(*stats));
+    double started_at = metrics_now_seconds();
+    if (!ingests || !threads || !routes) {
+        fprintf(stderr, "Out of memory starting ingest\n");
+        status = -1;
+    }
+
+    for (; status == 0 && started < count; started++) {
+        int fds[2];
+        if (pipe(fds) != 0) {
+            perror("pipe");
+            status = -1;
+            break;
+        }
+        ingests[started].db = &set->shards[started];
+        ingests[started].batch_size = batch_size;
+        ingests[started].input = fdopen(fds[0], "r");
+        routes[started] = fdopen(fds[1], "w");
+        if (!ingests[started].input || !routes[started] ||
+            pthread_create(&threads[started], NULL, shard_ingest_main, &ingests[started]) != 0) {
+            fprintf(stderr, "Failed to start writer for shard %d\n", started);
+            if (ingests[started].input) {
+                fclose(ingests[started].input);
+            } else {
+                close(fds[0]);
+            }
+            if (routes[started]) {
+                fclose(routes[started]);
+            } else {
+                close(fds[1]);
+            }
+            status = -1;
+            break;
+        }
+    }
+
+    char *line = NULL;
+    size_t capacity = 0;
+    ssize_t length;
+    while (status == 0 && (length = getline(&line, &capacity, input)) != -1) {
+        FILE *route = routes[route_line(set, line)];
+        if (fputs(line, route) == EOF || (line[length - 1] != '\n' && fputc('\n', route) == EOF)) {
+            fprintf(stderr, "Failed to route transaction input\n");
+            status = -1;
+        }
+    }
+    free(line);
+    if (status == 0 && ferror(input)) {
+        fprintf(stderr, "Failed to read transaction input\n");
+        status = -1;
+    }
+
+    // Closing a pipe ends that shard's input; its last batch commits before the join returns
+    for (int i = 0; i < started; i++) {
+        if (fclose(routes[i]) != 0) {
+            status = -1;
+        }
+    }
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+        if (ingests[i].status != 0) {
+            status = -1;
+        }
+        stats->rows_read += ingests[i].stats.rows_read;
+        stats->rows_inserted += ingests[i].stats.rows_inserted;
+        stats->rows_rejected += ingests[i].stats.rows_rejected;
+        stats->batches_committed += ingests[i].stats.batches_committed;
+    }
+    free(ingests);
+    free(threads);
+    free(routes);
+
+    stats->elapsed_seconds = metrics_now_seconds() - started_at;
+    return status;
+}
+
+// Scatter-gather: one thread per shard collects its rows into its own arena
+
+typedef enum {
+    GATHER_PRODUCTS,
+    GATHER_SALES_REPORT,
+    GATHER_LOW_STOCK
+} GatherQuery;
+
+typedef struct {
+    Database *db;
+    GatherQuery query;
+    const char *start_date;
+    const char *end_date;
+    Arena arena;
+    void *rows;
+    int row_count;  // -1 if the query failed
+    int capacity;
+} ShardGather;
+
+static int gather_product(const Product *product, void *context) {
+    ShardGather *gather = context;
+    if (gather->row_count == gather->capacity) {
+        int grown = gather->capacity ? gather->capacity * 2 : 256;
+        void *rows = arena_grow(&gather->arena, gather->rows, sizeof(Product) * gather->capacity,
+                                sizeof(Product) * grown);
+        if (!rows) {
+            return 1;
+        }
+        gather->rows = rows;
+        gather->capacity = grown;
+    }
+
+    Product *copy = (Product *)gather->rows + gather->row_count;
+    *copy = *product;
+    copy->product_name = arena_strdup(&gather->arena, product->product_name);
+    copy->description = arena_strdup(&gather->arena, product->description);
+    copy->category = arena_strdup(&gather->arena, product->category);
+    if ((product->product_name && !copy->product_name) || (product->description && !copy->description) ||
+        (product->category && !copy->category)) {
+        return 1;
+    }
+    gather->row_count++;
+    return 0;
+}
+
+static void *shard_gather_main(void *arg) {
+    ShardGather *gather = arg;
+
+    switch (gather->query) {
+        case GATHER_PRODUCTS:
+            gather->row_count = 0;
+            if (visit_products(gather->db, gather_product, gather) != gather->row_count) {
+                fprintf(stderr, "Failed to collect products from %s\n", gather->db->db_name);
+                gather->row_count = -1;
+            }
+            break;
+        case GATHER_SALES_REPORT:
+            gather->row_count = get_sales_report(gather->db, gather->start_date, gather->end_date,
+                                                 &gather->arena, (SalesReportRow **)&gather->rows);
+            break;
+        case GATHER_LOW_STOCK:
+            gather->row_count = get_low_stock_products(gather->db, &gather->arena, (Product **)&gather->rows);
+            break;
+    }
+    return NULL;
+}
+
+// Run the query on every shard at once; returns the total row count or -1.
+// The gathers' arenas are initialized here and freed by the caller.
+static int shard_gather(ShardSet *set, GatherQuery query, const char *start_date, const char *end_date,
+                        ShardGather *gathers) {
+    pthread_t threads[SHARD_MAX];
+    int threaded[SHARD_MAX];
+    int total = 0;
+
+    for (int i = 0; i < set->shard_count; i++) {
+        gathers[i] = (ShardGather){
+            .db = &set->shards[i],
+            .query = query,
+            .start_date = start_date,
+            .end_date = end_date,
+        };
+        arena_init(&gathers[i].arena, 0);
+    }
+    // The calling thread takes shard 0; a shard whose thread fails to start runs inline
+    for (int i = 1; i < set->shard_count; i++) {
+        threaded[i] = pthread_create(&threads[i], NULL, shard_gather_main, &gathers[i]) == 0;
+    }
+    shard_gather_main(&gathers[0]);
+    for (int i = 1; i < set->shard_count; i++) {
+        if (threaded[i]) {
+            pthread_join(threads[i], NULL);
+        } else {
+            shard_gather_main(&gathers[i]);
+        }
+    }
+
+    for (int i = 0; i < set->shard_count; i++) {
+        if (gathers[i].row_count < 0) {
+            total = -1;
+        } else if (total >= 0) {
+            total += gathers[i].row_count;
+        }
+    }
+    return total;
+}
+
+static void free_gathers(ShardSet *set, ShardGather *gathers) {
+    for (int i = 0; i < set->shard_count; i++) {
+        arena_free(&gathers[i].arena);
+    }
+}
+
+// Concatenate the gathered rows into one array (the strings stay in the gather arenas)
+static void *merge_gathers(ShardSet *set, const ShardGather *gathers, size_t row_size, int total) {
+    char *rows = malloc(row_size * (total > 0 ? total : 1));
+    if (!rows) {
+        fprintf(stderr, "Out of memory merging shards\n");
+        return NULL;
+    }
+
+    size_t offset = 0;
+    for (int i = 0; i < set->shard_count; i++) {
+        if (gathers[i].row_count > 0) {
+            memcpy(rows + offset, gathers[i].rows, row_size * gathers[i].row_count);
+            offset += row_size * gathers[i].row_count;
+        }
+    }
+    return rows;
+}
+
+static int compare_product_ids(const void *a, const void *b) {
+    const Product *pa = a, *pb = b;
+    return (pa->product_id > pb->product_id) - (pa->product_id < pb->product_id);
+}
+
+// Same order as the low-stock query: largest shortfall first, then by id
+static int compare_shortfalls(const void *a, const void *b) {
+    const Product *pa = a, *pb = b;
+    int shortfall_a = pa->reorder_level - pa->stock_quantity;
+    int shortfall_b = pb->reorder_level - pb->stock_quantity;
+    if (shortfall_a != shortfall_b) {
+        return shortfall_a > shortfall_b ? -1 : 1;
+    }
+    return compare_product_ids(a, b);
+}
+
+// Sales rows group by product name, and names are not unique across shards
+static int compare_product_names(const void *a, const void *b) {
+    const SalesReportRow *ra = a, *rb = b;
+    if (!ra->product_name || !rb->product_name) {
+        return (ra->product_name != NULL) - (rb->product_name != NULL);
+    }
+    return strcmp(ra->product_name, rb->product_name);
+}
+
+int shard_write_products(ShardSet *set, OutputSink *sink) {
+    ShardGather gathers[SHARD_MAX];
+    int total = shard_gather(set, GATHER_PRODUCTS, NULL, NULL, gathers);
+    Product *rows = total >= 0 ? merge_gathers(set, gathers, sizeof(Product), total) : NULL;
+    int status = -1;
+
+    if (rows) {
+        qsort(rows, total, sizeof(Product), compare_product_ids);
+        begin_product_rows(sink);
+        for (int i = 0; i < total; i++) {
+            write_product_row(&rows[i], sink);
+        }
+        free(rows);
+        status = total;
+    }
+    free_gathers(set, gathers);
+    return status;
+}
+
+int shard_write_sales_report(ShardSet *set, const char *start_date, const char *end_date, OutputSink *sink) {
+    ShardGather gathers[SHARD_MAX];
+    int total = shard_gather(set, GATHER_SALES_REPORT, start_date, end_date, gathers);
+    SalesReportRow *rows = total >= 0 ? merge_gathers(set, gathers, sizeof(SalesReportRow), total) : NULL;
+    int row_count = 0;
+    int status = -1;
+
+    if (rows) {
+        qsort(rows, total, sizeof(SalesReportRow), compare_product_names);
+        for (int i = 0; i < total; i++) {
+            if (row_count > 0 && compare_product_names(&rows[row_count - 1], &rows[i]) == 0) {
+                rows[row_count - 1].total_sold += rows[i].total_sold;
+                rows[row_count - 1].total_sales += rows[i].total_sales;
+            } else {
+                rows[row_count++] = rows[i];
+            }
+        }
+
+        begin_sales_report_rows(sink);
+        for (int i = 0; i < row_count; i++) {
+            write_sales_report_row(&rows[i], sink);
+        }
+        free(rows);
+        status = row_count;
+    }
+    free_gathers(set, gathers);
+    return status;
+}
+
+int shard_write_low_stock_products(ShardSet *set, OutputSink *sink) {
+    ShardGather gathers[SHARD_MAX];
+    int total = shard_gather(set, GATHER_LOW_STOCK, NULL, NULL, gathers);
+    Product *rows = total >= 0 ? merge_gathers(set, gathers, sizeof(Product), total) : NULL;
+    int status = -1;
+
+    if (rows) {
+        qsort(rows, total, sizeof(Product), compare_shortfalls);
+        begin_low_stock_rows(sink);
+        for (int i = 0; i < total; i++) {
+            write_low_stock_row(&rows[i], sink);
+        }
+        free(rows);
+        status = total;
+    }
+    free_gathers(set, gathers);
+    return status;
+}
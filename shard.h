@@ -0,0 +1,80 @@
+#ifndef SHARD_H
+#define SHARD_H
+
+#include <stdio.h>
+#include "database.h"
+
+// Sharded storage
+// Products and their transactions are spread over shard_count database files
+// by product_id: product p lives in shard p % shard_count together with every
+// transaction that references it. Each shard is a complete inventory database
+// with its own connection, WAL and writer lock, so writes to different shards
+// never wait on each other, and shards on separate disks sync in parallel.
+// Suppliers stay in shard 0.
+//
+// Shard 0 is the base file itself ("inventory.db"); shard i is "inventory.i.db"
+// next to it, which may be a symlink to a file on another disk. A set of one
+// shard is an ordinary database. Every file of a larger set records which
+// shard of how many it is (the ShardInfo table), written by the split or by
+// the first writable open. Opening refuses a file recorded with another place
+// or holding products another shard owns, and refuses a count that leaves a
+// shard file past the last one unopened.
+//
+// Product ids are global: shard_add_product takes the next id after the
+// largest one in any shard and inserts the product into the shard owning it.
+// Only one process should add products to a set at a time; a second one gets
+// a constraint failure rather than a duplicate id.
+
+#define SHARD_MAX 64
+
+typedef struct {
+    int shard_count;
+    Database *shards;     // shard i owns the products with product_id % shard_count == i
+    int next_product_id;  // next id handed out by shard_add_product
+} ShardSet;
+
+// Write the file name of shard number shard into buffer; returns -1 if it does not fit
+int shard_file_name(const char *db_name, int shard, char *buffer, size_t size);
+
+// Open (creating if needed) every shard with config; NULL uses PROFILE_BALANCED
+int shard_set_open(ShardSet *set, const char *db_name, int shard_count, const DatabaseConfig *config);
+void shard_set_close(ShardSet *set);
+
+// Refuse to open db_name as a single file when it is the base of a larger set
+// (its first shard file exists); returns 0 or -1
+int shard_check_single_file(const char *db_name);
+
+// Turn the single-file database db_name into shard 0 of shard_count: every
+// other shard's products, with their transactions, daily sales and stock
+// checkpoints, are moved into its file, one shard per SQL transaction. An
+// interrupted split can be run again to finish. Returns 0 or -1.
+int shard_split_database(const char *db_name, int shard_count, const DatabaseConfig *config);
+
+// Owning shard; product, stock and transaction calls for product_id go to this handle
+Database *shard_for_product(ShardSet *set, int product_id);
+// Shard holding the Suppliers table
+Database *shard_for_suppliers(ShardSet *set);
+
+// add_product on the owning shard; *product_id receives the new id
+int shard_add_product(ShardSet *set, const char *name, const char *description, const char *category,
+                      double cost_price, double selling_price, int stock_quantity, int reorder_level,
+                      int *product_id);
+
+// Bulk ingest, same input and batching as ingest_transactions
+// The calling thread routes each line by its product_id to one writer thread
+// per shard, which runs ingest_transactions on that shard's connection.
+// Lines without a product_id (blank lines, comments, the header, malformed
+// rows) go to shard 0. stats add up the shards; rejection messages number
+// lines within each shard's share of the input.
+int shard_ingest_transactions(ShardSet *set, FILE *input, int batch_size, BulkIngestStats *stats);
+
+// Cross-shard reads
+// One thread per shard runs the query on that shard's connection; the partial
+// results are merged into the order the single-file write_* function uses
+// (products by id, sales rows by product name with equal names summed, low
+// stock by shortfall). Return the number of rows written or -1.
+int shard_write_products(ShardSet *set, OutputSink *sink);
+int shard_write_sales_report(ShardSet *set, const char *start_date, const char *end_date, OutputSink *sink);
+int shard_write_low_stock_products(ShardSet *set, OutputSink *sink);
+
+#endif // SHARD_H
@@ -0,0 +1,581 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "snapshot.h"
+
+#define SECTION_ALIGNMENT 64
+
+static const OutputColumn product_sales_columns[] = {
+    {"ID", "product_id", 6},
+    {"Product", "product_name", 20},
+    {"Category", "category", 15},
+    {"Total Sold", "total_sold", 12},
+    {"Total Sales", "total_sales", 14},
+};
+#define PRODUCT_SALES_COLUMN_COUNT ((int)(sizeof(product_sales_columns) / sizeof(product_sales_columns[0])))
+
+static const OutputColumn category_sales_columns[] = {
+    {"Category", "category", 20},
+    {"Total Sold", "total_sold", 12},
+    {"Total Sales", "total_sales", 14},
+};
+#define CATEGORY_SALES_COLUMN_COUNT ((int)(sizeof(category_sales_columns) / sizeof(category_sales_columns[0])))
+
+static uint64_t align_section(uint64_t offset) {
+    return (offset + SECTION_ALIGNMENT - 1) & ~(uint64_t)(SECTION_ALIGNMENT - 1);
+}
+
+// Days since 1970-01-01 in the proleptic Gregorian calendar
+static int32_t days_from_civil(int year, int month, int day) {
+    year -= month <= 2;
+    int era = (year >= 0 ? year : year - 399) / 400;
+    int year_of_era = year - era * 400;
+    int day_of_year = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+    return era * 146097 + day_of_era - 719468;
+}
+
+int snapshot_parse_day(const char *date, int32_t *day) {
+    int year, month, dom;
+    char dash1, dash2;
+    if (sscanf(date, "%4d%c%2d%c%2d", &year, &dash1, &month, &dash2, &dom) != 5 ||
+        dash1 != '-' || dash2 != '-' || month < 1 || month > 12 || dom < 1 || dom > 31) {
+        return -1;
+    }
+    *day = days_from_civil(year, month, dom);
+    return 0;
+}
+
+// Export
+
+// Growable buffer of NUL-terminated strings addressed by offset
+typedef struct {
+    char *data;
+    size_t size;
+    size_t capacity;
+} StringTable;
+
+static int string_table_add(StringTable *table, const char *value, uint32_t *offset) {
+    size_t length = strlen(value) + 1;
+    if (table->size + length > table->capacity) {
+        size_t capacity = table->capacity ? table->capacity : 4096;
+        while (table->size + length > capacity) {
+            capacity *= 2;
+        }
+        char *grown = realloc(table->data, capacity);
+        if (!grown) {
+            return -1;
+        }
+        table->data = grown;
+        table->capacity = capacity;
+    }
+    *offset = (uint32_t)table->size;
+    memcpy(table->data + table->size, value, length);
+    table->size += length;
+    return 0;
+}
+
+static int compare_strings(const void *a, const void *b) {
+    return strcmp(*(const char *const *)a, *(const char *const *)b);
+}
+
+static int query_int64(Database *db, const char *sql, int64_t *value) {
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(db->connection, sql, -1, &stmt, NULL) != SQLITE_OK) {
+        fprintf(stderr, "Failed to prepare snapshot query: %s\n", sqlite3_errmsg(db->connection));
+        return -1;
+    }
+    int status = -1;
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        *value = sqlite3_column_int64(stmt, 0);
+        status = 0;
+    } else {
+        fprintf(stderr, "Snapshot query failed: %s\n", sqlite3_errmsg(db->connection));
+    }
+    sqlite3_finalize(stmt);
+    return status;
+}
+
+// Product and category sections, built in memory before the file is sized
+typedef struct {
+    int32_t product_count;
+    int32_t *product_ids;  // ascending, by slot
+    double *prices;
+    int32_t *categories;
+    uint32_t *product_names;
+    char **category_list;  // sorted, owned
+    int32_t category_count;
+    uint32_t *category_names;
+    StringTable strings;
+} ProductSections;
+
+static void free_product_sections(ProductSections *sections) {
+    for (int i = 0; i < sections->category_count; i++) {
+        free(sections->category_list[i]);
+    }
+    free(sections->category_list);
+    free(sections->product_ids);
+    free(sections->prices);
+    free(sections->categories);
+    free(sections->product_names);
+    free(sections->category_names);
+    free(sections->strings.data);
+}
+
+static int load_product_sections(Database *db, ProductSections *sections) {
+    int64_t product_count, category_count;
+    sqlite3_stmt *stmt;
+
+    memset(sections, 0, sizeof(*sections));
+    if (query_int64(db, "SELECT count(*) FROM Products;", &product_count) != 0 ||
+        query_int64(db, "SELECT count(DISTINCT coalesce(category, '')) FROM Products;", &category_count) != 0) {
+        return -1;
+    }
+
+    size_t slots = product_count ? (size_t)product_count : 1;
+    sections->product_ids = malloc(sizeof(int32_t) * slots);
+    sections->prices = malloc(sizeof(double) * slots);
+    sections->categories = malloc(sizeof(int32_t) * slots);
+    sections->product_names = malloc(sizeof(uint32_t) * slots);
+    sections->category_list = calloc(category_count ? category_count : 1, sizeof(char *));
+    sections->category_names = calloc(category_count ? category_count : 1, sizeof(uint32_t));
+    uint32_t empty;
+    if (!sections->product_ids || !sections->prices || !sections->categories || !sections->product_names ||
+        !sections->category_list || !sections->category_names ||
+        string_table_add(&sections->strings, "", &empty) != 0) {
+        fprintf(stderr, "Out of memory building snapshot\n");
+        return -1;
+    }
+
+    // Category names, sorted so products can find theirs by binary search
+    if (sqlite3_prepare_v2(db->connection,
+                           "SELECT DISTINCT coalesce(category, '') FROM Products ORDER BY 1;",
+                           -1, &stmt, NULL) != SQLITE_OK) {
+        fprintf(stderr, "Failed to prepare snapshot query: %s\n", sqlite3_errmsg(db->connection));
+        return -1;
+    }
+    while (sections->category_count < category_count && sqlite3_step(stmt) == SQLITE_ROW) {
+        const char *name = (const char *)sqlite3_column_text(stmt, 0);
+        int32_t i = sections->category_count;
+        sections->category_list[i] = strdup(name ? name : "");
+        if (!sections->category_list[i] ||
+            string_table_add(&sections->strings, sections->category_list[i], &sections->category_names[i]) != 0) {
+            sqlite3_finalize(stmt);
+            fprintf(stderr, "Out of memory building snapshot\n");
+            return -1;
+        }
+        sections->category_count++;
+    }
+    sqlite3_finalize(stmt);
+
+    if (sqlite3_prepare_v2(db->connection,
+                           "SELECT product_id, selling_price, product_name, coalesce(category, '') FROM Products "
+                           "ORDER BY product_id;",
+                           -1, &stmt, NULL) != SQLITE_OK) {
+        fprintf(stderr, "Failed to prepare snapshot query: %s\n", sqlite3_errmsg(db->connection));
+        return -1;
+    }
+    int rc;
+    while (sections->product_count < product_count && (rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        int32_t slot = sections->product_count;
+        const char *name = (const char *)sqlite3_column_text(stmt, 2);
+        const char *category = (const char *)sqlite3_column_text(stmt, 3);
+        char **found = bsearch(&category, sections->category_list, sections->category_count,
+                               sizeof(char *), compare_strings);
+
+        sections->product_ids[slot] = sqlite3_column_int(stmt, 0);
+        sections->prices[slot] = sqlite3_column_double(stmt, 1);
+        sections->categories[slot] = found ? (int32_t)(found - sections->category_list) : -1;
+        if (string_table_add(&sections->strings, name ? name : "", &sections->product_names[slot]) != 0) {
+            sqlite3_finalize(stmt);
+            fprintf(stderr, "Out of memory building snapshot\n");
+            return -1;
+        }
+        sections->product_count++;
+    }
+    sqlite3_finalize(stmt);
+    if (sections->product_count < product_count && rc != SQLITE_DONE) {
+        fprintf(stderr, "Failed to read products for snapshot: %s\n", sqlite3_errmsg(db->connection));
+        return -1;
+    }
+    return 0;
+}
+
+// Slot of a product id, or -1 for ids no longer in Products
+static int32_t find_slot(const ProductSections *sections, int32_t product_id) {
+    int32_t lo = 0, hi = sections->product_count;
+    while (lo < hi) {
+        int32_t mid = lo + (hi - lo) / 2;
+        if (sections->product_ids[mid] < product_id) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo < sections->product_count && sections->product_ids[lo] == product_id ? lo : -1;
+}
+
+// Fill the sales columns from the (type, date, product_id, quantity) index, in date order
+static int64_t fill_sales_columns(Database *db, const ProductSections *sections, int32_t *days, int32_t *slots,
+                                  int32_t *quantities, int64_t capacity) {
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(db->connection,
+                           "SELECT transaction_date, product_id, quantity FROM Transactions "
+                           "WHERE transaction_type = 2 ORDER BY transaction_date;",
+                           -1, &stmt, NULL) != SQLITE_OK) {
+        fprintf(stderr, "Failed to prepare snapshot query: %s\n", sqlite3_errmsg(db->connection));
+        return -1;
+    }
+
+    int64_t rows = 0;
+    int rc;
+    while (rows < capacity && (rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        // Dates a migration could not convert are text and cannot be placed on a day
+        if (sqlite3_column_type(stmt, 0) != SQLITE_INTEGER) {
+            continue;
+        }
+        int64_t seconds = sqlite3_column_int64(stmt, 0);
+        int64_t day = seconds / 86400 - (seconds % 86400 < 0);
+        days[rows] = (int32_t)day;
+        slots[rows] = find_slot(sections, sqlite3_column_int(stmt, 1));
+        quantities[rows] = sqlite3_column_int(stmt, 2);
+        rows++;
+    }
+    if (rows < capacity && rc != SQLITE_DONE) {
+        fprintf(stderr, "Failed to read transactions for snapshot: %s\n", sqlite3_errmsg(db->connection));
+        rows = -1;
+    }
+    sqlite3_finalize(stmt);
+    return rows;
+}
+
+int snapshot_export(Database *db, const char *path) {
+    ProductSections sections;
+    int64_t row_count;
+    int status = -1;
+    int fd = -1;
+    unsigned char *base = MAP_FAILED;
+    size_t size = 0;
+
+    char temp_path[4096];
+    if (snprintf(temp_path, sizeof(temp_path), "%s.tmp", path) >= (int)sizeof(temp_path)) {
+        fprintf(stderr, "Snapshot path too long: %s\n", path);
+        return -1;
+    }
+
+    // One read transaction so products and sales come from the same state
+    if (begin_transaction(db) != 0) {
+        return -1;
+    }
+    if (load_product_sections(db, &sections) != 0 ||
+        query_int64(db, "SELECT count(*) FROM Transactions WHERE transaction_type = 2 "
+                        "AND typeof(transaction_date) = 'integer';", &row_count) != 0) {
+        goto done;
+    }
+
+    SnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.product_count = sections.product_count;
+    header.category_count = sections.category_count;
+    header.row_count = row_count;
+    header.created_at = (int64_t)time(NULL);
+    header.product_ids_offset = align_section(sizeof(SnapshotHeader));
+    header.prices_offset = align_section(header.product_ids_offset + sizeof(int32_t) * sections.product_count);
+    header.categories_offset = align_section(header.prices_offset + sizeof(double) * sections.product_count);
+    header.product_names_offset = align_section(header.categories_offset + sizeof(int32_t) * sections.product_count);
+    header.category_names_offset =
+        align_section(header.product_names_offset + sizeof(uint32_t) * sections.product_count);
+    header.strings_offset = align_section(header.category_names_offset + sizeof(uint32_t) * sections.category_count);
+    header.strings_size = sections.strings.size;
+    header.days_offset = align_section(header.strings_offset + sections.strings.size);
+    header.slots_offset = align_section(header.days_offset + sizeof(int32_t) * row_count);
+    header.quantities_offset = align_section(header.slots_offset + sizeof(int32_t) * row_count);
+    size = header.quantities_offset + sizeof(int32_t) * row_count;
+
+    fd = open(temp_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0 || ftruncate(fd, (off_t)size) != 0) {
+        perror(temp_path);
+        goto done;
+    }
+    base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        perror(temp_path);
+        goto done;
+    }
+
+    memcpy(base + header.product_ids_offset, sections.product_ids, sizeof(int32_t) * sections.product_count);
+    memcpy(base + header.prices_offset, sections.prices, sizeof(double) * sections.product_count);
+    memcpy(base + header.categories_offset, sections.categories, sizeof(int32_t) * sections.product_count);
+    memcpy(base + header.product_names_offset, sections.product_names, sizeof(uint32_t) * sections.product_count);
+    memcpy(base + header.category_names_offset, sections.category_names,
+           sizeof(uint32_t) * sections.category_count);
+    memcpy(base + header.strings_offset, sections.strings.data, sections.strings.size);
+
+    int64_t rows = fill_sales_columns(db, &sections, (int32_t *)(base + header.days_offset),
+                                      (int32_t *)(base + header.slots_offset),
+                                      (int32_t *)(base + header.quantities_offset), row_count);
+    if (rows != row_count) {
+        fprintf(stderr, "Snapshot row count changed during export\n");
+        goto done;
+    }
+
+    // The header goes in last, so a torn file never carries a valid magic
+    memcpy(base, &header, sizeof(header));
+    if (msync(base, size, MS_SYNC) != 0 || rename(temp_path, path) != 0) {
+        perror(path);
+        goto done;
+    }
+    status = 0;
+
+done:
+    if (base != MAP_FAILED) {
+        munmap(base, size);
+    }
+    if (fd >= 0) {
+        close(fd);
+        if (status != 0) {
+            unlink(temp_path);
+        }
+    }
+    free_product_sections(&sections);
+    commit_transaction(db);
+    return status;
+}
+
+// Reading
+
+// Whether a section of count elements at offset is aligned and inside a file of size bytes
+static int section_fits(uint64_t offset, uint64_t count, size_t element_size, uint64_t size) {
+    return offset % SECTION_ALIGNMENT == 0 && offset <= size && count <= (size - offset) / element_size;
+}
+
+// Check the header and every index the reports follow, so a damaged or
+// hostile file is rejected instead of read out of bounds
+static int validate_snapshot(const unsigned char *bytes, uint64_t size) {
+    const SnapshotHeader *header = (const SnapshotHeader *)bytes;
+    if (memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != SNAPSHOT_VERSION || header->product_count < 0 || header->category_count < 0 ||
+        header->row_count < 0) {
+        return -1;
+    }
+
+    uint64_t products = (uint64_t)header->product_count;
+    uint64_t categories = (uint64_t)header->category_count;
+    uint64_t rows = (uint64_t)header->row_count;
+    if (!section_fits(header->product_ids_offset, products, sizeof(int32_t), size) ||
+        !section_fits(header->prices_offset, products, sizeof(double), size) ||
+        !section_fits(header->categories_offset, products, sizeof(int32_t), size) ||
+        !section_fits(header->product_names_offset, products, sizeof(uint32_t), size) ||
+        !section_fits(header->category_names_offset, categories, sizeof(uint32_t), size) ||
+        !section_fits(header->strings_offset, header->strings_size, 1, size) ||
+        !section_fits(header->days_offset, rows, sizeof(int32_t), size) ||
+        !section_fits(header->slots_offset, rows, sizeof(int32_t), size) ||
+        !section_fits(header->quantities_offset, rows, sizeof(int32_t), size)) {
+        return -1;
+    }
+
+    // Names are offsets into a NUL-terminated string table
+    const char *strings = (const char *)(bytes + header->strings_offset);
+    if (products + categories > 0 &&
+        (header->strings_size == 0 || strings[header->strings_size - 1] != '\0')) {
+        return -1;
+    }
+    const int32_t *product_categories = (const int32_t *)(bytes + header->categories_offset);
+    const uint32_t *product_names = (const uint32_t *)(bytes + header->product_names_offset);
+    for (uint64_t i = 0; i < products; i++) {
+        if (product_categories[i] < -1 || product_categories[i] >= header->category_count ||
+            product_names[i] >= header->strings_size) {
+            return -1;
+        }
+    }
+    const uint32_t *category_names = (const uint32_t *)(bytes + header->category_names_offset);
+    for (uint64_t i = 0; i < categories; i++) {
+        if (category_names[i] >= header->strings_size) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int snapshot_open(Snapshot *snapshot, const char *path) {
+    memset(snapshot, 0, sizeof(*snapshot));
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror(path);
+        return -1;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(SnapshotHeader)) {
+        fprintf(stderr, "Not a snapshot file: %s\n", path);
+        close(fd);
+        return -1;
+    }
+    void *base = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        perror(path);
+        return -1;
+    }
+
+    const SnapshotHeader *header = base;
+    if (validate_snapshot(base, (uint64_t)info.st_size) != 0) {
+        fprintf(stderr, "Not a valid snapshot file: %s\n", path);
+        munmap(base, (size_t)info.st_size);
+        return -1;
+    }
+
+    const unsigned char *bytes = base;
+    snapshot->base = base;
+    snapshot->size = (size_t)info.st_size;
+    snapshot->header = header;
+    snapshot->product_ids = (const int32_t *)(bytes + header->product_ids_offset);
+    snapshot->prices = (const double *)(bytes + header->prices_offset);
+    snapshot->categories = (const int32_t *)(bytes + header->categories_offset);
+    snapshot->product_names = (const uint32_t *)(bytes + header->product_names_offset);
+    snapshot->category_names = (const uint32_t *)(bytes + header->category_names_offset);
+    snapshot->strings = (const char *)(bytes + header->strings_offset);
+    snapshot->days = (const int32_t *)(bytes + header->days_offset);
+    snapshot->slots = (const int32_t *)(bytes + header->slots_offset);
+    snapshot->quantities = (const int32_t *)(bytes + header->quantities_offset);
+
+    // Reports walk the columns front to back
+    madvise(base, snapshot->size, MADV_SEQUENTIAL);
+    return 0;
+}
+
+void snapshot_close(Snapshot *snapshot) {
+    if (snapshot->base) {
+        munmap(snapshot->base, snapshot->size);
+    }
+    memset(snapshot, 0, sizeof(*snapshot));
+}
+
+// Report engine
+
+// First row whose day is >= day
+static int64_t lower_bound(const int32_t *days, int64_t count, int32_t day) {
+    int64_t lo = 0, hi = count;
+    while (lo < hi) {
+        int64_t mid = lo + (hi - lo) / 2;
+        if (days[mid] < day) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+// Units sold per product slot over [start_date, end_date]; caller frees the result
+static int64_t *sum_units_by_product(const Snapshot *snapshot, const char *start_date, const char *end_date) {
+    int32_t first_day, last_day;
+    if (snapshot_parse_day(start_date, &first_day) != 0 || snapshot_parse_day(end_date, &last_day) != 0) {
+        fprintf(stderr, "Invalid report range: %s .. %s\n", start_date, end_date);
+        return NULL;
+    }
+
+    int32_t product_count = snapshot->header->product_count;
+    int64_t *units = calloc(product_count ? product_count : 1, sizeof(int64_t));
+    if (!units) {
+        fprintf(stderr, "Out of memory running snapshot report\n");
+        return NULL;
+    }
+    if (first_day > last_day) {
+        return units;
+    }
+
+    int64_t count = snapshot->header->row_count;
+    int64_t begin = lower_bound(snapshot->days, count, first_day);
+    int64_t end = lower_bound(snapshot->days, count, last_day + 1);
+    const int32_t *restrict slots = snapshot->slots;
+    const int32_t *restrict quantities = snapshot->quantities;
+
+    // The hot loop: two sequential int32 streams into one small accumulator
+    // array. Sales of deleted products have slot -1, out of range unsigned.
+    for (int64_t i = begin; i < end; i++) {
+        uint32_t slot = (uint32_t)slots[i];
+        if (slot < (uint32_t)product_count) {
+            units[slot] += quantities[i];
+        }
+    }
+    return units;
+}
+
+int snapshot_write_product_sales(const Snapshot *snapshot, const char *start_date, const char *end_date,
+                                 OutputSink *sink) {
+    int64_t *units = sum_units_by_product(snapshot, start_date, end_date);
+    if (!units) {
+        return -1;
+    }
+
+    int rows = 0;
+    output_begin(sink, product_sales_columns, PRODUCT_SALES_COLUMN_COUNT);
+    for (int32_t slot = 0; slot < snapshot->header->product_count; slot++) {
+        if (units[slot] == 0 || snapshot->categories[slot] < 0) {
+            continue;
+        }
+        output_int(sink, snapshot->product_ids[slot]);
+        output_text(sink, snapshot->strings + snapshot->product_names[slot]);
+        output_text(sink, snapshot->strings + snapshot->category_names[snapshot->categories[slot]]);
+        output_int(sink, units[slot]);
+        output_decimal(sink, (double)units[slot] * snapshot->prices[slot], 2);
+        output_end_row(sink);
+        rows++;
+    }
+    free(units);
+    return rows;
+}
+
+int snapshot_write_category_sales(const Snapshot *snapshot, const char *start_date, const char *end_date,
+                                  OutputSink *sink) {
+    int64_t *units = sum_units_by_product(snapshot, start_date, end_date);
+    if (!units) {
+        return -1;
+    }
+
+    int32_t category_count = snapshot->header->category_count;
+    int64_t *category_units = calloc(category_count ? category_count : 1, sizeof(int64_t));
+    double *category_sales = calloc(category_count ? category_count : 1, sizeof(double));
+    if (!category_units || !category_sales) {
+        fprintf(stderr, "Out of memory running snapshot report\n");
+        free(units);
+        free(category_units);
+        free(category_sales);
+        return -1;
+    }
+
+    // Fold products into categories: one pass over the product table
+    for (int32_t slot = 0; slot < snapshot->header->product_count; slot++) {
+        int32_t category = snapshot->categories[slot];
+        if (category >= 0) {
+            category_units[category] += units[slot];
+            category_sales[category] += (double)units[slot] * snapshot->prices[slot];
+        }
+    }
+
+    int rows = 0;
+    output_begin(sink, category_sales_columns, CATEGORY_SALES_COLUMN_COUNT);
+    for (int32_t i = 0; i < category_count; i++) {
+        if (category_units[i] == 0) {
+            continue;
+        }
+        output_text(sink, snapshot->strings + snapshot->category_names[i]);
+        output_int(sink, category_units[i]);
+        output_decimal(sink, category_sales[i], 2);
+        output_end_row(sink);
+        rows++;
+    }
+
+    free(units);
+    free(category_units);
+    free(category_sales);
+    return rows;
+}
@@ -0,0 +1,88 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "database.h"
+
+// Columnar sales snapshot
+// A point-in-time copy of every OUT transaction and the product attributes
+// the sales reports need, laid out as flat arrays in one file that readers
+// memory-map. Sales are sorted by day, so a date range is a contiguous slice
+// found by binary search and a report is a single pass over three int32
+// columns. Products occupy slots 0 .. product_count - 1 in product_id order;
+// sales refer to products by slot, and the sorted product_ids section maps a
+// slot back to its id, so the file grows with the number of products rather
+// than with the largest id.
+//
+// File layout (all sections 64-byte aligned, native byte order):
+//   SnapshotHeader
+//   int32   product_ids[product_count]    ascending, by slot
+//   double  prices[product_count]         selling_price
+//   int32   categories[product_count]     index into category names
+//   uint32  product_names[product_count]  offset into strings
+//   uint32  category_names[category_count]
+//   char    strings[strings_size]         NUL-terminated names
+//   int32   days[row_count]               days since 1970-01-01, ascending
+//   int32   slots[row_count]              product slot, -1 for deleted products
+//   int32   quantities[row_count]
+
+#define SNAPSHOT_MAGIC "INVSNAP1"
+#define SNAPSHOT_VERSION 2
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    int32_t product_count;
+    int32_t category_count;
+    int32_t reserved;
+    int64_t row_count;
+    int64_t created_at;       // unix seconds
+    uint64_t product_ids_offset;
+    uint64_t prices_offset;
+    uint64_t categories_offset;
+    uint64_t product_names_offset;
+    uint64_t category_names_offset;
+    uint64_t strings_offset;
+    uint64_t strings_size;
+    uint64_t days_offset;
+    uint64_t slots_offset;
+    uint64_t quantities_offset;
+} SnapshotHeader;
+
+// An open, read-only snapshot
+typedef struct {
+    void *base;
+    size_t size;
+    const SnapshotHeader *header;
+    const int32_t *product_ids;
+    const double *prices;
+    const int32_t *categories;
+    const uint32_t *product_names;
+    const uint32_t *category_names;
+    const char *strings;
+    const int32_t *days;
+    const int32_t *slots;
+    const int32_t *quantities;
+} Snapshot;
+
+// Write a snapshot of db to path; the file is built next to it and renamed
+// into place, so readers of the old snapshot are never disturbed
+int snapshot_export(Database *db, const char *path);
+
+// Map a snapshot file; returns -1 if it is missing or not a valid snapshot
+// (every section, name offset and category index is range-checked first)
+int snapshot_open(Snapshot *snapshot, const char *path);
+void snapshot_close(Snapshot *snapshot);
+
+// Parse the date part of "YYYY-MM-DD[...]" into days since 1970-01-01
+int snapshot_parse_day(const char *date, int32_t *day);
+
+// Per-product and per-category sales for the whole days from start_date to
+// end_date inclusive; return the number of rows written or -1
+int snapshot_write_product_sales(const Snapshot *snapshot, const char *start_date, const char *end_date,
+                                 OutputSink *sink);
+int snapshot_write_category_sales(const Snapshot *snapshot, const char *start_date, const char *end_date,
+                                  OutputSink *sink);
+
+#endif // SNAPSHOT_H